@@ -16,7 +16,20 @@ Q ruch kamery w dół
 U przełącz w tryb uczenia
 Ctrl+S zapisz pozycję robota
 Delete usuń ostatnią zapisaną pozycję robota
+Ctrl+Delete usuń cały zapisany program
+R nagrywanie ciągłe ruchu w trybie uczenia (start/stop)
 P przełącz w tryb pracy
+T przełącz profil ruchu w trybie pracy (trapezowy/S)
+B zmień rodzaj toru w trybie pracy (punkt-punkt/sklejany C1/C2/5. stopnia)
+Strzałki ruch końcówki robota w osiach X i Z
+Home/End ruch końcówki robota w osi Y
+K przełącz rysowanie robota jednym wywołaniem (skinning GPU)
+G pokaż/ukryj podgląd zapisanego programu w trybie uczenia
+C pokaż/ukryj celę z wieloma robotami
+F pokaż/ukryj profiler klatki (Ctrl+F zapisuje profile.csv i profile.json)
+M pokaż/ukryj mapę zasięgu i manipulowalności robota
+L zaplanuj ruch bez kolizji między punktami programu (w tle)
+Ctrl+L wstaw punkty zaplanowanej ścieżki do programu
 
 */
 
@@ -27,8 +40,49 @@ P przełącz w tryb pracy
 #include <memory>
 #include <vector>
 #include <cstring>
+#include <chrono>
+#include <algorithm>
+#include <atomic>
+#include <thread>
+#include <mutex>
+#include <functional>
+#include <unordered_map>
+#include <condition_variable>
+#include <deque>
+#include <random>
+#include <climits>
+#include <cfloat>
+#if defined(__AVX__) || defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <immintrin.h>
+#endif
+#if defined(_WIN32)
+// funkcje Win32 deklarowane ręcznie (jak w raylib) - windows.h koliduje z nazwami raylib (CloseWindow, DrawText...)
+extern "C" {
+    __declspec(dllimport) void* __stdcall CreateFileA(const char* fileName, unsigned long access, unsigned long shareMode, void* security, unsigned long disposition, unsigned long flags, void* templateFile);
+    __declspec(dllimport) void* __stdcall CreateFileMappingA(void* file, void* security, unsigned long protect, unsigned long sizeHigh, unsigned long sizeLow, const char* name);
+    __declspec(dllimport) void* __stdcall MapViewOfFile(void* mapping, unsigned long access, unsigned long offsetHigh, unsigned long offsetLow, size_t size);
+    __declspec(dllimport) int __stdcall UnmapViewOfFile(const void* address);
+    __declspec(dllimport) int __stdcall CloseHandle(void* handle);
+    __declspec(dllimport) int __stdcall GetFileSizeEx(void* file, long long* size);
+    __declspec(dllimport) void* __stdcall OpenFileMappingA(unsigned long access, int inheritHandle, const char* name);
+    __declspec(dllimport) int __stdcall MoveFileExA(const char* existingFileName, const char* newFileName, unsigned long flags);
+}
+#else
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <errno.h>
+#endif
 #define RAYGUI_IMPLEMENTATION
 #include "external/raylib/raygui.h"
+// raylib kompiluje stb_truetype jako static - własna implementacja z zewnętrznymi symbolami (bez ostrzeżeń o nieużywanych funkcjach)
+#define STB_TRUETYPE_IMPLEMENTATION
+#include "external/raylib/external/stb_truetype.h"
+// tylko deklaracje - implementację cgltf kompiluje rmodels.c (raylib)
+#include "external/raylib/external/cgltf.h"
 
 #define MAX_JOINT_COUNT 20
 
@@ -52,6 +106,906 @@ Matrix DHtoMatrix(Vector4 DH) {
     return result;
 }
 
+// zakres nastaw złącza (obroty w stopniach) - domyślny, gdy robot nie ma pliku opisu
+void GetJointLimits(JointType jt, float& minValue, float& maxValue) {
+    minValue = (jt == REVOLUTE) ? -170.0f : 0.0f;
+    maxValue = (jt == REVOLUTE) ? 170.0f : 2.0f;
+}
+
+// ograniczenia dynamiki złącza (obroty w stopniach, przesunięcia w jednostkach sceny)
+struct JointMotionLimits {
+    float velocity;     // na sekundę
+    float acceleration; // na sekundę^2
+    float jerk;         // na sekundę^3
+};
+
+JointMotionLimits GetDefaultMotionLimits(JointType jt) {
+    switch (jt) {
+    case REVOLUTE:
+        return { 90.0f, 180.0f, 900.0f };
+    case PRISMATIC:
+        return { 1.0f, 2.0f, 10.0f };
+    case MANIPULATOR:
+        return { 1.0f, 4.0f, 20.0f };
+    }
+    return { 1.0f, 1.0f, 1.0f };
+}
+
+// opis łańcucha kinematycznego robota niezależny od modelu 3D (z pliku opisu robota albo z kości modelu)
+struct KinematicChain {
+    int linkCount;                          // liczba ogniw łącznie z podstawą (boneCount)
+    Matrix base;                            // położenie podstawy (absoluteTransforms[0])
+    Vector4 DHparameters[MAX_JOINT_COUNT];
+    JointType jointTypes[MAX_JOINT_COUNT];
+    float minLimits[MAX_JOINT_COUNT];       // zakres nastawy złącza ogniwa (obroty w stopniach)
+    float maxLimits[MAX_JOINT_COUNT];
+    JointMotionLimits motionLimits[MAX_JOINT_COUNT];
+    int meshCount;                          // siatki modelu ramienia
+    int meshLinks[MAX_JOINT_COUNT];         // ogniwo, z którym rysowana i sprawdzana jest siatka
+};
+
+// zakresy i dynamika według rodzaju złącza, siatka i na ogniwie i
+void SetDefaultChainLimits(KinematicChain& chain, int meshCount) {
+    for (int i = 0; i < chain.linkCount; i++) {
+        GetJointLimits(chain.jointTypes[i], chain.minLimits[i], chain.maxLimits[i]);
+        chain.motionLimits[i] = GetDefaultMotionLimits(chain.jointTypes[i]);
+    }
+    chain.meshCount = std::min(meshCount, MAX_JOINT_COUNT);
+    for (int m = 0; m < chain.meshCount; m++) chain.meshLinks[m] = m;
+}
+
+// numer złącza chwytaka w tablicach nastaw (bez podstawy), -1 gdy łańcuch go nie ma
+int ManipulatorJoint(const KinematicChain& chain) {
+    for (int i = 1; i < chain.linkCount; i++) {
+        if (chain.jointTypes[i] == MANIPULATOR) return i - 1;
+    }
+    return -1;
+}
+
+// ogniwo w tablicy płaskiej: nastawa złącza wchodzi do kąta i przesunięcia przez mnożniki (0 dla stałych),
+// więc złącza obrotowe, pryzmatyczne i chwytak liczone są tym samym kodem, bez rozgałęzień po rodzaju złącza
+struct CompiledLink {
+    float theta, thetaScale;  // kąt = theta + thetaScale * q
+    float d, dScale;          // przesunięcie = d + dScale * q
+    float a;
+    float cosAlpha, sinAlpha;
+};
+
+struct CompiledChain {
+    int linkCount;
+    Matrix base;
+    CompiledLink links[MAX_JOINT_COUNT];
+    float unitScale[MAX_JOINT_COUNT]; // nastawa złącza j z wiersza (stopnie/metry) -> jednostki DH (radiany/metry)
+};
+
+// angleUnit - mnożnik nastaw złączy obrotowych (DEG2RAD dla nastaw w stopniach, 1 dla radianów)
+CompiledChain CompileChain(const KinematicChain& chain, float angleUnit) {
+    CompiledChain compiled;
+    compiled.linkCount = chain.linkCount;
+    compiled.base = chain.base;
+    for (int i = 0; i < chain.linkCount; i++) {
+        Vector4 DH = chain.DHparameters[i];
+        CompiledLink& link = compiled.links[i];
+        bool revolute = (i > 0 && chain.jointTypes[i] == REVOLUTE);
+        bool prismatic = (i > 0 && chain.jointTypes[i] == PRISMATIC);
+        // nastawa zastępuje kąt albo przesunięcie z DH (jak RobotArm::MoveJoint)
+        link.theta = revolute ? 0 : DH.x;
+        link.thetaScale = revolute ? angleUnit : 0;
+        link.d = prismatic ? 0 : DH.y;
+        link.dScale = prismatic ? 1.0f : 0;
+        link.a = DH.z;
+        link.cosAlpha = cosf(DH.w);
+        link.sinAlpha = sinf(DH.w);
+        if (i > 0) compiled.unitScale[i - 1] = revolute ? DEG2RAD : 1.0f;
+    }
+    return compiled;
+}
+
+// parent * DHtoMatrix(ogniwa) dla nastawy q; obrót ogniwa R = Rx(alfa) * Ry(theta), p = Rx(alfa) * (a, d, 0)
+inline Matrix ComposeLink(const CompiledLink& link, float q, const Matrix& p) {
+    float theta = link.theta + link.thetaScale * q;
+    float d = link.d + link.dScale * q;
+    float st = sinf(theta);
+    float ct = cosf(theta);
+    float ca = link.cosAlpha;
+    float sa = link.sinAlpha;
+    float l[9] = { ct, sa * st, -ca * st, 0, ca, sa, st, -sa * ct, ca * ct }; // kolumny obrotu ogniwa
+    float lp[3] = { link.a, ca * d, sa * d };
+    Matrix r;
+    r.m0 = p.m0 * l[0] + p.m4 * l[1] + p.m8 * l[2];
+    r.m1 = p.m1 * l[0] + p.m5 * l[1] + p.m9 * l[2];
+    r.m2 = p.m2 * l[0] + p.m6 * l[1] + p.m10 * l[2];
+    r.m4 = p.m0 * l[3] + p.m4 * l[4] + p.m8 * l[5];
+    r.m5 = p.m1 * l[3] + p.m5 * l[4] + p.m9 * l[5];
+    r.m6 = p.m2 * l[3] + p.m6 * l[4] + p.m10 * l[5];
+    r.m8 = p.m0 * l[6] + p.m4 * l[7] + p.m8 * l[8];
+    r.m9 = p.m1 * l[6] + p.m5 * l[7] + p.m9 * l[8];
+    r.m10 = p.m2 * l[6] + p.m6 * l[7] + p.m10 * l[8];
+    r.m12 = p.m0 * lp[0] + p.m4 * lp[1] + p.m8 * lp[2] + p.m12;
+    r.m13 = p.m1 * lp[0] + p.m5 * lp[1] + p.m9 * lp[2] + p.m13;
+    r.m14 = p.m2 * lp[0] + p.m6 * lp[1] + p.m10 * lp[2] + p.m14;
+    r.m3 = r.m7 = r.m11 = 0;
+    r.m15 = 1;
+    return r;
+}
+
+// kinematyka prosta dla stałej liczby ogniw - pętla po ogniwach rozwinięta w czasie kompilacji
+template <int Links>
+struct UnrolledKinematics {
+    static void Forward(const CompiledChain& chain, const float* q, Matrix* out) {
+        UnrolledKinematics<Links - 1>::Forward(chain, q, out);
+        out[Links - 1] = ComposeLink(chain.links[Links - 1], q[Links - 2], out[Links - 2]);
+    }
+};
+
+template <>
+struct UnrolledKinematics<1> {
+    static void Forward(const CompiledChain& chain, const float*, Matrix* out) {
+        out[0] = chain.base;
+    }
+};
+
+// położenia ogniw dla nastaw q (jointCount = linkCount - 1); typowe długości łańcucha (3-6 osi i chwytak) rozwinięte
+void ForwardKinematics(const CompiledChain& chain, const float* q, Matrix* out) {
+    switch (chain.linkCount) {
+    case 5: UnrolledKinematics<5>::Forward(chain, q, out); return;
+    case 6: UnrolledKinematics<6>::Forward(chain, q, out); return;
+    case 7: UnrolledKinematics<7>::Forward(chain, q, out); return;
+    case 8: UnrolledKinematics<8>::Forward(chain, q, out); return;
+    }
+    out[0] = chain.base;
+    for (int i = 1; i < chain.linkCount; i++) out[i] = ComposeLink(chain.links[i], q[i - 1], out[i - 1]);
+}
+
+// statystyki rozwiązania kinematyki odwrotnej
+struct IKStats {
+    int iterations;
+    float error;         // odległość końcówki od celu
+    float angleError;    // kąt obrotu do orientacji celu [rad] (0 gdy cel bez orientacji)
+    float microseconds;
+    bool converged;
+};
+
+// rozwiązanie układu n x n (n <= 6) eliminacją Gaussa z wyborem elementu głównego; b nadpisywane wynikiem
+bool SolveLinearSystem(float A[6][6], float* b, int n) {
+    for (int c = 0; c < n; c++) {
+        int pivot = c;
+        for (int r = c + 1; r < n; r++) {
+            if (fabsf(A[r][c]) > fabsf(A[pivot][c])) pivot = r;
+        }
+        if (fabsf(A[pivot][c]) < 1e-12f) return false;
+        if (pivot != c) {
+            for (int k = 0; k < n; k++) std::swap(A[c][k], A[pivot][k]);
+            std::swap(b[c], b[pivot]);
+        }
+        for (int r = c + 1; r < n; r++) {
+            float f = A[r][c] / A[c][c];
+            for (int k = c; k < n; k++) A[r][k] -= f * A[c][k];
+            b[r] -= f * b[c];
+        }
+    }
+    for (int r = n - 1; r >= 0; r--) {
+        for (int k = r + 1; k < n; k++) b[r] -= A[r][k] * b[k];
+        b[r] /= A[r][r];
+    }
+    return true;
+}
+
+// Kinematyka odwrotna końcówki metodą tłumionych najmniejszych kwadratów (DLS): samo położenie albo pełna poza
+// (położenie i orientacja kołnierza, wiersze obrotu z wagą). Jakobian liczony analitycznie z osi ogniw łańcucha,
+// nastawy jak w wierszu SavedStates. Ramię z mniej niż 6 złączami nie ustawi dowolnej orientacji - wtedy poza jest
+// rozwiązywana w sensie najmniejszych kwadratów i zgłaszana jako nieosiągnięta.
+class InverseKinematics {
+    KinematicChain chain;
+    CompiledChain compiled;                // nastawy obrotowe w radianach
+    Matrix frames[MAX_JOINT_COUNT];        // ogniwa dla aktualnie przyjętego rozwiązania
+    Vector3 jacobian[MAX_JOINT_COUNT];     // kolumny jakobianu położenia dla tych samych nastaw
+    Vector3 angularJacobian[MAX_JOINT_COUNT]; // kolumny jakobianu orientacji
+    float minLimits[MAX_JOINT_COUNT];
+    float maxLimits[MAX_JOINT_COUNT];
+    IKStats lastStats;
+    int solveCount;
+    float totalMicroseconds;
+    float maxMicroseconds;
+
+    const int maxIterations = 50;
+    const float tolerance = 0.0005f;
+    const float angleTolerance = 0.001f; // [rad]
+
+    bool IsActive(int joint) {
+        JointType jt = chain.jointTypes[joint + 1];
+        return jt == REVOLUTE || jt == PRISMATIC;
+    }
+
+    // nastawy w jednostkach DH (radiany, metry) -> położenia ogniw
+    void ComputeFrames(const float* q, Matrix* out) {
+        ForwardKinematics(compiled, q, out);
+    }
+
+    Vector3 GetTCP(const Matrix* f) {
+        const Matrix& flange = f[chain.linkCount - 1];
+        return { flange.m12, flange.m13, flange.m14 };
+    }
+
+    // obrót, który przeprowadza orientację current w target, jako wektor osi razy kąt
+    static Vector3 OrientationError(const Matrix& target, const Matrix& current) {
+        Quaternion t = QuaternionFromMatrix(target);
+        Quaternion c = QuaternionFromMatrix(current);
+        Quaternion e = QuaternionMultiply(t, QuaternionInvert(c));
+        if (e.w < 0) e = { -e.x, -e.y, -e.z, -e.w }; // krótszy obrót
+        Vector3 v = { e.x, e.y, e.z };
+        float s = Vector3Length(v);
+        if (s < 1e-9f) return { 0, 0, 0 };
+        return Vector3Scale(v, 2 * atan2f(s, e.w) / s);
+    }
+
+    // obrót i przesuw ogniwa i odbywają się wzdłuż osi Y jego układu; mnożniki nastawy ogniwa (thetaScale, dScale)
+    // wybierają składową obrotową albo przesuwną kolumny, dla chwytaka obie są zerowe
+    void UpdateJacobian() {
+        Vector3 tcp = GetTCP(frames);
+        for (int j = 0; j < chain.linkCount - 1; j++) {
+            const Matrix& f = frames[j + 1];
+            const CompiledLink& link = compiled.links[j + 1];
+            Vector3 axis = { f.m4, f.m5, f.m6 };
+            Vector3 turn = Vector3CrossProduct(axis, Vector3Subtract(tcp, { f.m12, f.m13, f.m14 }));
+            jacobian[j] = Vector3Add(Vector3Scale(turn, link.thetaScale), Vector3Scale(axis, link.dScale));
+            angularJacobian[j] = Vector3Scale(axis, link.thetaScale);
+        }
+    }
+
+    // wektor błędu: 3 wiersze położenia i (dla pozy) 3 wiersze orientacji z wagą
+    int ComputeError(const Matrix* f, const Matrix& target, bool withOrientation, float weight, float* error, float& length, float& angle) {
+        Vector3 p = Vector3Subtract({ target.m12, target.m13, target.m14 }, GetTCP(f));
+        error[0] = p.x;
+        error[1] = p.y;
+        error[2] = p.z;
+        length = Vector3Length(p);
+        angle = 0;
+        if (!withOrientation) return 3;
+        Vector3 r = OrientationError(target, f[chain.linkCount - 1]);
+        angle = Vector3Length(r);
+        error[3] = r.x * weight;
+        error[4] = r.y * weight;
+        error[5] = r.z * weight;
+        return 6;
+    }
+
+    // target - położenie (m12..m14) i przy withOrientation także obrót kołnierza; weight - jednostki długości na radian
+    bool SolveTarget(const Matrix& target, bool withOrientation, float weight, float* joints) {
+        auto start = std::chrono::steady_clock::now();
+        int jointCount = chain.linkCount - 1;
+        float q[MAX_JOINT_COUNT] = { 0 };
+        float trial[MAX_JOINT_COUNT];
+        Matrix trialFrames[MAX_JOINT_COUNT];
+        for (int j = 0; j < jointCount; j++) q[j] = joints[j] * compiled.unitScale[j];
+
+        ComputeFrames(q, frames);
+        UpdateJacobian();
+        float error[6], trialError[6];
+        float errorLength, angle;
+        int rows = ComputeError(frames, target, withOrientation, weight, error, errorLength, angle);
+        // przy pozie porównywana jest norma całego ważonego błędu
+        auto norm = [rows](const float* e) {
+            float sum = 0;
+            for (int r = 0; r < rows; r++) sum += e[r] * e[r];
+            return sqrtf(sum);
+        };
+        float errorNorm = norm(error);
+        float damping = 0.01f;
+        int iteration = 0;
+
+        while (iteration < maxIterations && (errorLength > tolerance || angle > angleTolerance)) {
+            iteration++;
+            // wiersze jakobianu: położenie, orientacja z wagą
+            float J[6][MAX_JOINT_COUNT];
+            for (int j = 0; j < jointCount; j++) {
+                const Vector3& c = jacobian[j];
+                const Vector3& w = angularJacobian[j];
+                float column[6] = { c.x, c.y, c.z, w.x * weight, w.y * weight, w.z * weight };
+                for (int r = 0; r < rows; r++) J[r][j] = column[r];
+            }
+            // A = J * J^T + lambda^2 * I, x = A^-1 * e
+            float A[6][6];
+            for (int r = 0; r < rows; r++) {
+                for (int k = 0; k < rows; k++) {
+                    float sum = (r == k) ? damping * damping : 0;
+                    for (int j = 0; j < jointCount; j++) sum += J[r][j] * J[k][j];
+                    A[r][k] = sum;
+                }
+            }
+            float x[6];
+            memcpy(x, error, sizeof(float) * rows);
+            if (!SolveLinearSystem(A, x, rows)) break;
+
+            // dq = J^T * x, ograniczony krok i zakres złączy
+            bool moved = false;
+            for (int j = 0; j < jointCount; j++) {
+                trial[j] = q[j];
+                if (!IsActive(j)) continue;
+                float step = 0;
+                for (int r = 0; r < rows; r++) step += J[r][j] * x[r];
+                step = Clamp(step, -0.3f, 0.3f);
+                trial[j] = Clamp(q[j] + step, minLimits[j], maxLimits[j]);
+                if (trial[j] != q[j]) moved = true;
+            }
+            if (!moved) break;
+
+            ComputeFrames(trial, trialFrames);
+            float trialLength, trialAngle;
+            ComputeError(trialFrames, target, withOrientation, weight, trialError, trialLength, trialAngle);
+            float trialNorm = norm(trialError);
+            if (trialNorm < errorNorm) {
+                // krok przyjęty, jakobian przeliczany z już policzonych ogniw
+                memcpy(q, trial, sizeof(float) * jointCount);
+                memcpy(frames, trialFrames, sizeof(Matrix) * chain.linkCount);
+                UpdateJacobian();
+                memcpy(error, trialError, sizeof(float) * rows);
+                errorNorm = trialNorm;
+                errorLength = trialLength;
+                angle = trialAngle;
+                damping = fmaxf(damping * 0.5f, 0.001f);
+            } else {
+                // krok odrzucony, jakobian z pamięci podręcznej pozostaje ważny
+                damping *= 4.0f;
+            }
+        }
+
+        lastStats.iterations = iteration;
+        lastStats.error = errorLength;
+        lastStats.angleError = angle;
+        lastStats.converged = errorLength <= tolerance && angle <= angleTolerance;
+        lastStats.microseconds = std::chrono::duration<float, std::micro>(std::chrono::steady_clock::now() - start).count();
+        solveCount++;
+        totalMicroseconds += lastStats.microseconds;
+        if (lastStats.microseconds > maxMicroseconds) maxMicroseconds = lastStats.microseconds;
+
+        if (lastStats.converged) {
+            // nastawa chwytaka nie jest zmieniana w krokach, a jej mnożnik to 1 - wraca bez zmian
+            for (int j = 0; j < jointCount; j++) joints[j] = q[j] / compiled.unitScale[j];
+        }
+        return lastStats.converged;
+    }
+
+public:
+    InverseKinematics() {
+        chain.linkCount = 0;
+        lastStats = { 0, 0, 0, 0, false };
+        ResetStats();
+    }
+
+    void SetChain(const KinematicChain& c) {
+        chain = c;
+        compiled = CompileChain(chain, 1.0f);
+        for (int j = 0; j < chain.linkCount - 1; j++) {
+            minLimits[j] = chain.minLimits[j + 1] * compiled.unitScale[j];
+            maxLimits[j] = chain.maxLimits[j + 1] * compiled.unitScale[j];
+        }
+    }
+
+    // złącza zmieniające położenie kołnierza; poniżej 6 dowolna orientacja nie jest osiągalna
+    int GetActiveCount() {
+        int count = 0;
+        for (int j = 0; j < chain.linkCount - 1; j++) {
+            if (IsActive(j)) count++;
+        }
+        return count;
+    }
+
+    // położenia ogniw dla nastaw złączy (stopnie/metry)
+    void ForwardFrames(const float* joints, Matrix* out) {
+        float q[MAX_JOINT_COUNT];
+        for (int j = 0; j < chain.linkCount - 1; j++) q[j] = joints[j] * compiled.unitScale[j];
+        ComputeFrames(q, out);
+    }
+
+    // położenie końcówki dla nastaw złączy (stopnie/metry)
+    Vector3 ForwardPosition(const float* joints) {
+        Matrix f[MAX_JOINT_COUNT];
+        ForwardFrames(joints, f);
+        return GetTCP(f);
+    }
+
+    // poza kołnierza (położenie i orientacja) dla nastaw złączy
+    Matrix ForwardPose(const float* joints) {
+        Matrix f[MAX_JOINT_COUNT];
+        ForwardFrames(joints, f);
+        return f[chain.linkCount - 1];
+    }
+
+    // joints: na wejściu nastawy startowe, na wyjściu rozwiązanie (zmieniane tylko gdy znaleziono)
+    bool Solve(Vector3 target, float* joints) {
+        return SolveTarget(MatrixTranslate(target), false, 0, joints);
+    }
+
+    // pełna poza kołnierza; orientationWeight - ile jednostek położenia waży radian błędu orientacji
+    bool SolvePose(const Matrix& target, float* joints, float orientationWeight = 1.0f) {
+        return SolveTarget(target, true, orientationWeight, joints);
+    }
+
+    IKStats GetLastStats() {
+        return lastStats;
+    }
+
+    float GetAverageMicroseconds() {
+        return (solveCount > 0) ? totalMicroseconds / solveCount : 0;
+    }
+
+    float GetMaxMicroseconds() {
+        return maxMicroseconds;
+    }
+
+    void ResetStats() {
+        solveCount = 0;
+        totalMicroseconds = 0;
+        maxMicroseconds = 0;
+    }
+};
+
+// rzut trójkąta na oś
+void ProjectTriangle(const Vector3* t, Vector3 axis, float& minValue, float& maxValue) {
+    float a = Vector3DotProduct(t[0], axis);
+    float b = Vector3DotProduct(t[1], axis);
+    float c = Vector3DotProduct(t[2], axis);
+    minValue = fminf(a, fminf(b, c));
+    maxValue = fmaxf(a, fmaxf(b, c));
+}
+
+// test przecięcia dwóch trójkątów metodą osi rozdzielających
+bool TrianglesIntersect(const Vector3* a, const Vector3* b) {
+    Vector3 ea[3] = { Vector3Subtract(a[1], a[0]), Vector3Subtract(a[2], a[1]), Vector3Subtract(a[0], a[2]) };
+    Vector3 eb[3] = { Vector3Subtract(b[1], b[0]), Vector3Subtract(b[2], b[1]), Vector3Subtract(b[0], b[2]) };
+    Vector3 na = Vector3CrossProduct(ea[0], ea[1]);
+    Vector3 nb = Vector3CrossProduct(eb[0], eb[1]);
+    Vector3 axes[17];
+    int axisCount = 0;
+    axes[axisCount++] = na;
+    axes[axisCount++] = nb;
+    for (int i = 0; i < 3; i++) {
+        for (int j = 0; j < 3; j++) axes[axisCount++] = Vector3CrossProduct(ea[i], eb[j]);
+    }
+    // krawędzie w płaszczyźnie trójkątów (przypadek współpłaszczyznowy)
+    for (int i = 0; i < 3; i++) {
+        axes[axisCount++] = Vector3CrossProduct(na, ea[i]);
+        axes[axisCount++] = Vector3CrossProduct(nb, eb[i]);
+    }
+    for (int i = 0; i < axisCount; i++) {
+        if (Vector3DotProduct(axes[i], axes[i]) < 1e-12f) continue;
+        float minA, maxA, minB, maxB;
+        ProjectTriangle(a, axes[i], minA, maxA);
+        ProjectTriangle(b, axes[i], minB, maxB);
+        if (maxA < minB || maxB < minA) return false;
+    }
+    return true;
+}
+
+// test przecięcia trójkąta z prostopadłościanem o osiach zgodnych z układem
+bool TriangleBoxIntersect(const Vector3* t, Vector3 center, Vector3 half) {
+    Vector3 v[3] = { Vector3Subtract(t[0], center), Vector3Subtract(t[1], center), Vector3Subtract(t[2], center) };
+    Vector3 e[3] = { Vector3Subtract(v[1], v[0]), Vector3Subtract(v[2], v[1]), Vector3Subtract(v[0], v[2]) };
+    const Vector3 boxAxes[3] = { { 1, 0, 0 }, { 0, 1, 0 }, { 0, 0, 1 } };
+    Vector3 axes[13];
+    int axisCount = 0;
+    for (int i = 0; i < 3; i++) axes[axisCount++] = boxAxes[i];
+    axes[axisCount++] = Vector3CrossProduct(e[0], e[1]);
+    for (int i = 0; i < 3; i++) {
+        for (int j = 0; j < 3; j++) axes[axisCount++] = Vector3CrossProduct(boxAxes[i], e[j]);
+    }
+    for (int i = 0; i < axisCount; i++) {
+        if (Vector3DotProduct(axes[i], axes[i]) < 1e-12f) continue;
+        float minT, maxT;
+        ProjectTriangle(v, axes[i], minT, maxT);
+        float r = half.x * fabsf(axes[i].x) + half.y * fabsf(axes[i].y) + half.z * fabsf(axes[i].z);
+        if (minT > r || maxT < -r) return false;
+    }
+    return true;
+}
+
+bool BoxesOverlap(const BoundingBox& a, const BoundingBox& b) {
+    return a.min.x <= b.max.x && b.min.x <= a.max.x &&
+           a.min.y <= b.max.y && b.min.y <= a.max.y &&
+           a.min.z <= b.max.z && b.min.z <= a.max.z;
+}
+
+// szybkie odrzucenie: wszystkie wierzchołki b po jednej stronie płaszczyzny a
+bool TriangleSeparatedByPlane(const Vector3* a, const Vector3* b) {
+    Vector3 n = Vector3CrossProduct(Vector3Subtract(a[1], a[0]), Vector3Subtract(a[2], a[0]));
+    float d0 = Vector3DotProduct(n, Vector3Subtract(b[0], a[0]));
+    float d1 = Vector3DotProduct(n, Vector3Subtract(b[1], a[0]));
+    float d2 = Vector3DotProduct(n, Vector3Subtract(b[2], a[0]));
+    return (d0 > 0 && d1 > 0 && d2 > 0) || (d0 < 0 && d1 < 0 && d2 < 0);
+}
+
+// prostopadłościan otaczający box po przekształceniu sztywnym
+BoundingBox TransformBox(const BoundingBox& box, const Matrix& m) {
+    Vector3 c = Vector3Transform(Vector3Scale(Vector3Add(box.min, box.max), 0.5f), m);
+    Vector3 h = Vector3Scale(Vector3Subtract(box.max, box.min), 0.5f);
+    Vector3 half = {
+        fabsf(m.m0) * h.x + fabsf(m.m4) * h.y + fabsf(m.m8) * h.z,
+        fabsf(m.m1) * h.x + fabsf(m.m5) * h.y + fabsf(m.m9) * h.z,
+        fabsf(m.m2) * h.x + fabsf(m.m6) * h.y + fabsf(m.m10) * h.z
+    };
+    return { Vector3Subtract(c, half), Vector3Add(c, half) };
+}
+
+// drzewo prostopadłościanów otaczających (AABB) trójkątów jednej siatki
+// budowane raz w układzie siatki, w każdej klatce dopasowywane (refit) do położenia ogniwa w świecie;
+// trójkąty liścia przenoszone są do świata dopiero gdy test do niego dotrze
+// stos przejścia drzewa: tablica lokalna, a dla głębszych drzew pamięć na stercie (nic nie jest pomijane)
+template <typename T, int N>
+class TraversalStack {
+    T fixed[N];
+    std::vector<T> heap;
+    T* data;
+public:
+    explicit TraversalStack(int needed) : data(fixed) {
+        if (needed > N) {
+            heap.resize(needed);
+            data = heap.data();
+        }
+    }
+
+    T& operator[](int i) {
+        return data[i];
+    }
+};
+
+class MeshBVH {
+    struct Node {
+        BoundingBox localBox;
+        BoundingBox box;  // w układzie świata po ostatnim Refit
+        int left, right;  // dzieci węzła wewnętrznego
+        int first, count; // zakres trójkątów liścia (count > 0)
+    };
+    std::vector<Node> nodes;
+    std::vector<Vector3> localTriangles; // po 3 wierzchołki, uporządkowane według liści
+    Matrix transform;
+    int refitStamp;
+    mutable std::vector<Vector3> triangles; // wierzchołki w układzie świata (ważne gdy leafStamps == refitStamp)
+    mutable std::vector<BoundingBox> triangleBoxes;
+    mutable std::vector<int> leafStamps;
+    int depth; // najdłuższa droga od korzenia do liścia - rozmiar stosu przejścia
+
+    static const int leafSize = 8;
+
+    int BuildNode(std::vector<int>& order, const std::vector<Vector3>& centroids, const std::vector<BoundingBox>& boxes, int first, int count, int level) {
+        Node node;
+        node.localBox = boxes[order[first]];
+        for (int i = first + 1; i < first + count; i++) {
+            node.localBox.min = Vector3Min(node.localBox.min, boxes[order[i]].min);
+            node.localBox.max = Vector3Max(node.localBox.max, boxes[order[i]].max);
+        }
+        node.box = node.localBox;
+        node.left = node.right = -1;
+        node.first = first;
+        node.count = count;
+        int index = (int)nodes.size();
+        nodes.push_back(node);
+        depth = std::max(depth, level);
+        if (count <= leafSize) return index;
+
+        // podział w medianie wzdłuż najdłuższej osi
+        Vector3 size = Vector3Subtract(node.localBox.max, node.localBox.min);
+        int axis = (size.x > size.y && size.x > size.z) ? 0 : (size.y > size.z ? 1 : 2);
+        int middle = first + count / 2;
+        std::nth_element(order.begin() + first, order.begin() + middle, order.begin() + first + count, [&](int a, int b) {
+            const float ca[3] = { centroids[a].x, centroids[a].y, centroids[a].z };
+            const float cb[3] = { centroids[b].x, centroids[b].y, centroids[b].z };
+            return ca[axis] < cb[axis];
+        });
+        int left = BuildNode(order, centroids, boxes, first, middle - first, level + 1);
+        int right = BuildNode(order, centroids, boxes, middle, first + count - middle, level + 1);
+        nodes[index].left = left;
+        nodes[index].right = right;
+        nodes[index].count = 0;
+        return index;
+    }
+
+    // trójkąty liścia w układzie świata dla bieżącego dopasowania
+    void UpdateLeaf(int index) const {
+        if (leafStamps[index] == refitStamp) return;
+        const Node& node = nodes[index];
+        for (int i = node.first; i < node.first + node.count; i++) {
+            Vector3* t = &triangles[i * 3];
+            for (int k = 0; k < 3; k++) t[k] = Vector3Transform(localTriangles[i * 3 + k], transform);
+            triangleBoxes[i].min = Vector3Min(t[0], Vector3Min(t[1], t[2]));
+            triangleBoxes[i].max = Vector3Max(t[0], Vector3Max(t[1], t[2]));
+        }
+        leafStamps[index] = refitStamp;
+    }
+
+public:
+    MeshBVH() : transform(MatrixIdentity()), refitStamp(0), depth(0) {}
+
+    void Build(const Mesh& mesh) {
+        nodes.clear();
+        localTriangles.clear();
+        if (mesh.vertices == NULL || mesh.triangleCount == 0) return;
+        int triangleCount = mesh.triangleCount;
+        std::vector<Vector3> source(triangleCount * 3);
+        for (int i = 0; i < triangleCount * 3; i++) {
+            int v = (mesh.indices != NULL) ? mesh.indices[i] : i;
+            source[i] = { mesh.vertices[v * 3], mesh.vertices[v * 3 + 1], mesh.vertices[v * 3 + 2] };
+        }
+        std::vector<int> order(triangleCount);
+        std::vector<Vector3> centroids(triangleCount);
+        std::vector<BoundingBox> boxes(triangleCount);
+        for (int i = 0; i < triangleCount; i++) {
+            order[i] = i;
+            centroids[i] = Vector3Scale(Vector3Add(Vector3Add(source[i * 3], source[i * 3 + 1]), source[i * 3 + 2]), 1.0f / 3.0f);
+            boxes[i].min = Vector3Min(source[i * 3], Vector3Min(source[i * 3 + 1], source[i * 3 + 2]));
+            boxes[i].max = Vector3Max(source[i * 3], Vector3Max(source[i * 3 + 1], source[i * 3 + 2]));
+        }
+        depth = 0;
+        BuildNode(order, centroids, boxes, 0, triangleCount, 0);
+        localTriangles.resize(source.size());
+        for (int i = 0; i < triangleCount; i++) {
+            for (int k = 0; k < 3; k++) localTriangles[i * 3 + k] = source[order[i] * 3 + k];
+        }
+        triangles.resize(localTriangles.size());
+        triangleBoxes.resize(triangleCount);
+        leafStamps.assign(nodes.size(), -1);
+        Refit(MatrixIdentity());
+    }
+
+    // przeliczenie prostopadłościanów węzłów dla nowego położenia siatki
+    void Refit(const Matrix& m) {
+        transform = m;
+        refitStamp++;
+        for (Node& node : nodes) node.box = TransformBox(node.localBox, transform);
+    }
+
+    bool IsEmpty() const {
+        return nodes.empty();
+    }
+
+    BoundingBox GetBounds() const {
+        return nodes[0].box;
+    }
+
+    // przecięcie z drugą siatką (obie dopasowane do bieżących położeń)
+    // węzły porównywane są w układzie każdej z siatek osobno, co daje ciaśniejsze ograniczenie niż w świecie
+    bool Intersects(const MeshBVH& b) const {
+        if (IsEmpty() || b.IsEmpty()) return false;
+        Matrix bToA = MatrixMultiply(b.transform, MatrixInvert(transform));
+        Matrix aToB = MatrixMultiply(transform, MatrixInvert(b.transform));
+        // każdy podział schodzi w jednym z drzew - na stosie najwyżej depth + b.depth + 1 par
+        TraversalStack<std::pair<int, int>, 128> stack(depth + b.depth + 2);
+        int top = 0;
+        stack[top++] = { 0, 0 };
+        while (top > 0) {
+            std::pair<int, int> pair = stack[--top];
+            const Node& na = nodes[pair.first];
+            const Node& nb = b.nodes[pair.second];
+            if (!BoxesOverlap(na.box, nb.box)) continue;
+            if (!BoxesOverlap(na.localBox, TransformBox(nb.localBox, bToA))) continue;
+            if (!BoxesOverlap(nb.localBox, TransformBox(na.localBox, aToB))) continue;
+
+            if (na.count > 0 && nb.count > 0) {
+                UpdateLeaf(pair.first);
+                b.UpdateLeaf(pair.second);
+                for (int j = nb.first; j < nb.first + nb.count; j++) {
+                    if (!BoxesOverlap(na.box, b.triangleBoxes[j])) continue;
+                    const Vector3* tb = &b.triangles[j * 3];
+                    for (int i = na.first; i < na.first + na.count; i++) {
+                        if (!BoxesOverlap(triangleBoxes[i], b.triangleBoxes[j])) continue;
+                        const Vector3* ta = &triangles[i * 3];
+                        if (TriangleSeparatedByPlane(ta, tb) || TriangleSeparatedByPlane(tb, ta)) continue;
+                        if (TrianglesIntersect(ta, tb)) return true;
+                    }
+                }
+            } else {
+                // schodzimy w węźle o większej objętości
+                Vector3 sa = Vector3Subtract(na.localBox.max, na.localBox.min);
+                Vector3 sb = Vector3Subtract(nb.localBox.max, nb.localBox.min);
+                bool splitA = nb.count > 0 || (na.count == 0 && sa.x * sa.y * sa.z >= sb.x * sb.y * sb.z);
+                if (splitA) {
+                    stack[top++] = { na.left, pair.second };
+                    stack[top++] = { na.right, pair.second };
+                } else {
+                    stack[top++] = { pair.first, nb.left };
+                    stack[top++] = { pair.first, nb.right };
+                }
+            }
+        }
+        return false;
+    }
+
+    // przecięcie z prostopadłościanem w układzie świata
+    bool IntersectsBox(const BoundingBox& box) const {
+        if (IsEmpty()) return false;
+        Vector3 boxCenter = Vector3Scale(Vector3Add(box.min, box.max), 0.5f);
+        Vector3 boxHalf = Vector3Scale(Vector3Subtract(box.max, box.min), 0.5f);
+        TraversalStack<int, 64> stack(depth + 2);
+        int top = 0;
+        stack[top++] = 0;
+        while (top > 0) {
+            int index = stack[--top];
+            const Node& node = nodes[index];
+            if (!BoxesOverlap(node.box, box)) continue;
+            if (node.count > 0) {
+                UpdateLeaf(index);
+                for (int i = node.first; i < node.first + node.count; i++) {
+                    if (BoxesOverlap(triangleBoxes[i], box) && TriangleBoxIntersect(&triangles[i * 3], boxCenter, boxHalf)) return true;
+                }
+            } else {
+                stack[top++] = node.left;
+                stack[top++] = node.right;
+            }
+        }
+        return false;
+    }
+
+    // czy któryś wierzchołek siatki znajduje się pod płaszczyzną y = height
+    bool BelowPlane(float height) const {
+        if (IsEmpty()) return false;
+        TraversalStack<int, 64> stack(depth + 2);
+        int top = 0;
+        stack[top++] = 0;
+        while (top > 0) {
+            int index = stack[--top];
+            const Node& node = nodes[index];
+            if (node.box.min.y >= height) continue;
+            if (node.count > 0) {
+                UpdateLeaf(index);
+                for (int i = node.first; i < node.first + node.count; i++) {
+                    if (triangleBoxes[i].min.y < height) return true;
+                }
+            } else {
+                stack[top++] = node.left;
+                stack[top++] = node.right;
+            }
+        }
+        return false;
+    }
+};
+
+// Wykrywanie kolizji ramienia z samym sobą, chwytakiem, podłogą i przeszkodami
+// drzewa siatek budowane raz, w każdej klatce dopasowywane do absoluteTransforms
+class CollisionChecker {
+    struct Body {
+        int link;      // indeks macierzy w armTransforms albo deviceTransforms
+        bool device;
+        MeshBVH tree;
+    };
+    std::vector<Body> bodies;
+    int armMeshCount;
+    int lastArmLink;                  // ostatnie ogniwo z siatką - na nim siedzi chwytak
+    std::vector<char> ignoredPairs;   // pary stykające się już w pozycji początkowej
+    std::vector<BoundingBox> obstacles;
+    std::vector<char> colliding;
+    float floorHeight;
+    bool anyCollision;
+    float lastMicroseconds;
+
+    // pary sąsiednich ogniw są połączone przegubem, chwytak siedzi na ostatnim ogniwie
+    bool IsAdjacent(const Body& a, const Body& b) const {
+        if (a.device && b.device) return true;
+        if (!a.device && !b.device) return abs(a.link - b.link) <= 1;
+        const Body& arm = a.device ? b : a;
+        return arm.link >= lastArmLink;
+    }
+
+    bool PairCollides(int i, int j) const {
+        const Body& a = bodies[i];
+        const Body& b = bodies[j];
+        if (a.tree.IsEmpty() || b.tree.IsEmpty()) return false;
+        if (!BoxesOverlap(a.tree.GetBounds(), b.tree.GetBounds())) return false;
+        return a.tree.Intersects(b.tree);
+    }
+
+    // chwytak podświetlany jest w całości, więc kolizja jednej części wystarcza dla pozostałych
+    void MarkColliding(int i) {
+        colliding[i] = 1;
+        if (!bodies[i].device) return;
+        for (size_t j = armMeshCount; j < bodies.size(); j++) colliding[j] = 1;
+    }
+
+public:
+    CollisionChecker() : armMeshCount(0), lastArmLink(0), floorHeight(0), anyCollision(false), lastMicroseconds(0) {}
+
+    // meshLinks - ogniwo każdej siatki ramienia (KinematicChain::meshLinks)
+    void Build(const Model& arm, const Model& device, const int* meshLinks) {
+        armMeshCount = arm.meshCount;
+        lastArmLink = 0;
+        bodies.assign(arm.meshCount + device.meshCount, Body());
+        for (int i = 0; i < arm.meshCount; i++) {
+            bodies[i].link = meshLinks[i];
+            bodies[i].device = false;
+            bodies[i].tree.Build(arm.meshes[i]);
+            lastArmLink = std::max(lastArmLink, meshLinks[i]);
+        }
+        for (int i = 0; i < device.meshCount; i++) {
+            Body& b = bodies[arm.meshCount + i];
+            b.link = i;
+            b.device = true;
+            b.tree.Build(device.meshes[i]);
+        }
+        ignoredPairs.assign(bodies.size() * bodies.size(), 0);
+        colliding.assign(bodies.size(), 0);
+    }
+
+    void AddObstacle(BoundingBox box) {
+        obstacles.push_back(box);
+    }
+
+    const std::vector<BoundingBox>& GetObstacles() const {
+        return obstacles;
+    }
+
+    // pary kolidujące w bieżącej pozycji nie będą zgłaszane (wywoływane w pozycji początkowej)
+    void IgnoreCurrentContacts() {
+        int n = (int)bodies.size();
+        for (int i = 0; i < n; i++) {
+            for (int j = i + 1; j < n; j++) {
+                if (!IsAdjacent(bodies[i], bodies[j]) && PairCollides(i, j)) {
+                    ignoredPairs[i * n + j] = 1;
+                }
+            }
+        }
+    }
+
+    // dopasowanie drzew do położeń ogniw, faza wstępna na prostopadłościanach i dokładna na trójkątach
+    bool Update(const Matrix* armTransforms, const Matrix* deviceTransforms) {
+        auto start = std::chrono::steady_clock::now();
+        int n = (int)bodies.size();
+        for (int i = 0; i < n; i++) {
+            Body& b = bodies[i];
+            b.tree.Refit(b.device ? deviceTransforms[b.link] : armTransforms[b.link]);
+            colliding[i] = 0;
+        }
+
+        for (int i = 0; i < n; i++) {
+            for (int j = i + 1; j < n; j++) {
+                if (IsAdjacent(bodies[i], bodies[j]) || ignoredPairs[i * n + j]) continue;
+                if ((colliding[i] && colliding[j]) || !PairCollides(i, j)) continue;
+                MarkColliding(i);
+                MarkColliding(j);
+            }
+        }
+
+        for (int i = 0; i < n; i++) {
+            const Body& b = bodies[i];
+            if (colliding[i] || b.tree.IsEmpty()) continue;
+            // podstawa stoi na podłodze
+            bool isBase = !b.device && b.link == 0;
+            if (!isBase && b.tree.BelowPlane(floorHeight)) {
+                MarkColliding(i);
+                continue;
+            }
+            for (const BoundingBox& box : obstacles) {
+                if (b.tree.IntersectsBox(box)) {
+                    MarkColliding(i);
+                    break;
+                }
+            }
+        }
+
+        anyCollision = false;
+        for (int i = 0; i < n; i++) anyCollision = anyCollision || colliding[i];
+        lastMicroseconds = std::chrono::duration<float, std::micro>(std::chrono::steady_clock::now() - start).count();
+        return anyCollision;
+    }
+
+    bool IsArmMeshColliding(int mesh) const {
+        return mesh < armMeshCount && colliding[mesh];
+    }
+
+    bool IsDeviceColliding() const {
+        for (size_t i = armMeshCount; i < colliding.size(); i++) {
+            if (colliding[i]) return true;
+        }
+        return false;
+    }
+
+    bool AnyCollision() const {
+        return anyCollision;
+    }
+
+    float GetLastMicroseconds() const {
+        return lastMicroseconds;
+    }
+};
+
 // Symuluje kamerę 3D typu FPS
 class clCamera {
     Camera3D parameters;
@@ -108,6 +1062,7 @@ const char* vertexShaderCode = R"(
     #version 330
     uniform mat4 mvp;
     uniform mat4 matModel;
+    uniform mat4 matNormal; // liczona na CPU raz na ogniwo
     in vec3 vertexPosition;
     in vec3 vertexNormal;
 
@@ -117,7 +1072,7 @@ const char* vertexShaderCode = R"(
     void main()
     {
         fragPos = vec3(matModel * vec4(vertexPosition, 1.0));
-        fragNormal = mat3(transpose(inverse(matModel))) * vertexNormal;
+        fragNormal = mat3(matNormal) * vertexNormal;
         gl_Position = mvp * vec4(vertexPosition, 1.0);
     }
     )";
@@ -142,372 +1097,6651 @@ const char* fragmentShaderCode = R"(
     }
     )";
 
-class Device {
-    Model model;
-    Matrix absoluteTransforms[MAX_JOINT_COUNT];
-    Vector4 DHparameters[MAX_JOINT_COUNT];
-    float offset;
-    Shader& shader;
+// plik zmapowany w pamięci tylko do odczytu
+class MappedFile {
+    const unsigned char* data;
+    size_t size;
+#if defined(_WIN32)
+    void* file;
+    void* mapping;
+#endif
 public:
-    Device(const char* fileName, Shader& shaderRef) : shader(shaderRef) {
-        model = LoadModel(fileName);
-        // nadanie parametrów DH
-        DHparameters[0] = {0, 0, 0, 0};
-        for (int i = 1; i < model.boneCount; i++) {
-            DHparameters[i] = { 0, model.bindPose[i].translation.y - model.bindPose[0].translation.y, model.bindPose[i].translation.x - model.bindPose[0].translation.x, 0};
-        }
-        offset = DHparameters[2].y + DHparameters[1].y;
+    MappedFile() : data(NULL), size(0) {
+#if defined(_WIN32)
+        file = NULL;
+        mapping = NULL;
+#endif
+    }
 
-        absoluteTransforms[0] = MatrixTranslate(model.bindPose[0].translation);
-        for (int i = 1; i < model.boneCount; i++) {
-            absoluteTransforms[i] = MatrixMultiply(DHtoMatrix(DHparameters[i]), absoluteTransforms[i - 1]);
-        }
+    ~MappedFile() {
+        Close();
+    }
 
-        for (int i = 0; i < model.materialCount; i++) {
-            model.materials[i].shader = shader;
+    bool Open(const char* fileName) {
+        Close();
+#if defined(_WIN32)
+        const unsigned long GENERIC_READ_ACCESS = 0x80000000UL, FILE_SHARE_READ_WRITE_MODE = 3, OPEN_EXISTING_FILE = 3, PAGE_READONLY_PROTECT = 2, FILE_MAP_READ_ACCESS = 4;
+        void* invalidHandle = (void*)(long long)-1;
+        file = CreateFileA(fileName, GENERIC_READ_ACCESS, FILE_SHARE_READ_WRITE_MODE, NULL, OPEN_EXISTING_FILE, 0, NULL);
+        if (file == invalidHandle) {
+            file = NULL;
+            return false;
+        }
+        long long length = 0;
+        if (!GetFileSizeEx(file, &length) || length == 0) {
+            Close();
+            return false;
+        }
+        mapping = CreateFileMappingA(file, NULL, PAGE_READONLY_PROTECT, 0, 0, NULL);
+        if (mapping == NULL) {
+            Close();
+            return false;
         }
+        data = (const unsigned char*)MapViewOfFile(mapping, FILE_MAP_READ_ACCESS, 0, 0, 0);
+        size = (size_t)length;
+#else
+        int fd = open(fileName, O_RDONLY);
+        if (fd < 0) return false;
+        struct stat st;
+        if (fstat(fd, &st) != 0 || st.st_size == 0) {
+            close(fd);
+            return false;
+        }
+        void* address = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        close(fd); // mapowanie pozostaje ważne po zamknięciu deskryptora
+        if (address == MAP_FAILED) return false;
+        data = (const unsigned char*)address;
+        size = (size_t)st.st_size;
+#endif
+        if (data == NULL) {
+            Close();
+            return false;
+        }
+        return true;
     }
 
-    ~Device() {
-        UnloadModel(model);
+    void Close() {
+#if defined(_WIN32)
+        if (data != NULL) UnmapViewOfFile(data);
+        if (mapping != NULL) CloseHandle(mapping);
+        if (file != NULL) CloseHandle(file);
+        mapping = NULL;
+        file = NULL;
+#else
+        if (data != NULL) munmap((void*)data, size);
+#endif
+        data = NULL;
+        size = 0;
     }
 
-    void Draw(Color clr, const Camera3D& cam, Shader& shader) {
-         // rysowanie i dodawanie światła
-        Matrix view = MatrixLookAt(cam.position, cam.target, cam.up);
-        Matrix projection = MatrixPerspective(cam.fovy * DEG2RAD, (float)GetScreenWidth() / GetScreenHeight(), 0.01f, 1000.0f);
+    const unsigned char* GetData() const {
+        return data;
+    }
 
-        for (int i = 0; i < model.meshCount; i++) {
-            Matrix mModel = absoluteTransforms[i];
-            Matrix mvp = MatrixMultiply(MatrixMultiply(mModel, view), projection);
-            // shadery
-            SetShaderValue(shader, GetShaderLocation(shader, "mvp"), &mvp, 4);
-            SetShaderValue(shader, GetShaderLocation(shader, "matModel"), &mModel, 4);
+    size_t GetSize() const {
+        return size;
+    }
+};
 
-            Vector3 lightDir = Vector3Normalize({-0.5f, -1.0f, -0.3f});
-            SetShaderValue(shader, GetShaderLocation(shader, "lightDir"), &lightDir, SHADER_UNIFORM_VEC3);
+// binarny obraz modelu: bufory wierzchołków w układzie gotowym do wysłania na GPU i kości, bez parsowania glTF
+// układ: nagłówek, opisy siatek, BoneInfo[boneCount], Transform[boneCount], dane siatek (wyrównane do 16 bajtów)
+#define MODEL_CACHE_VERSION 1
 
-            Vector4 baseColor = { clr.r / 255.0f, clr.g / 255.0f, clr.b / 255.0f, clr.a / 255.0f };
-            SetShaderValue(shader, GetShaderLocation(shader, "baseColor"), &baseColor, SHADER_UNIFORM_VEC4);
+struct ModelCacheHeader {
+    char magic[4];           // "RMC1"
+    int version;
+    long long sourceModTime; // czas modyfikacji pliku .glb, z którego zbudowano obraz
+    long long sourceSize;
+    int meshCount;
+    int boneCount;
+};
 
-            DrawMesh(model.meshes[i], model.materials[model.meshMaterial[i]], mModel);
-        }
+struct MeshCacheEntry {
+    int vertexCount;
+    int triangleCount;
+    long long verticesOffset; // float[3 * vertexCount]
+    long long normalsOffset;  // float[3 * vertexCount] lub 0
+    long long indicesOffset;  // unsigned short[3 * triangleCount] lub 0
+};
+
+inline void GetModelCachePath(const char* fileName, char* path, int size) {
+    // obraz leży obok pliku źródłowego
+    snprintf(path, size, "%s.rmc", fileName);
+}
+
+bool SaveModelCache(const char* fileName, const Model& model) {
+    std::vector<unsigned char> buffer;
+    size_t tableSize = sizeof(ModelCacheHeader) + model.meshCount * sizeof(MeshCacheEntry) + model.boneCount * (sizeof(BoneInfo) + sizeof(Transform));
+    buffer.resize((tableSize + 15) & ~(size_t)15);
+
+    std::vector<MeshCacheEntry> entries(model.meshCount);
+    auto append = [&](const void* src, size_t bytes) -> long long {
+        long long offset = (long long)buffer.size();
+        buffer.insert(buffer.end(), (const unsigned char*)src, (const unsigned char*)src + bytes);
+        buffer.resize((buffer.size() + 15) & ~(size_t)15);
+        return offset;
+    };
+    for (int i = 0; i < model.meshCount; i++) {
+        const Mesh& mesh = model.meshes[i];
+        entries[i].vertexCount = mesh.vertexCount;
+        entries[i].triangleCount = mesh.triangleCount;
+        entries[i].verticesOffset = append(mesh.vertices, mesh.vertexCount * 3 * sizeof(float));
+        entries[i].normalsOffset = (mesh.normals != NULL) ? append(mesh.normals, mesh.vertexCount * 3 * sizeof(float)) : 0;
+        entries[i].indicesOffset = (mesh.indices != NULL) ? append(mesh.indices, mesh.triangleCount * 3 * sizeof(unsigned short)) : 0;
     }
 
-    void MoveJoint(float newValue) {
-         // zmienia rozstaw chwytaka
-        DHparameters[1].y = (offset - newValue) / 2.f;
-        DHparameters[2].y = (offset + newValue) / 2.f;
+    ModelCacheHeader header;
+    memcpy(header.magic, "RMC1", 4);
+    header.version = MODEL_CACHE_VERSION;
+    header.sourceModTime = GetFileModTime(fileName);
+    header.sourceSize = GetFileLength(fileName);
+    header.meshCount = model.meshCount;
+    header.boneCount = model.boneCount;
+    unsigned char* out = buffer.data();
+    memcpy(out, &header, sizeof(header));
+    out += sizeof(header);
+    if (model.meshCount > 0) memcpy(out, entries.data(), model.meshCount * sizeof(MeshCacheEntry));
+    out += model.meshCount * sizeof(MeshCacheEntry);
+    if (model.boneCount > 0) {
+        memcpy(out, model.bones, model.boneCount * sizeof(BoneInfo));
+        out += model.boneCount * sizeof(BoneInfo);
+        memcpy(out, model.bindPose, model.boneCount * sizeof(Transform));
     }
 
-    void UpdateTransforms(Matrix origin) {
-        absoluteTransforms[0] = origin;
-        for (int i = 1; i < model.boneCount; i++) {
-            absoluteTransforms[i] = MatrixMultiply(DHtoMatrix(DHparameters[i]), absoluteTransforms[0]);
-        }
+    char path[512];
+    GetModelCachePath(fileName, path, sizeof(path));
+    return SaveFileData(path, buffer.data(), (int)buffer.size());
+}
+
+bool LoadModelCache(const char* fileName, MappedFile& mapping, Model& model) {
+    // dane wierzchołków i kości wskazują bezpośrednio do zmapowanego pliku
+    char path[512];
+    GetModelCachePath(fileName, path, sizeof(path));
+    if (!FileExists(path) || !mapping.Open(path)) return false;
+    const unsigned char* data = mapping.GetData();
+    size_t size = mapping.GetSize();
+
+    ModelCacheHeader header;
+    if (size < sizeof(header)) return false;
+    memcpy(&header, data, sizeof(header));
+    if (memcmp(header.magic, "RMC1", 4) != 0 || header.version != MODEL_CACHE_VERSION) return false;
+    // plik źródłowy zmieniony - obraz nieaktualny
+    if (header.sourceModTime != GetFileModTime(fileName) || header.sourceSize != GetFileLength(fileName)) return false;
+    size_t tableSize = sizeof(header) + header.meshCount * sizeof(MeshCacheEntry) + header.boneCount * (sizeof(BoneInfo) + sizeof(Transform));
+    if (header.meshCount <= 0 || header.boneCount < 0 || tableSize > size) return false;
+
+    const MeshCacheEntry* entries = (const MeshCacheEntry*)(data + sizeof(header));
+    for (int i = 0; i < header.meshCount; i++) {
+        const MeshCacheEntry& e = entries[i];
+        long long end = e.verticesOffset + (long long)e.vertexCount * 3 * sizeof(float);
+        if (e.normalsOffset != 0) end = std::max(end, e.normalsOffset + (long long)e.vertexCount * 3 * (long long)sizeof(float));
+        if (e.indicesOffset != 0) end = std::max(end, e.indicesOffset + (long long)e.triangleCount * 3 * (long long)sizeof(unsigned short));
+        if (end > (long long)size) return false;
     }
 
-    float GetPosition() {
-        return DHparameters[2].y - DHparameters[1].y;
+    model = Model();
+    model.transform = MatrixIdentity();
+    model.meshCount = header.meshCount;
+    model.meshes = (Mesh*)RL_CALLOC(model.meshCount, sizeof(Mesh));
+    model.materialCount = 1;
+    model.materials = (Material*)RL_CALLOC(1, sizeof(Material));
+    model.materials[0] = LoadMaterialDefault();
+    model.meshMaterial = (int*)RL_CALLOC(model.meshCount, sizeof(int));
+    model.boneCount = header.boneCount;
+    model.bones = (BoneInfo*)(data + sizeof(header) + header.meshCount * sizeof(MeshCacheEntry));
+    model.bindPose = (Transform*)((const unsigned char*)model.bones + header.boneCount * sizeof(BoneInfo));
+    for (int i = 0; i < model.meshCount; i++) {
+        const MeshCacheEntry& e = entries[i];
+        Mesh& mesh = model.meshes[i];
+        mesh.vertexCount = e.vertexCount;
+        mesh.triangleCount = e.triangleCount;
+        mesh.vertices = (float*)(data + e.verticesOffset);
+        mesh.normals = (e.normalsOffset != 0) ? (float*)(data + e.normalsOffset) : NULL;
+        mesh.indices = (e.indicesOffset != 0) ? (unsigned short*)(data + e.indicesOffset) : NULL;
+        UploadMesh(&mesh, false);
+    }
+    return true;
+}
+
+inline void UnloadModelCache(Model model, MappedFile& mapping) {
+    // tablice wskazujące do mapowania nie są zwalniane przez UnloadModel
+    for (int i = 0; i < model.meshCount; i++) {
+        model.meshes[i].vertices = NULL;
+        model.meshes[i].normals = NULL;
+        model.meshes[i].indices = NULL;
     }
+    model.bones = NULL;
+    model.bindPose = NULL;
+    UnloadModel(model);
+    mapping.Close();
+}
+
+// modele wczytywane raz na plik i współdzielone przez wszystkie obiekty, które z nich korzystają
+class ModelLibrary {
+    struct Entry {
+        char fileName[256];
+        Model model;
+        bool fromCache;     // dane w mapowaniu pliku .rmc
+        MappedFile mapping;
+    };
+    std::vector<std::unique_ptr<Entry>> entries;
+    bool useCache;
+    float loadMilliseconds; // łączny czas wczytywania modeli
+public:
+    ModelLibrary() : useCache(true), loadMilliseconds(0) {}
+
+    ~ModelLibrary() {
+        for (size_t i = 0; i < entries.size(); i++) {
+            if (entries[i]->fromCache) UnloadModelCache(entries[i]->model, entries[i]->mapping);
+            else UnloadModel(entries[i]->model);
+        }
+    }
+
+    void SetCacheEnabled(bool enabled) {
+        useCache = enabled;
+    }
+
+    const Model& Get(const char* fileName) {
+        for (size_t i = 0; i < entries.size(); i++) {
+            if (strcmp(entries[i]->fileName, fileName) == 0) return entries[i]->model;
+        }
+        auto start = std::chrono::steady_clock::now();
+        std::unique_ptr<Entry> entry(new Entry());
+        strncpy_s(entry->fileName, sizeof(entry->fileName), fileName, sizeof(entry->fileName) - 1);
+        entry->fromCache = useCache && LoadModelCache(fileName, entry->mapping, entry->model);
+        if (!entry->fromCache) {
+            entry->mapping.Close();
+            entry->model = LoadModel(fileName);
+            // obraz budowany przy pierwszym wczytaniu i po każdej zmianie pliku .glb
+            if (useCache && entry->model.meshCount > 0) SaveModelCache(fileName, entry->model);
+        }
+        float ms = std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - start).count();
+        loadMilliseconds += ms;
+        TraceLog(LOG_INFO, "MODEL CACHE: %s wczytany %s w %.2f ms", fileName, entry->fromCache ? "z obrazu .rmc" : "z pliku glTF", ms);
+        entries.push_back(std::move(entry));
+        return entries.back()->model;
+    }
+
+    int GetCount() {
+        return (int)entries.size();
+    }
+
+    float GetLoadMilliseconds() {
+        return loadMilliseconds;
+    }
+};
+
+// stan renderowania: lokalizacje uniformów pobierane raz przy wczytaniu shadera,
+// uniformy wspólne dla klatki wysyłane raz w BeginFrame
+class RenderState {
+    Shader shader;
+    int locMvp, locModel, locNormal, locLightDir, locBaseColor;
+    Matrix viewProjection;
+    Vector4 lastColor;
+    bool colorValid; // czy lastColor jest już w shaderze
+    int drawCalls, uniformUploads;
+public:
+    RenderState(Shader s) : shader(s) {
+        // LoadShader wypełnia locs dla standardowych nazw (mvp, matModel, matNormal)
+        locMvp = shader.locs[SHADER_LOC_MATRIX_MVP];
+        locModel = shader.locs[SHADER_LOC_MATRIX_MODEL];
+        locNormal = shader.locs[SHADER_LOC_MATRIX_NORMAL];
+        locLightDir = GetShaderLocation(shader, "lightDir");
+        locBaseColor = GetShaderLocation(shader, "baseColor");
+        viewProjection = MatrixIdentity();
+        colorValid = false;
+        drawCalls = 0;
+        uniformUploads = 0;
+    }
+
+    void BeginFrame(const Camera3D& cam) {
+        // macierze kamery i kierunek światła są stałe w obrębie klatki
+        Matrix view = MatrixLookAt(cam.position, cam.target, cam.up);
+        Matrix projection = MatrixPerspective(cam.fovy * DEG2RAD, (float)GetScreenWidth() / GetScreenHeight(), 0.01f, 1000.0f);
+        viewProjection = MatrixMultiply(view, projection);
+
+        rlDrawRenderBatchActive(); // najpierw to, co rlgl ma już w buforze (siatka, osie)
+        rlEnableShader(shader.id);
+        Vector3 lightDir = Vector3Normalize({-0.5f, -1.0f, -0.3f});
+        rlSetUniform(locLightDir, &lightDir, SHADER_UNIFORM_VEC3, 1);
+        colorValid = false;
+        drawCalls = 0;
+        uniformUploads = 1;
+    }
+
+    void EndFrame() {
+        rlDisableVertexArray();
+        rlDisableShader();
+    }
+
+    void SetColor(Color clr) {
+        // kolor wysyłany tylko przy zmianie
+        Vector4 baseColor = { clr.r / 255.0f, clr.g / 255.0f, clr.b / 255.0f, clr.a / 255.0f };
+        if (colorValid && baseColor.x == lastColor.x && baseColor.y == lastColor.y &&
+            baseColor.z == lastColor.z && baseColor.w == lastColor.w) return;
+        rlSetUniform(locBaseColor, &baseColor, SHADER_UNIFORM_VEC4, 1);
+        lastColor = baseColor;
+        colorValid = true;
+        uniformUploads++;
+    }
+
+    void DrawLink(const Mesh& mesh, const Matrix& transform) {
+        // jedna siatka ogniwa: mvp i macierz normalnych liczone raz na ogniwo
+        Matrix mvp = MatrixMultiply(transform, viewProjection);
+        rlSetUniformMatrix(locMvp, mvp);
+        rlSetUniformMatrix(locModel, transform);
+        rlSetUniformMatrix(locNormal, MatrixTranspose(MatrixInvert(transform)));
+        uniformUploads += 3;
+
+        if (!rlEnableVertexArray(mesh.vaoId)) {
+            // brak VAO - ścieżka raylib (sama ustawia atrybuty)
+            Material material = LoadMaterialDefault();
+            material.shader = shader;
+            DrawMesh(mesh, material, transform);
+            RL_FREE(material.maps);
+            rlEnableShader(shader.id);
+        }
+        else {
+            if (mesh.indices != NULL) rlDrawVertexArrayElements(0, mesh.triangleCount * 3, 0);
+            else rlDrawVertexArray(0, mesh.vertexCount);
+            rlDisableVertexArray();
+        }
+        drawCalls++;
+    }
+
+    int GetDrawCalls() {
+        return drawCalls;
+    }
+
+    int GetUniformUploads() {
+        return uniformUploads;
+    }
+};
+
+// shadery skinningu: cały robot (ramię + chwytak) w jednym wywołaniu rysowania,
+// każdy wierzchołek niesie numer kości, a macierze kości idą jedną tablicą uniformów (trzy wiersze na kość -
+// macierze DH są afiniczne, ostatni wiersz to zawsze 0 0 0 1)
+#define MAX_SKIN_BONES 32
+#define SKIN_BONE_ATTRIB_LOCATION 6 // stała lokalizacja, żeby kilka shaderów mogło używać tego samego VAO
+
+const char* skinnedVertexShaderCode = R"(
+    #version 330
+    uniform mat4 viewProjection;
+    uniform vec4 bones[96];      // MAX_SKIN_BONES * 3 wiersze
+    uniform vec4 boneColors[32];
+    in vec3 vertexPosition;
+    in vec3 vertexNormal;
+    layout(location = 6) in float vertexBoneId; // SKIN_BONE_ATTRIB_LOCATION
+
+    out vec3 fragNormal;
+    out vec4 fragColor;
+
+    void main()
+    {
+        int bone = int(vertexBoneId + 0.5);
+        mat4 m = transpose(mat4(bones[bone * 3], bones[bone * 3 + 1], bones[bone * 3 + 2], vec4(0.0, 0.0, 0.0, 1.0)));
+        // macierze DH są sztywne, więc macierz normalnych to sama rotacja
+        fragNormal = mat3(m) * vertexNormal;
+        fragColor = boneColors[bone];
+        gl_Position = viewProjection * m * vec4(vertexPosition, 1.0);
+    }
+    )";
+
+const char* skinnedFragmentShaderCode = R"(
+    #version 330
+    in vec3 fragNormal;
+    in vec4 fragColor;
+
+    uniform vec3 lightDir; // should be normalized
+
+    out vec4 finalColor;
+
+    void main()
+    {
+        vec3 norm = normalize(fragNormal);
+        float diff = max(dot(norm, -lightDir), 0.0);
+        vec3 diffuse = diff * fragColor.rgb;
+        vec3 ambient = 0.2 * fragColor.rgb;
+        finalColor = vec4(diffuse + ambient, fragColor.a);
+    }
+    )";
+
+class SkinnedRenderer {
+    Shader shader;
+    int locViewProjection, locLightDir, locBoneColors;
+    int locBones;
+    int locPosition, locNormal, locBoneId;
+    unsigned int vao, vboPosition, vboNormal, vboBoneId;
+    int vertexCount;
+    int armBoneCount, deviceBoneCount;
+    bool ready;
+    int drawCalls, uniformUploads; // ostatnie rysowanie (nakładka profilera)
+
+    static void AppendMesh(const Mesh& mesh, float bone, std::vector<float>& positions, std::vector<float>& normals, std::vector<float>& boneIds) {
+        // siatka rozwijana do listy trójkątów - indeksy rlgl są 16-bitowe, a scalony bufor może je przekroczyć
+        int count = (mesh.indices != NULL) ? mesh.triangleCount * 3 : mesh.vertexCount;
+        for (int t = 0; t + 2 < count; t += 3) {
+            int idx[3];
+            for (int k = 0; k < 3; k++) idx[k] = (mesh.indices != NULL) ? mesh.indices[t + k] : t + k;
+            Vector3 v[3];
+            for (int k = 0; k < 3; k++) v[k] = { mesh.vertices[idx[k] * 3], mesh.vertices[idx[k] * 3 + 1], mesh.vertices[idx[k] * 3 + 2] };
+            Vector3 face = Vector3Normalize(Vector3CrossProduct(Vector3Subtract(v[1], v[0]), Vector3Subtract(v[2], v[0])));
+            for (int k = 0; k < 3; k++) {
+                positions.push_back(v[k].x);
+                positions.push_back(v[k].y);
+                positions.push_back(v[k].z);
+                if (mesh.normals != NULL) {
+                    normals.push_back(mesh.normals[idx[k] * 3]);
+                    normals.push_back(mesh.normals[idx[k] * 3 + 1]);
+                    normals.push_back(mesh.normals[idx[k] * 3 + 2]);
+                }
+                else {
+                    normals.push_back(face.x);
+                    normals.push_back(face.y);
+                    normals.push_back(face.z);
+                }
+                boneIds.push_back(bone);
+            }
+        }
+    }
+
+public:
+    SkinnedRenderer() {
+        vao = vboPosition = vboNormal = vboBoneId = 0;
+        vertexCount = 0;
+        armBoneCount = deviceBoneCount = 0;
+        ready = false;
+        drawCalls = uniformUploads = 0;
+        shader = LoadShaderFromMemory(skinnedVertexShaderCode, skinnedFragmentShaderCode);
+        locViewProjection = GetShaderLocation(shader, "viewProjection");
+        locLightDir = GetShaderLocation(shader, "lightDir");
+        locBoneColors = GetShaderLocation(shader, "boneColors");
+        locBones = GetShaderLocation(shader, "bones");
+        locPosition = rlGetLocationAttrib(shader.id, "vertexPosition");
+        locNormal = rlGetLocationAttrib(shader.id, "vertexNormal");
+        locBoneId = rlGetLocationAttrib(shader.id, "vertexBoneId");
+    }
+
+    ~SkinnedRenderer() {
+        if (vao != 0) {
+            rlUnloadVertexArray(vao);
+            rlUnloadVertexBuffer(vboPosition);
+            rlUnloadVertexBuffer(vboNormal);
+            rlUnloadVertexBuffer(vboBoneId);
+        }
+        UnloadShader(shader);
+    }
+
+    bool Build(const Model& arm, const Model& device) {
+        // scalenie siatek ramienia i chwytaka w jeden bufor; kość = numer siatki
+        ready = false;
+        if (shader.id == rlGetShaderIdDefault() || locBoneId < 0) return false;
+        if (arm.meshCount + device.meshCount > MAX_SKIN_BONES) return false;
+
+        std::vector<float> positions, normals, boneIds;
+        for (int i = 0; i < arm.meshCount; i++) {
+            AppendMesh(arm.meshes[i], (float)i, positions, normals, boneIds);
+        }
+        for (int i = 0; i < device.meshCount; i++) {
+            AppendMesh(device.meshes[i], (float)(arm.meshCount + i), positions, normals, boneIds);
+        }
+        armBoneCount = arm.meshCount;
+        deviceBoneCount = device.meshCount;
+        vertexCount = (int)boneIds.size();
+        if (vertexCount == 0) return false;
+
+        vao = rlLoadVertexArray();
+        if (vao == 0) return false;
+        rlEnableVertexArray(vao);
+        vboPosition = rlLoadVertexBuffer(positions.data(), (int)(positions.size() * sizeof(float)), false);
+        rlSetVertexAttribute(locPosition, 3, RL_FLOAT, false, 0, 0);
+        rlEnableVertexAttribute(locPosition);
+        vboNormal = rlLoadVertexBuffer(normals.data(), (int)(normals.size() * sizeof(float)), false);
+        if (locNormal >= 0) {
+            rlSetVertexAttribute(locNormal, 3, RL_FLOAT, false, 0, 0);
+            rlEnableVertexAttribute(locNormal);
+        }
+        vboBoneId = rlLoadVertexBuffer(boneIds.data(), (int)(boneIds.size() * sizeof(float)), false);
+        rlSetVertexAttribute(locBoneId, 1, RL_FLOAT, false, 0, 0);
+        rlEnableVertexAttribute(locBoneId);
+        rlDisableVertexArray();
+
+        ready = true;
+        return true;
+    }
+
+    bool IsReady() {
+        return ready;
+    }
+
+    unsigned int GetVertexArray() const {
+        return vao;
+    }
+
+    int GetVertexCount() const {
+        return vertexCount;
+    }
+
+    int GetArmBoneCount() const {
+        return armBoneCount;
+    }
+
+    int GetDeviceBoneCount() const {
+        return deviceBoneCount;
+    }
+
+    void Draw(const Camera3D& cam, const Matrix* armTransforms, const Matrix* deviceTransforms, const Color* colors) {
+        // jedno wywołanie rysowania dla całego robota; colors: najpierw ogniwa ramienia, potem chwytak
+        drawCalls = uniformUploads = 0;
+        if (!ready) return;
+        Matrix view = MatrixLookAt(cam.position, cam.target, cam.up);
+        Matrix projection = MatrixPerspective(cam.fovy * DEG2RAD, (float)GetScreenWidth() / GetScreenHeight(), 0.01f, 1000.0f);
+        Vector3 lightDir = Vector3Normalize({-0.5f, -1.0f, -0.3f});
+        Vector4 boneColors[MAX_SKIN_BONES];
+        Vector4 boneRows[MAX_SKIN_BONES * 3];
+        int boneCount = armBoneCount + deviceBoneCount;
+        for (int i = 0; i < boneCount; i++) {
+            boneColors[i] = { colors[i].r / 255.0f, colors[i].g / 255.0f, colors[i].b / 255.0f, colors[i].a / 255.0f };
+            const Matrix& m = (i < armBoneCount) ? armTransforms[i] : deviceTransforms[i - armBoneCount];
+            boneRows[i * 3] = { m.m0, m.m4, m.m8, m.m12 };
+            boneRows[i * 3 + 1] = { m.m1, m.m5, m.m9, m.m13 };
+            boneRows[i * 3 + 2] = { m.m2, m.m6, m.m10, m.m14 };
+        }
+
+        rlDrawRenderBatchActive();
+        rlEnableShader(shader.id);
+        rlSetUniformMatrix(locViewProjection, MatrixMultiply(view, projection));
+        rlSetUniform(locLightDir, &lightDir, SHADER_UNIFORM_VEC3, 1);
+        rlSetUniform(locBoneColors, boneColors, SHADER_UNIFORM_VEC4, boneCount);
+        rlSetUniform(locBones, boneRows, SHADER_UNIFORM_VEC4, boneCount * 3);
+        rlEnableVertexArray(vao);
+        rlDrawVertexArray(0, vertexCount);
+        rlDisableVertexArray();
+        rlDisableShader();
+        drawCalls = 1;
+        uniformUploads = 4;
+    }
+
+    int GetDrawCalls() const {
+        return drawCalls;
+    }
+
+    int GetUniformUploads() const {
+        return uniformUploads;
+    }
+};
+
+// palce chwytaka: parametry DH względem kołnierza wyznaczone z pozycji spoczynkowej kości modelu
+struct GripperChain {
+    int linkCount;
+    Vector4 DHparameters[MAX_JOINT_COUNT];
+    float offset; // suma przesunięć palców, rozstaw dzieli ją na dwa palce
+};
+
+GripperChain GripperChainFromModel(const Model& model) {
+    GripperChain chain;
+    chain.linkCount = model.boneCount;
+    chain.DHparameters[0] = { 0, 0, 0, 0 };
+    for (int i = 1; i < model.boneCount; i++) {
+        chain.DHparameters[i] = { 0, model.bindPose[i].translation.y - model.bindPose[0].translation.y, model.bindPose[i].translation.x - model.bindPose[0].translation.x, 0 };
+    }
+    chain.offset = chain.DHparameters[2].y + chain.DHparameters[1].y;
+    return chain;
+}
+
+// macierze palców dla rozstawu opening przy kołnierzu w origin
+void GripperTransforms(const GripperChain& chain, float opening, Matrix origin, Matrix* out) {
+    Vector4 DH[MAX_JOINT_COUNT];
+    for (int i = 1; i < chain.linkCount; i++) DH[i] = chain.DHparameters[i];
+    DH[1].y = (chain.offset - opening) / 2.f;
+    DH[2].y = (chain.offset + opening) / 2.f;
+    out[0] = origin;
+    for (int i = 1; i < chain.linkCount; i++) {
+        out[i] = MatrixMultiply(DHtoMatrix(DH[i]), origin);
+    }
+}
+
+class Device {
+    Model model;
+    Matrix absoluteTransforms[MAX_JOINT_COUNT];
+    Matrix localTransforms[MAX_JOINT_COUNT]; // zapamiętane macierze DH poszczególnych palców
+    GripperChain chain;
+    bool dirty; // rozstaw zmienił się od ostatniego przeliczenia
+    Shader& shader;
+public:
+    Device(ModelLibrary& library, const char* fileName, Shader& shaderRef) : shader(shaderRef) {
+        model = library.Get(fileName); // model należy do biblioteki
+        chain = GripperChainFromModel(model);
+
+        absoluteTransforms[0] = MatrixTranslate(model.bindPose[0].translation);
+        for (int i = 1; i < model.boneCount; i++) {
+            localTransforms[i] = DHtoMatrix(chain.DHparameters[i]);
+            absoluteTransforms[i] = MatrixMultiply(localTransforms[i], absoluteTransforms[i - 1]);
+        }
+        dirty = false;
+
+        for (int i = 0; i < model.materialCount; i++) {
+            model.materials[i].shader = shader;
+        }
+    }
+
+    // rysowanie w podanych macierzach palców (migawka z wątku sterowania)
+    void Draw(Color clr, const Matrix* transforms, RenderState& render) {
+        render.SetColor(clr);
+        for (int i = 0; i < model.meshCount; i++) {
+            render.DrawLink(model.meshes[i], transforms[i]);
+        }
+    }
+
+    void MoveJoint(float newValue) {
+         // zmienia rozstaw chwytaka, macierze przeliczane są dopiero w UpdateTransforms
+        chain.DHparameters[1].y = (chain.offset - newValue) / 2.f;
+        chain.DHparameters[2].y = (chain.offset + newValue) / 2.f;
+        dirty = true;
+    }
+
+    void UpdateTransforms(Matrix origin) {
+        absoluteTransforms[0] = origin;
+        if (dirty) {
+            for (int i = 1; i < model.boneCount; i++) {
+                localTransforms[i] = DHtoMatrix(chain.DHparameters[i]);
+            }
+            dirty = false;
+        }
+        for (int i = 1; i < model.boneCount; i++) {
+            absoluteTransforms[i] = MatrixMultiply(localTransforms[i], absoluteTransforms[0]);
+        }
+    }
+
+    void ComputeTransforms(float opening, Matrix origin, Matrix* out) const {
+        // macierze palców dla dowolnego rozstawu, bez zmiany stanu chwytaka (podgląd trajektorii)
+        GripperTransforms(chain, opening, origin, out);
+    }
+
+    bool IsDirty() {
+        return dirty;
+    }
+
+    const Model& GetModel() const {
+        return model;
+    }
+
+    const Matrix* GetTransforms() {
+        return absoluteTransforms;
+    }
+
+    float GetPosition() {
+        return chain.DHparameters[2].y - chain.DHparameters[1].y;
+    }
+
+    int GetBoneCount() {
+        return model.boneCount;
+    }
+};
+
+// czy kości modelu mają układ PUMA: pięć kości, kolumna na osi Y, bark (kość 2) w miejscu kości 1
+bool IsPumaSkeleton(const Model& model) {
+    if (model.boneCount != 5) return false;
+    const float eps = 0.01f;
+    for (int i = 1; i < 4; i++) {
+        Vector3 d = Vector3Subtract(model.bindPose[i].translation, model.bindPose[0].translation);
+        if (fabsf(d.x) > eps || fabsf(d.z) > eps) return false;
+    }
+    return Vector3Distance(model.bindPose[2].translation, model.bindPose[1].translation) < eps;
+}
+
+// łańcuch DH ramienia wyznaczony z pozycji spoczynkowej kości modelu; wiersze PUMA tylko dla szkieletu PUMA,
+// inne modele dostają łańcuch obrotów wokół osi Y z przesunięciami kości (jak palce chwytaka)
+KinematicChain ArmChainFromModel(const Model& model) {
+    KinematicChain chain;
+    chain.linkCount = model.boneCount;
+    chain.base = MatrixTranslate(model.bindPose[0].translation);
+    for (int i = 0; i < model.boneCount; i++) {
+        chain.jointTypes[i] = REVOLUTE;
+    }
+    chain.jointTypes[model.boneCount - 1] = MANIPULATOR;
+    // nadanie parametrów DH
+    chain.DHparameters[0] = { 0, 0, 0, 0 };
+    if (IsPumaSkeleton(model)) {
+        chain.DHparameters[1] = { 0,model.bindPose[1].translation.y - model.bindPose[0].translation.y,0,0 };
+        chain.DHparameters[2] = { 0, 0,0 , 90 * DEG2RAD };
+        chain.DHparameters[3] = { 0, 0, model.bindPose[3].translation.y - model.bindPose[2].translation.y, 0 };
+        chain.DHparameters[4] = { 0, model.bindPose[4].translation.x - model.bindPose[3].translation.x, model.bindPose[4].translation.y - model.bindPose[3].translation.y, 0 };
+    }
+    else {
+        TraceLog(LOG_WARNING, "ROBOT: model (%d kosci) nie ma ukladu PUMA, osie zlaczy przyjete pionowo - dodaj plik .robot", model.boneCount);
+        for (int i = 1; i < model.boneCount; i++) {
+            Vector3 d = Vector3Subtract(model.bindPose[i].translation, model.bindPose[i - 1].translation);
+            chain.DHparameters[i] = { 0, d.y, d.x, 0 };
+        }
+    }
+    SetDefaultChainLimits(chain, model.meshCount);
+    return chain;
+}
+
+// kolejne słowo wiersza (zakończone zerem w miejscu separatora); NULL na końcu wiersza
+char* NextWord(char*& p) {
+    while (*p == ' ' || *p == '\t' || *p == '\r') p++;
+    if (*p == '\0') return NULL;
+    char* word = p;
+    while (*p != '\0' && *p != ' ' && *p != '\t' && *p != '\r') p++;
+    if (*p != '\0') *p++ = '\0';
+    return word;
+}
+
+// Opis robota - plik tekstowy, jeden wpis na wiersz, '#' zaczyna komentarz:
+//   base x y z                                   położenie podstawy (ogniwo 0)
+//   link typ theta d a alfa min maks v a j       kolejne ogniwo: typ revolute/prismatic/manipulator, kąty w stopniach,
+//                                                zakres nastawy złącza, dopuszczalna prędkość, przyspieszenie i zryw
+//   mesh siatka ogniwo                           siatka modelu rysowana z ogniwem (domyślnie siatka i z ogniwem i)
+// Ostatnie ogniwo to chwytak (manipulator), liczba ogniw równa liczbie kości modelu.
+bool ParseRobotDescription(char* text, const Model& model, const char* fileName, KinematicChain& chain) {
+    chain.linkCount = 1;
+    chain.base = MatrixIdentity();
+    chain.DHparameters[0] = { 0, 0, 0, 0 };
+    chain.jointTypes[0] = REVOLUTE; // podstawa nie ma złącza
+    SetDefaultChainLimits(chain, model.meshCount);
+    if (model.meshCount > MAX_JOINT_COUNT) {
+        TraceLog(LOG_ERROR, "ROBOT: %s: model ma %d siatek, obslugiwane %d", fileName, model.meshCount, MAX_JOINT_COUNT);
+        return false;
+    }
+    const char* types[] = { "revolute", "prismatic", "manipulator" };
+    int meshLimit = (model.meshCount > 0) ? model.meshCount : MAX_JOINT_COUNT; // sam szkielet (LoadSkeleton) nie ma siatek
+    int lineNumber = 0;
+    char* line = text;
+    while (line != NULL && *line != '\0') {
+        lineNumber++;
+        char* next = strchr(line, '\n');
+        if (next != NULL) *next++ = '\0';
+        char* comment = strchr(line, '#');
+        if (comment != NULL) *comment = '\0';
+
+        char* p = line;
+        line = next;
+        char* key = NextWord(p);
+        if (key == NULL) continue;
+        char* typeName = (strcmp(key, "link") == 0) ? NextWord(p) : NULL;
+        float v[10];
+        int count = 0;
+        for (char* word = NextWord(p); word != NULL && count < 10; word = NextWord(p)) {
+            char* end;
+            v[count] = strtof(word, &end);
+            if (*end != '\0') break;
+            count++;
+        }
+        if (NextWord(p) != NULL) count = -1; // niepoprawna liczba albo nadmiarowe pola
+
+        if (strcmp(key, "base") == 0 && count == 3) {
+            chain.base = MatrixTranslate(v[0], v[1], v[2]);
+        }
+        else if (typeName != NULL && count == 9 && chain.linkCount < MAX_JOINT_COUNT) {
+            int i = chain.linkCount;
+            int type = -1;
+            for (int t = 0; t < 3; t++) {
+                if (strcmp(typeName, types[t]) == 0) type = t;
+            }
+            if (type < 0 || v[4] > v[5] || v[6] <= 0 || v[7] <= 0 || v[8] <= 0) {
+                TraceLog(LOG_ERROR, "ROBOT: %s:%d: bledny typ ogniwa, zakres albo ograniczenia ruchu", fileName, lineNumber);
+                return false;
+            }
+            chain.jointTypes[i] = (JointType)type;
+            chain.DHparameters[i] = { v[0] * DEG2RAD, v[1], v[2], v[3] * DEG2RAD };
+            chain.minLimits[i] = v[4];
+            chain.maxLimits[i] = v[5];
+            chain.motionLimits[i] = { v[6], v[7], v[8] };
+            chain.linkCount++;
+        }
+        else if (strcmp(key, "mesh") == 0 && count == 2) {
+            int mesh = (int)v[0], link = (int)v[1];
+            if (mesh < 0 || mesh >= meshLimit || link < 0 || link >= model.boneCount) {
+                TraceLog(LOG_ERROR, "ROBOT: %s:%d: siatka %d albo ogniwo %d poza modelem", fileName, lineNumber, mesh, link);
+                return false;
+            }
+            chain.meshLinks[mesh] = link;
+        }
+        else {
+            TraceLog(LOG_ERROR, "ROBOT: %s:%d: nieznany wpis albo zla liczba pol", fileName, lineNumber);
+            return false;
+        }
+    }
+
+    // chwytak zamyka łańcuch, kości modelu odpowiadają ogniwom
+    bool ok = chain.linkCount == model.boneCount && chain.linkCount > 2 && chain.jointTypes[chain.linkCount - 1] == MANIPULATOR;
+    for (int i = 1; i < chain.linkCount - 1; i++) ok = ok && chain.jointTypes[i] != MANIPULATOR;
+    if (!ok) TraceLog(LOG_ERROR, "ROBOT: %s: %d ogniw (model %d kosci), chwytak musi byc ostatnim ogniwem", fileName, chain.linkCount, model.boneCount);
+    return ok;
+}
+
+// łańcuch robota z pliku opisu obok modelu (models/robots/puma.glb -> models/robots/puma.robot),
+// a gdy go nie ma albo jest błędny - z kości modelu
+KinematicChain LoadArmChain(const Model& model, const char* modelFile) {
+    char path[300];
+    _snprintf_s(path, sizeof(path) - 1, "%s/%s.robot", GetDirectoryPath(modelFile), GetFileNameWithoutExt(modelFile));
+    if (FileExists(path)) {
+        KinematicChain chain;
+        char* text = LoadFileText(path);
+        bool ok = text != NULL && ParseRobotDescription(text, model, path, chain);
+        UnloadFileText(text);
+        if (ok) return chain;
+        TraceLog(LOG_WARNING, "ROBOT: %s: opis pominiety, lancuch z kosci modelu", path);
+    }
+    return ArmChainFromModel(model);
+}
+
+// stan ramienia do rysowania: macierze ogniw i palców oraz kolizje, z jednego kroku sterowania
+struct ArmSnapshot {
+    Matrix links[MAX_JOINT_COUNT];
+    Matrix device[MAX_JOINT_COUNT];
+    bool colliding[MAX_JOINT_COUNT + 1]; // indeks meshCount - chwytak
+    long long tick;                      // numer kroku sterowania
+};
+
+// potrójny bufor bez blokad: jeden wątek pisze do tylnego bufora i publikuje go, drugi czyta ostatni opublikowany.
+// Bufory zamieniane są przez wymianę indeksu środkowego, więc żaden wątek nie czeka, a czytelnik zawsze
+// dostaje kompletny stan (pisarz nigdy nie dotyka bufora, który trzyma czytelnik).
+template <typename T>
+class TripleBuffer {
+    static const int FRESH = 4; // środkowy bufor opublikowany po ostatnim odczycie
+    T buffers[3];
+    std::atomic<int> middle;
+    int back;  // należy do pisarza
+    int front; // należy do czytelnika
+public:
+    TripleBuffer() : middle(1), back(0), front(2) {}
+
+    T& Back() {
+        return buffers[back];
+    }
+
+    void Publish() {
+        back = middle.exchange(back | FRESH, std::memory_order_acq_rel) & 3;
+    }
+
+    // najnowszy opublikowany stan (ten sam co poprzednio, gdy nic nowego nie przyszło)
+    const T& Acquire() {
+        if (middle.load(std::memory_order_relaxed) & FRESH) {
+            front = middle.exchange(front, std::memory_order_acq_rel) & 3;
+        }
+        return buffers[front];
+    }
+};
+
+class RobotArm {
+    Device* device;
+    Model model;
+    Matrix absoluteTransforms[MAX_JOINT_COUNT];
+    CompiledChain compiled;                  // łańcuch skompilowany raz przy wczytaniu (nastawy w stopniach)
+    float jointValues[MAX_JOINT_COUNT];      // bieżące nastawy złączy (stopnie lub jednostki długości)
+    float jointSteps[MAX_JOINT_COUNT];       // krok ruchu dyskretnego złącza
+    int manipulator;                         // ogniwo chwytaka (nastawa idzie do urządzenia), -1 gdy brak
+    int dirtyFrom;                           // najniższe zmienione ogniwo (boneCount gdy brak zmian)
+    KinematicChain description;              // łańcuch w pozycji spoczynkowej, zakresy i przypisanie siatek
+    float targetPositions[MAX_JOINT_COUNT];
+    InverseKinematics ik;
+    CollisionChecker collision;
+    JointMotionLimits motionLimits[MAX_JOINT_COUNT];
+    Shader& shader;
+public:
+    RobotArm(ModelLibrary& library, const char* fileName, Device& d, Shader& shaderRef) : shader(shaderRef) {
+        LoadRobotModel(library, fileName);
+
+        device = &d;
+        device->UpdateTransforms(absoluteTransforms[model.boneCount - 1]);
+        targetPositions[model.boneCount - 1] = GetJointPosition(model.boneCount - 1);
+
+        collision.Build(model, device->GetModel(), description.meshLinks);
+        collision.Update(absoluteTransforms, device->GetTransforms());
+        collision.IgnoreCurrentContacts();
+        collision.Update(absoluteTransforms, device->GetTransforms());
+    }
+
+    void LoadRobotModel(ModelLibrary& library, const char* fileName) {
+        model = library.Get(fileName);  // wczytywanie modelu (raz na plik)
+        
+        description = LoadArmChain(model, fileName);
+        const KinematicChain& chain = description;
+        compiled = CompileChain(chain, DEG2RAD);
+        manipulator = ManipulatorJoint(chain);
+        if (manipulator >= 0) manipulator++;
+        // nastawy początkowe z parametrów DH; rodzaj złącza potrzebny tylko tutaj
+        for (int i = 0; i < model.boneCount; i++) {
+            jointValues[i] = 0;
+            jointSteps[i] = 0.05f;
+            if (chain.jointTypes[i] == REVOLUTE) {
+                jointValues[i] = chain.DHparameters[i].x * RAD2DEG;
+                jointSteps[i] = 5;
+            }
+            else if (chain.jointTypes[i] == PRISMATIC) {
+                jointValues[i] = chain.DHparameters[i].y;
+                jointSteps[i] = 0.1f;
+            }
+        }
+        for (int i = 1; i < model.boneCount; i++) {
+            motionLimits[i] = chain.motionLimits[i];
+        }
+
+        absoluteTransforms[0] = chain.base;
+        for (int i = 1; i < model.boneCount; i++) {
+            absoluteTransforms[i] = ComposeLink(compiled.links[i], jointValues[i], absoluteTransforms[i - 1]);
+        }
+        dirtyFrom = model.boneCount;
+
+        for (int i = 0; i < model.materialCount; i++) {
+            model.materials[i].shader = shader;
+        }
+
+        for (int i = 0; i < model.boneCount - 1; i++) {
+            targetPositions[i] = GetJointPosition(i);
+        }
+        ik.SetChain(GetKinematicChain());
+    }
+
+    Color GetLinkColor(const ArmSnapshot& pose, int i, int selection) {
+        // ogniwo i == meshCount oznacza chwytak
+        Color clr = (i == selection) ? YELLOW : WHITE; //zaznaczenie kolorem wybranego przegubu
+        if (pose.colliding[i]) clr = RED; // ogniwo w kolizji
+        return clr;
+    }
+
+    // zapis stanu do rysowania; wywoływane przez wątek sterowania po kroku
+    void Publish(ArmSnapshot& pose) {
+        memcpy(pose.links, absoluteTransforms, sizeof(Matrix) * model.boneCount);
+        memcpy(pose.device, device->GetTransforms(), sizeof(Matrix) * device->GetBoneCount());
+        for (int i = 0; i < model.meshCount; i++) pose.colliding[i] = collision.IsArmMeshColliding(i);
+        pose.colliding[model.meshCount] = collision.IsDeviceColliding();
+    }
+
+    // rysowanie robota wraz z shaderami; tylko dane modelu (stałe) i migawka, bez stanu sterowania
+    void Draw(const ArmSnapshot& pose, int selection, RenderState& render) {
+        for (int i = 0; i < model.meshCount; i++) {
+            render.SetColor(GetLinkColor(pose, i, selection));
+            render.DrawLink(model.meshes[i], pose.links[description.meshLinks[i]]);
+        }
+        device->Draw(GetLinkColor(pose, model.meshCount, selection), pose.device, render);
+    }
+
+    void DrawSkinned(const ArmSnapshot& pose, int selection, SkinnedRenderer& renderer, const Camera3D& cam) {
+        // cały robot jednym wywołaniem rysowania
+        Color colors[MAX_SKIN_BONES];
+        int count = 0;
+        for (int i = 0; i < model.meshCount && count < MAX_SKIN_BONES; i++) colors[count++] = GetLinkColor(pose, i, selection);
+        Color deviceColor = GetLinkColor(pose, model.meshCount, selection);
+        while (count < MAX_SKIN_BONES) colors[count++] = deviceColor;
+        Matrix meshTransforms[MAX_JOINT_COUNT]; // kość siatki - macierz jej ogniwa
+        for (int i = 0; i < model.meshCount; i++) meshTransforms[i] = pose.links[description.meshLinks[i]];
+        renderer.Draw(cam, meshTransforms, pose.device, colors);
+    }
+
+    const Model& GetModel() {
+        return model;
+    }
+
+    void MoveJoint(int selection, float newValue) {
+        // aktualizacja pozycji przegubów, łańcuch przeliczany jest dopiero w UpdateKinematics
+        if (selection == manipulator) {
+            if (device) device->MoveJoint(newValue);
+            return;
+        }
+        jointValues[selection] = newValue;
+        if (selection < dirtyFrom) dirtyFrom = selection;
+    }
+
+    void UpdateKinematics() {
+        // przeliczenie łańcucha tylko od najniższego zmienionego ogniwa w dół
+        int flange = model.boneCount - 1;
+        bool flangeMoved = false;
+        for (int i = (dirtyFrom < 1) ? 1 : dirtyFrom; i < model.boneCount; i++) {
+            absoluteTransforms[i] = ComposeLink(compiled.links[i], jointValues[i], absoluteTransforms[i - 1]);
+            flangeMoved = true;
+        }
+        dirtyFrom = model.boneCount;
+
+        // chwytak przeliczany tylko gdy zmieniło się położenie kołnierza lub rozstaw
+        if (device && (flangeMoved || device->IsDirty())) {
+            device->UpdateTransforms(absoluteTransforms[flange]);
+            collision.Update(absoluteTransforms, device->GetTransforms());
+        }
+    }
+
+    void MoveJointDiscrete(int selection, int direction) {
+        // przesuwanie przegubu
+        UpdateTargetPosition(selection, GetJointPosition(selection) + direction * jointSteps[selection]);
+    }
+
+    bool UpdateJointsSmooth(float lerpFactor = 0.1f) {
+        // animacja przejścia złącza do nadanej pozycji
+        bool jointMoves = false;
+        for (int i = 0; i < model.boneCount; i++) {
+            float currentPos = GetJointPosition(i);
+            float diff = targetPositions[i] - currentPos;
+            if (fabs(diff) > 0.001f) {
+                float newPos = currentPos + diff * lerpFactor;
+                MoveJoint(i, newPos);
+                jointMoves = true;
+            }
+        }
+        UpdateKinematics();
+        return jointMoves;
+    }
+
+    void UpdateTargetPosition(int selection, float newValue) {
+        targetPositions[selection] = newValue;
+    }
+
+    // ustawienie złącza bez wygładzania (ruch prowadzony przez TrajectoryExecutor)
+    void SetJointPosition(int selection, float newValue) {
+        targetPositions[selection] = newValue;
+        MoveJoint(selection, newValue);
+    }
+
+    JointMotionLimits GetMotionLimits(int selection) {
+        return motionLimits[selection];
+    }
+
+    void GetJointLimits(int selection, float& minValue, float& maxValue) {
+        minValue = description.minLimits[selection];
+        maxValue = description.maxLimits[selection];
+    }
+
+    float GetJointPosition(int selection) {
+        if (selection == manipulator) return device->GetPosition();
+        return jointValues[selection];
+    }
+
+    int GetBoneCount() {
+        return model.boneCount;
+    }
+
+    JointType GetJointType(int selection) {
+        return description.jointTypes[selection];
+    }
+
+    float GetTargetPosition(int selection) {
+        return targetPositions[selection];
+    }
+
+    // położenie końcówki dla zadanych nastaw złączy
+    Vector3 GetTargetTCP() {
+        return ik.ForwardPosition(&targetPositions[1]);
+    }
+
+    // ustawia nastawy tak, by końcówka trafiła w punkt; start z aktualnego położenia ramienia
+    bool MoveTCP(Vector3 target) {
+        float joints[MAX_JOINT_COUNT];
+        for (int i = 1; i < model.boneCount; i++) {
+            joints[i - 1] = GetJointPosition(i);
+        }
+        if (!ik.Solve(target, joints)) return false;
+        for (int i = 1; i < model.boneCount; i++) {
+            if (i != manipulator) targetPositions[i] = joints[i - 1];
+        }
+        return true;
+    }
+
+    // ustawia nastawy tak, by kołnierz przyjął pozę (położenie i orientację)
+    bool MoveTCPPose(const Matrix& target) {
+        float joints[MAX_JOINT_COUNT];
+        for (int i = 1; i < model.boneCount; i++) {
+            joints[i - 1] = GetJointPosition(i);
+        }
+        if (!ik.SolvePose(target, joints)) return false;
+        for (int i = 1; i < model.boneCount; i++) {
+            if (i != manipulator) targetPositions[i] = joints[i - 1];
+        }
+        return true;
+    }
+
+    // przesunięcie końcówki; ramię z co najmniej 6 złączami zachowuje przy tym orientację kołnierza
+    bool JogTCP(Vector3 delta) {
+        if (ik.GetActiveCount() < 6) return MoveTCP(Vector3Add(GetTargetTCP(), delta));
+        Matrix pose = ik.ForwardPose(&targetPositions[1]);
+        pose.m12 += delta.x;
+        pose.m13 += delta.y;
+        pose.m14 += delta.z;
+        return MoveTCPPose(pose);
+    }
+
+    InverseKinematics& GetIK() {
+        return ik;
+    }
+
+    CollisionChecker& GetCollision() {
+        return collision;
+    }
+
+    // łańcuch z bieżącymi nastawami w parametrach DH
+    KinematicChain GetKinematicChain() {
+        KinematicChain chain = description;
+        chain.base = absoluteTransforms[0];
+        for (int i = 1; i < model.boneCount; i++) {
+            const CompiledLink& link = compiled.links[i];
+            chain.DHparameters[i].x = link.theta + link.thetaScale * jointValues[i];
+            chain.DHparameters[i].y = link.d + link.dScale * jointValues[i];
+        }
+        return chain;
+    }
+
+    // łańcuch w pozycji spoczynkowej (z opisu robota) - planowanie, mapa zasięgu
+    const KinematicChain& GetRestChain() {
+        return description;
+    }
+
+    Matrix GetLinkTransform(int link) {
+        return absoluteTransforms[link];
+    }
+
+    const Device& GetDevice() {
+        return *device;
+    }
+};
+
+// Paczki liczb zmiennoprzecinkowych przetwarzane jedną instrukcją (jeden tor = jedna konfiguracja)
+struct ScalarLanes {
+    static const int width = 1;
+    float v;
+    static ScalarLanes Load(const float* p) { return { *p }; }
+    static ScalarLanes Set(float x) { return { x }; }
+    void Store(float* p) const { *p = v; }
+    static ScalarLanes Round(ScalarLanes a) { return { nearbyintf(a.v) }; }
+    static ScalarLanes Select(ScalarLanes mask, ScalarLanes a, ScalarLanes b) { return (mask.v != 0) ? a : b; }
+    static ScalarLanes Greater(ScalarLanes a, ScalarLanes b) { return { (a.v > b.v) ? 1.0f : 0.0f }; }
+    static ScalarLanes Less(ScalarLanes a, ScalarLanes b) { return { (a.v < b.v) ? 1.0f : 0.0f }; }
+};
+inline ScalarLanes operator+(ScalarLanes a, ScalarLanes b) { return { a.v + b.v }; }
+inline ScalarLanes operator-(ScalarLanes a, ScalarLanes b) { return { a.v - b.v }; }
+inline ScalarLanes operator*(ScalarLanes a, ScalarLanes b) { return { a.v * b.v }; }
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define BATCH_FK_SSE
+struct SSELanes {
+    static const int width = 4;
+    __m128 v;
+    static SSELanes Load(const float* p) { return { _mm_loadu_ps(p) }; }
+    static SSELanes Set(float x) { return { _mm_set1_ps(x) }; }
+    void Store(float* p) const { _mm_storeu_ps(p, v); }
+    static SSELanes Round(SSELanes a) { return { _mm_cvtepi32_ps(_mm_cvtps_epi32(a.v)) }; }
+    static SSELanes Select(SSELanes mask, SSELanes a, SSELanes b) { return { _mm_or_ps(_mm_and_ps(mask.v, a.v), _mm_andnot_ps(mask.v, b.v)) }; }
+    static SSELanes Greater(SSELanes a, SSELanes b) { return { _mm_cmpgt_ps(a.v, b.v) }; }
+    static SSELanes Less(SSELanes a, SSELanes b) { return { _mm_cmplt_ps(a.v, b.v) }; }
+};
+inline SSELanes operator+(SSELanes a, SSELanes b) { return { _mm_add_ps(a.v, b.v) }; }
+inline SSELanes operator-(SSELanes a, SSELanes b) { return { _mm_sub_ps(a.v, b.v) }; }
+inline SSELanes operator*(SSELanes a, SSELanes b) { return { _mm_mul_ps(a.v, b.v) }; }
+#endif
+
+#if defined(__AVX__)
+#define BATCH_FK_AVX
+struct AVXLanes {
+    static const int width = 8;
+    __m256 v;
+    static AVXLanes Load(const float* p) { return { _mm256_loadu_ps(p) }; }
+    static AVXLanes Set(float x) { return { _mm256_set1_ps(x) }; }
+    void Store(float* p) const { _mm256_storeu_ps(p, v); }
+    static AVXLanes Round(AVXLanes a) { return { _mm256_round_ps(a.v, _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC) }; }
+    static AVXLanes Select(AVXLanes mask, AVXLanes a, AVXLanes b) { return { _mm256_blendv_ps(b.v, a.v, mask.v) }; }
+    static AVXLanes Greater(AVXLanes a, AVXLanes b) { return { _mm256_cmp_ps(a.v, b.v, _CMP_GT_OQ) }; }
+    static AVXLanes Less(AVXLanes a, AVXLanes b) { return { _mm256_cmp_ps(a.v, b.v, _CMP_LT_OQ) }; }
+};
+inline AVXLanes operator+(AVXLanes a, AVXLanes b) { return { _mm256_add_ps(a.v, b.v) }; }
+inline AVXLanes operator-(AVXLanes a, AVXLanes b) { return { _mm256_sub_ps(a.v, b.v) }; }
+inline AVXLanes operator*(AVXLanes a, AVXLanes b) { return { _mm256_mul_ps(a.v, b.v) }; }
+#endif
+
+#if defined(BATCH_FK_AVX)
+typedef AVXLanes BatchLanes;
+#elif defined(BATCH_FK_SSE)
+typedef SSELanes BatchLanes;
+#else
+typedef ScalarLanes BatchLanes;
+#endif
+
+// sinus i cosinus całej paczki kątów: redukcja do [-pi/2, pi/2] i szereg Taylora
+template <typename L>
+void SinCosLanes(L x, L& s, L& c) {
+    const L twoPi = L::Set(2 * PI);
+    x = x - twoPi * L::Round(x * L::Set(1 / (2 * PI)));
+
+    // sin(x) = sin(pi - x), cos(x) = -cos(pi - x)
+    L upper = L::Greater(x, L::Set(PI / 2));
+    L lower = L::Less(x, L::Set(-PI / 2));
+    x = L::Select(upper, L::Set(PI) - x, x);
+    x = L::Select(lower, L::Set(-PI) - x, x);
+    L cosSign = L::Select(upper, L::Set(-1), L::Select(lower, L::Set(-1), L::Set(1)));
+
+    L x2 = x * x;
+    L sp = L::Set(-1.0f / 39916800.0f);
+    sp = sp * x2 + L::Set(1.0f / 362880.0f);
+    sp = sp * x2 + L::Set(-1.0f / 5040.0f);
+    sp = sp * x2 + L::Set(1.0f / 120.0f);
+    sp = sp * x2 + L::Set(-1.0f / 6.0f);
+    s = x + x * x2 * sp;
+
+    L cp = L::Set(1.0f / 479001600.0f);
+    cp = cp * x2 + L::Set(-1.0f / 3628800.0f);
+    cp = cp * x2 + L::Set(1.0f / 40320.0f);
+    cp = cp * x2 + L::Set(-1.0f / 720.0f);
+    cp = cp * x2 + L::Set(1.0f / 24.0f);
+    cp = cp * x2 + L::Set(-0.5f);
+    c = cosSign * (L::Set(1) + x2 * cp);
+}
+
+// macierz afiniczna jako 12 liczb: macierz obrotu kolumnami, potem położenie
+void MatrixToAffine(const Matrix& m, float out[12]) {
+    const float values[12] = { m.m0, m.m1, m.m2, m.m4, m.m5, m.m6, m.m8, m.m9, m.m10, m.m12, m.m13, m.m14 };
+    memcpy(out, values, sizeof(values));
+}
+
+Matrix AffineToMatrix(const float in[12]) {
+    return { in[0], in[3], in[6], in[9],
+             in[1], in[4], in[7], in[10],
+             in[2], in[5], in[8], in[11],
+             0, 0, 0, 1 };
+}
+
+// konfiguracje złączy w układzie SoA: wartości jednego złącza dla kolejnych konfiguracji leżą obok siebie
+// kolejność złączy i jednostki jak w wierszu SavedStates (złącza 1..jointCount, obroty w stopniach)
+class JointBatch {
+    int jointCount;
+    int count;
+    int stride;
+    std::vector<float> values;
+public:
+    JointBatch(int joints, int configurations) {
+        jointCount = joints;
+        count = configurations;
+        stride = (configurations + 7) & ~7; // dopełnienie do pełnej paczki AVX
+        values.assign((size_t)jointCount * stride, 0.0f);
+    }
+
+    void SetConfiguration(int config, const float* joints) {
+        for (int j = 0; j < jointCount; j++) {
+            values[(size_t)j * stride + config] = joints[j];
+        }
+    }
+
+    float GetValue(int config, int joint) const {
+        return values[(size_t)joint * stride + config];
+    }
+
+    const float* GetJoint(int joint) const {
+        return &values[(size_t)joint * stride];
+    }
+
+    int GetJointCount() const { return jointCount; }
+    int GetCount() const { return count; }
+    int GetStride() const { return stride; }
+};
+
+// wyniki obliczeń w układzie SoA: dla każdego ogniwa 12 strumieni (macierz obrotu kolumnami i położenie)
+class PoseBatch {
+    int linkCount;
+    int count;
+    int stride;
+    bool allLinks;
+    std::vector<float> data;
+public:
+    PoseBatch() : linkCount(0), count(0), stride(0), allLinks(false) {}
+
+    void Resize(int links, int configurations, bool storeAllLinks) {
+        linkCount = links;
+        count = configurations;
+        stride = (configurations + 7) & ~7;
+        allLinks = storeAllLinks;
+        data.assign((size_t)(allLinks ? linkCount : 1) * 12 * stride, 0.0f);
+    }
+
+    float* GetStream(int link, int element) {
+        int slot = allLinks ? link : 0;
+        return &data[((size_t)slot * 12 + element) * stride];
+    }
+
+    bool StoresAllLinks() const { return allLinks; }
+    int GetCount() const { return count; }
+
+    Matrix GetPose(int config, int link) {
+        float m[12];
+        for (int e = 0; e < 12; e++) m[e] = GetStream(link, e)[config];
+        return AffineToMatrix(m);
+    }
+
+    Matrix GetFlange(int config) {
+        return GetPose(config, linkCount - 1);
+    }
+
+    Vector3 GetFlangePosition(int config) {
+        return { GetStream(linkCount - 1, 9)[config], GetStream(linkCount - 1, 10)[config], GetStream(linkCount - 1, 11)[config] };
+    }
+};
+
+// Kinematyka prosta dla wielu konfiguracji naraz (próbkowanie przestrzeni roboczej, planery, sprawdzanie programów)
+class BatchKinematics {
+    KinematicChain chain;
+
+    // jeden blok L::width konfiguracji; macierze ogniw DH: R = Rx(alfa) * Ry(theta), p = Rx(alfa) * (a, d, 0)
+    template <typename L>
+    void ComputeBlock(const JointBatch& joints, PoseBatch& poses, int first) const {
+        float b[12];
+        MatrixToAffine(chain.base, b);
+        L R[9] = { L::Set(b[0]), L::Set(b[1]), L::Set(b[2]), L::Set(b[3]), L::Set(b[4]), L::Set(b[5]), L::Set(b[6]), L::Set(b[7]), L::Set(b[8]) };
+        L P[3] = { L::Set(b[9]), L::Set(b[10]), L::Set(b[11]) };
+
+        for (int i = 1; i < chain.linkCount; i++) {
+            Vector4 DH = chain.DHparameters[i];
+            float ca = cosf(DH.w);
+            float sa = sinf(DH.w);
+            L local[9];
+            L lp[3];
+
+            if (chain.jointTypes[i] == REVOLUTE && i - 1 < joints.GetJointCount()) {
+                // zmienny kąt, stałe przesunięcie
+                L theta = L::Load(joints.GetJoint(i - 1) + first) * L::Set(DEG2RAD);
+                L st, ct;
+                SinCosLanes(theta, st, ct);
+                local[0] = ct;                local[3] = L::Set(0);  local[6] = st;
+                local[1] = L::Set(sa) * st;   local[4] = L::Set(ca); local[7] = L::Set(-sa) * ct;
+                local[2] = L::Set(-ca) * st;  local[5] = L::Set(sa); local[8] = L::Set(ca) * ct;
+                lp[0] = L::Set(DH.z);
+                lp[1] = L::Set(ca * DH.y);
+                lp[2] = L::Set(sa * DH.y);
+            } else {
+                // stały obrót, przesunięcie zmienne tylko dla złącza pryzmatycznego
+                float ct = cosf(DH.x);
+                float st = sinf(DH.x);
+                local[0] = L::Set(ct);       local[3] = L::Set(0);  local[6] = L::Set(st);
+                local[1] = L::Set(sa * st);  local[4] = L::Set(ca); local[7] = L::Set(-sa * ct);
+                local[2] = L::Set(-ca * st); local[5] = L::Set(sa); local[8] = L::Set(ca * ct);
+                L d = (chain.jointTypes[i] == PRISMATIC && i - 1 < joints.GetJointCount()) ? L::Load(joints.GetJoint(i - 1) + first) : L::Set(DH.y);
+                lp[0] = L::Set(DH.z);
+                lp[1] = L::Set(ca) * d;
+                lp[2] = L::Set(sa) * d;
+            }
+
+            // złożenie z ogniwem poprzednim: R' = R * Rl, P' = R * pl + P
+            L nR[9];
+            for (int col = 0; col < 3; col++) {
+                for (int row = 0; row < 3; row++) {
+                    nR[col * 3 + row] = R[row] * local[col * 3] + R[3 + row] * local[col * 3 + 1] + R[6 + row] * local[col * 3 + 2];
+                }
+            }
+            for (int row = 0; row < 3; row++) {
+                P[row] = R[row] * lp[0] + R[3 + row] * lp[1] + R[6 + row] * lp[2] + P[row];
+            }
+            for (int e = 0; e < 9; e++) R[e] = nR[e];
+
+            if (poses.StoresAllLinks() || i == chain.linkCount - 1) {
+                for (int e = 0; e < 9; e++) R[e].Store(poses.GetStream(i, e) + first);
+                for (int e = 0; e < 3; e++) P[e].Store(poses.GetStream(i, 9 + e) + first);
+            }
+        }
+    }
+
+public:
+    BatchKinematics(const KinematicChain& c) : chain(c) {}
+
+    // storeAllLinks = false zapisuje tylko kołnierz (ostatnie ogniwo)
+    void Compute(const JointBatch& joints, PoseBatch& poses, bool storeAllLinks = false) const {
+        poses.Resize(chain.linkCount, joints.GetCount(), storeAllLinks);
+        if (storeAllLinks) {
+            // podstawa jest wspólna dla wszystkich konfiguracji
+            float b[12];
+            MatrixToAffine(chain.base, b);
+            for (int e = 0; e < 12; e++) {
+                float* stream = poses.GetStream(0, e);
+                for (int k = 0; k < joints.GetCount(); k++) stream[k] = b[e];
+            }
+        }
+        for (int first = 0; first < joints.GetCount(); first += BatchLanes::width) {
+            ComputeBlock<BatchLanes>(joints, poses, first);
+        }
+    }
+
+    static const char* GetKernelName() {
+#if defined(BATCH_FK_AVX)
+        return "AVX";
+#elif defined(BATCH_FK_SSE)
+        return "SSE";
+#else
+        return "scalar";
+#endif
+    }
+};
+
+// kształt profilu prędkości ruchu między punktami
+enum ProfileType {
+    PROFILE_TRAPEZOIDAL,
+    PROFILE_SCURVE // przyspieszanie po sinusoidzie, ograniczony zryw
+};
+
+// Wykonuje ruch złączy między punktami w czasie rzeczywistym ze stałym krokiem całkowania,
+// niezależnie od liczby klatek na sekundę; wszystkie złącza docierają do celu jednocześnie
+class TrajectoryExecutor {
+    int jointCount;
+    JointMotionLimits limits[MAX_JOINT_COUNT];
+    ProfileType profile;
+    float timeStep;    // krok całkowania [s]
+    float accumulator; // czas rzeczywisty jeszcze nie przeliczony
+    float dwellTime;   // postój w punkcie [s]
+
+    float start[MAX_JOINT_COUNT];
+    float delta[MAX_JOINT_COUNT];
+    float duration;       // czas ruchu w segmencie
+    float accelFraction;  // część czasu ruchu na rozpędzanie (i tyle samo na hamowanie)
+    int segmentSteps;     // kroki ruchu i postoju w segmencie
+    int step;
+
+    const float maxFrameTime = 0.25f; // ochrona przed lawiną kroków po zawieszeniu okna
+
+    // znormalizowana droga [0, 1] w chwili t ruchu trwającego duration
+    float Progress(float t) {
+        if (duration <= 0 || t >= duration) return 1;
+        float ta = accelFraction * duration;
+        float vPeak = 1.0f / (duration - ta);
+        float tail = duration - t;
+        if (profile == PROFILE_SCURVE) {
+            // v(t) = vPeak * (1 - cos(pi * t / ta)) / 2 w fazie rozpędzania
+            if (t < ta) return 0.5f * vPeak * (t - ta / PI * sinf(PI * t / ta));
+            if (tail < ta) return 1 - 0.5f * vPeak * (tail - ta / PI * sinf(PI * tail / ta));
+        } else {
+            if (t < ta) return 0.5f * vPeak * t * t / ta;
+            if (tail < ta) return 1 - 0.5f * vPeak * tail * tail / ta;
+        }
+        return 0.5f * vPeak * ta + vPeak * (t - ta);
+    }
+
+    // najkrótszy czas ruchu złącza o drogę distance przy zadanej części czasu na rozpędzanie
+    float MinimumDuration(int joint, float distance, float fraction) {
+        const JointMotionLimits& l = limits[joint];
+        // v = D / (T (1 - f)), a = k D / (T^2 f (1 - f)), j = k2 D / (T^3 f^2 (1 - f))
+        float accelFactor = (profile == PROFILE_SCURVE) ? PI / 2 : 1;
+        float T = distance / (l.velocity * (1 - fraction));
+        T = fmaxf(T, sqrtf(accelFactor * distance / (l.acceleration * fraction * (1 - fraction))));
+        if (profile == PROFILE_SCURVE) {
+            T = fmaxf(T, cbrtf(PI * PI / 2 * distance / (l.jerk * fraction * fraction * (1 - fraction))));
+        }
+        return T;
+    }
+
+public:
+    TrajectoryExecutor() : jointCount(0), profile(PROFILE_TRAPEZOIDAL), timeStep(0.002f), accumulator(0), dwellTime(0) {
+        duration = 0;
+        accelFraction = 0.5f;
+        segmentSteps = 0;
+        step = 0;
+    }
+
+    void SetLimits(int joints, const JointMotionLimits* jointLimits) {
+        jointCount = joints;
+        for (int j = 0; j < jointCount; j++) limits[j] = jointLimits[j];
+    }
+
+    void SetProfile(ProfileType p) { profile = p; }
+    ProfileType GetProfile() { return profile; }
+    void SetDwellTime(float seconds) { dwellTime = seconds; }
+    float GetTimeStep() { return timeStep; }
+
+    // nowy segment ruchu; zwraca jego czas (ruch i postój) zaokrąglony do kroków całkowania
+    float Plan(const float* from, const float* to) {
+        // część czasu na rozpędzanie wyznacza złącze najdłużej jadące po profilu trapezowym
+        float slowest = 0;
+        accelFraction = 0.5f;
+        for (int j = 0; j < jointCount; j++) {
+            start[j] = from[j];
+            delta[j] = to[j] - from[j];
+            float D = fabsf(delta[j]);
+            if (D < 1e-6f) continue;
+            const JointMotionLimits& l = limits[j];
+            float T, f;
+            if (D * l.acceleration > l.velocity * l.velocity) {
+                T = D / l.velocity + l.velocity / l.acceleration;
+                f = (l.velocity / l.acceleration) / T;
+            } else {
+                T = 2 * sqrtf(D / l.acceleration);
+                f = 0.5f;
+            }
+            if (T > slowest) {
+                slowest = T;
+                accelFraction = f;
+            }
+        }
+        // wspólny czas, w którym każde złącze mieści się w swoich ograniczeniach
+        duration = 0;
+        for (int j = 0; j < jointCount; j++) {
+            float D = fabsf(delta[j]);
+            if (D >= 1e-6f) duration = fmaxf(duration, MinimumDuration(j, D, accelFraction));
+        }
+        segmentSteps = (int)ceilf((duration + dwellTime) / timeStep - 1e-4f);
+        step = 0;
+        return segmentSteps * timeStep;
+    }
+
+    bool IsFinished() {
+        return step >= segmentSteps;
+    }
+
+    void Reset() {
+        accumulator = 0;
+        segmentSteps = 0;
+        step = 0;
+    }
+
+    // doliczenie czasu klatki do zaległego czasu symulacji
+    void AddTime(float frameTime) {
+        accumulator += fminf(frameTime, maxFrameTime);
+    }
+
+    bool HasPendingStep() {
+        return accumulator >= timeStep;
+    }
+
+    // krok całkowania odliczony bez ruchu segmentu (nastawy z innego źródła, np. tablicy toru)
+    void ConsumeStep() {
+        accumulator -= timeStep;
+    }
+
+    // jeden krok całkowania, positions otrzymuje nastawy złączy
+    void Step(float* positions) {
+        accumulator -= timeStep;
+        if (step < segmentSteps) step++;
+        float s = Progress(step * timeStep);
+        for (int j = 0; j < jointCount; j++) {
+            positions[j] = start[j] + delta[j] * s;
+        }
+    }
+};
+
+// tor przez wszystkie punkty programu bez zatrzymań: krzywe sklejane, wielomiany odcinków i tablica nastaw liczone raz po zmianie programu
+enum PathMode {
+    PATH_POINT_TO_POINT, // postój w każdym punkcie (TrajectoryExecutor)
+    PATH_CUBIC_C1,       // sześcienna Hermite'a, ciągła prędkość
+    PATH_CUBIC_C2,       // sześcienna sklejana, ciągłe przyspieszenie (układ cykliczny)
+    PATH_QUINTIC         // piątego stopnia, ciągłe przyspieszenie bez rozwiązywania układu
+};
+#define PATH_MODE_COUNT 4
+const char* pathModeNames[PATH_MODE_COUNT] = { "punkt-punkt", "sklejany C1", "sklejany C2", "5. stopnia" };
+#define SPLINE_TABLE_MAX_FLOATS (1 << 22) // powyżej tego tablica nie jest budowana, nastawy liczone z wielomianów
+#define SPLINE_MIN_SEGMENT_TIME 0.05f
+#define SPLINE_MAX_POINTS 65536 // tor sklejany potrzebuje wszystkich punktów w pamięci; dłuższe programy jadą punkt-punkt
+
+class SplineTrajectory {
+    int jointCount;
+    int pointCount;
+    JointMotionLimits limits[MAX_JOINT_COUNT];
+    float minValues[MAX_JOINT_COUNT]; // zakres nastaw, którego tor nie może opuścić
+    float maxValues[MAX_JOINT_COUNT];
+    int stepJoint;                    // złącze zatrzymywane w każdym punkcie (chwytak), -1 - brak
+    PathMode mode;
+    float blend; // 0 - zatrzymanie w punktach, 1 - pełne przejście przez narożniki (C1 i piąty stopień)
+    float timeStep;
+
+    std::vector<float> segmentTime;  // czas odcinka i -> i + 1 (ostatni wraca do pierwszego punktu)
+    std::vector<double> segmentStart; // początek odcinka na osi czasu (double - przy długich cyklach float gubi ułamki kroku)
+    std::vector<float> coefficients; // [odcinek][złącze][6], wielomian zmiennej u = t / T
+    std::vector<float> table;        // [krok][złącze]
+    std::vector<int> tableSegment;   // odcinek, w którym leży krok (do podświetlenia punktu)
+    std::vector<unsigned char> pinned; // [punkt][złącze] - złącze zatrzymane w punkcie (v = 0, a = 0)
+    int stepCount;
+    double duration;
+
+    float* Coefficients(int segment, int joint) {
+        return &coefficients[((size_t)segment * jointCount + joint) * 6];
+    }
+
+    // prędkości i przyspieszenia w węzłach dla danych czasów odcinków; w pierwszym punkcie tor zaczyna się i kończy w spoczynku
+    // (tam robot dojeżdża ruchem punkt-punkt i stamtąd startuje każdy cykl), pozostałe punkty są przejeżdżane bez zatrzymania
+    void ComputeKnots(const float* points, std::vector<float>& velocity, std::vector<float>& acceleration) {
+        int n = pointCount;
+        velocity.assign((size_t)n * jointCount, 0);
+        acceleration.assign((size_t)n * jointCount, 0);
+        for (int j = 0; j < jointCount; j++) {
+            for (int i = 1; i < n; i++) {
+                if (pinned[(size_t)i * jointCount + j]) continue;
+                int prev = (i + n - 1) % n, next = (i + 1) % n;
+                float hPrev = segmentTime[prev], hNext = segmentTime[i];
+                float sPrev = (points[(size_t)i * jointCount + j] - points[(size_t)prev * jointCount + j]) / hPrev;
+                float sNext = (points[(size_t)next * jointCount + j] - points[(size_t)i * jointCount + j]) / hNext;
+                float v = (sPrev * hNext + sNext * hPrev) / (hPrev + hNext);
+                // zmiana kierunku ruchu złącza - zatrzymanie w punkcie zamiast przestrzelenia
+                if (sPrev * sNext <= 0) v = 0;
+                // sklejana C2 ma prędkości wyznaczone przez układ równań, stopień przejścia jej nie dotyczy
+                float scale = (mode == PATH_CUBIC_C2) ? 1 : blend;
+                velocity[(size_t)i * jointCount + j] = v * scale;
+                acceleration[(size_t)i * jointCount + j] = 2 * (sNext - sPrev) / (hPrev + hNext) * scale;
+            }
+            if (mode != PATH_CUBIC_C2) continue;
+            // ciągłość przyspieszenia: h_i v_(i-1) + 2 (h_(i-1) + h_i) v_i + h_(i-1) v_(i+1) = 3 (h_i s_(i-1) + h_(i-1) s_i);
+            // macierz z dominującą przekątną - Gauss-Seidel startujący z prędkości C1, węzeł 0 i zatrzymania zamocowane (v = 0)
+            for (int iteration = 0; iteration < 100; iteration++) {
+                float change = 0;
+                for (int i = 1; i < n; i++) {
+                    if (pinned[(size_t)i * jointCount + j]) continue;
+                    int prev = (i + n - 1) % n, next = (i + 1) % n;
+                    float hPrev = segmentTime[prev], hNext = segmentTime[i];
+                    float sPrev = (points[(size_t)i * jointCount + j] - points[(size_t)prev * jointCount + j]) / hPrev;
+                    float sNext = (points[(size_t)next * jointCount + j] - points[(size_t)i * jointCount + j]) / hNext;
+                    float rhs = 3 * (hNext * sPrev + hPrev * sNext)
+                        - hNext * velocity[(size_t)prev * jointCount + j] - hPrev * velocity[(size_t)next * jointCount + j];
+                    float v = rhs / (2 * (hPrev + hNext));
+                    change = fmaxf(change, fabsf(v - velocity[(size_t)i * jointCount + j]));
+                    velocity[(size_t)i * jointCount + j] = v;
+                }
+                if (change < 1e-6f) break;
+            }
+        }
+    }
+
+    // współczynniki wielomianów Hermite'a; odcinek wychodzący poza zakres złącza dostaje zatrzymanie złącza w obu
+    // końcach (wielomian z v = 0 i a = 0 na końcach jest monotoniczny), C2 liczona ponownie wokół zatrzymań
+    void ComputeCoefficients(const float* points) {
+        pinned.assign((size_t)pointCount * jointCount, 0);
+        for (int i = 0; i < pointCount && stepJoint >= 0; i++) pinned[(size_t)i * jointCount + stepJoint] = 1;
+        for (int pass = 0; pass <= pointCount; pass++) {
+            FillCoefficients(points);
+            if (!PinOutOfRange()) break;
+        }
+    }
+
+    bool PinOutOfRange() {
+        const int samples = 64;
+        bool changed = false;
+        for (int i = 0; i < pointCount; i++) {
+            int next = (i + 1) % pointCount;
+            for (int j = 0; j < jointCount; j++) {
+                if (pinned[(size_t)i * jointCount + j] && pinned[(size_t)next * jointCount + j]) continue;
+                const float* c = Coefficients(i, j);
+                bool outside = false;
+                for (int k = 1; k < samples && !outside; k++) {
+                    float u = (float)k / samples;
+                    float value = c[0] + u * (c[1] + u * (c[2] + u * (c[3] + u * (c[4] + u * c[5]))));
+                    outside = value < minValues[j] || value > maxValues[j];
+                }
+                if (outside) {
+                    pinned[(size_t)i * jointCount + j] = 1;
+                    pinned[(size_t)next * jointCount + j] = 1;
+                    changed = true;
+                }
+            }
+        }
+        return changed;
+    }
+
+    void FillCoefficients(const float* points) {
+        std::vector<float> velocity, acceleration;
+        ComputeKnots(points, velocity, acceleration);
+        int n = pointCount;
+        coefficients.assign((size_t)n * jointCount * 6, 0);
+        for (int i = 0; i < n; i++) {
+            int next = (i + 1) % n;
+            float T = segmentTime[i];
+            for (int j = 0; j < jointCount; j++) {
+                float p0 = points[(size_t)i * jointCount + j], p1 = points[(size_t)next * jointCount + j];
+                float v0 = velocity[(size_t)i * jointCount + j] * T, v1 = velocity[(size_t)next * jointCount + j] * T;
+                float* c = Coefficients(i, j);
+                float d = p1 - p0;
+                c[0] = p0;
+                c[1] = v0;
+                if (mode == PATH_QUINTIC) {
+                    float a0 = acceleration[(size_t)i * jointCount + j] * T * T, a1 = acceleration[(size_t)next * jointCount + j] * T * T;
+                    c[2] = 0.5f * a0;
+                    c[3] = 10 * d - 6 * v0 - 4 * v1 - 1.5f * a0 + 0.5f * a1;
+                    c[4] = -15 * d + 8 * v0 + 7 * v1 + 1.5f * a0 - a1;
+                    c[5] = 6 * d - 3 * (v0 + v1) - 0.5f * (a0 - a1);
+                } else {
+                    c[2] = 3 * d - 2 * v0 - v1;
+                    c[3] = -2 * d + v0 + v1;
+                }
+            }
+        }
+    }
+
+    // największy stosunek prędkości, przyspieszenia i zrywu do ograniczeń na odcinku (pierwiastki - skala czasu)
+    float SegmentLimitRatio(int segment) {
+        float T = segmentTime[segment];
+        float ratio = 0;
+        const int samples = 32;
+        for (int j = 0; j < jointCount; j++) {
+            const float* c = Coefficients(segment, j);
+            float vMax = 0, aMax = 0, jMax = 0;
+            for (int k = 0; k <= samples; k++) {
+                float u = (float)k / samples;
+                float v = c[1] + u * (2 * c[2] + u * (3 * c[3] + u * (4 * c[4] + u * 5 * c[5])));
+                float a = 2 * c[2] + u * (6 * c[3] + u * (12 * c[4] + u * 20 * c[5]));
+                float jk = 6 * c[3] + u * (24 * c[4] + u * 60 * c[5]);
+                vMax = fmaxf(vMax, fabsf(v));
+                aMax = fmaxf(aMax, fabsf(a));
+                jMax = fmaxf(jMax, fabsf(jk));
+            }
+            const JointMotionLimits& l = limits[j];
+            ratio = fmaxf(ratio, vMax / T / l.velocity);
+            ratio = fmaxf(ratio, sqrtf(aMax / (T * T) / l.acceleration));
+            ratio = fmaxf(ratio, cbrtf(jMax / (T * T * T) / l.jerk));
+        }
+        return ratio;
+    }
+
+public:
+    SplineTrajectory() : jointCount(0), pointCount(0), stepJoint(-1), mode(PATH_CUBIC_C2), blend(1), timeStep(0.002f), stepCount(0), duration(0) {
+        for (int j = 0; j < MAX_JOINT_COUNT; j++) {
+            minValues[j] = -FLT_MAX;
+            maxValues[j] = FLT_MAX;
+        }
+    }
+
+    void SetLimits(int joints, const JointMotionLimits* jointLimits) {
+        jointCount = joints;
+        for (int j = 0; j < jointCount; j++) limits[j] = jointLimits[j];
+    }
+
+    // zakres nastaw złączy (tor nie wychodzi poza niego) i złącze zatrzymywane w każdym punkcie jak w ruchu punkt-punkt
+    void SetRange(const float* minJoint, const float* maxJoint, int stopJoint) {
+        for (int j = 0; j < jointCount; j++) {
+            minValues[j] = minJoint[j];
+            maxValues[j] = maxJoint[j];
+        }
+        stepJoint = stopJoint;
+    }
+
+    void SetMode(PathMode m) { mode = m; }
+    void SetBlend(float b) { blend = Clamp(b, 0.0f, 1.0f); }
+    float GetBlend() { return blend; }
+    void SetTimeStep(float seconds) { timeStep = seconds; }
+
+    // points - count punktów po jointCount wartości; tor zamknięty (po ostatnim punkcie powrót do pierwszego)
+    // withTable == false - tylko czasy odcinków i wielomiany (ocena czasu cyklu bez trybu pracy)
+    void Build(const float* points, int count, bool withTable = true) {
+        pointCount = count;
+        stepCount = 0;
+        duration = 0;
+        table.clear();
+        tableSegment.clear();
+        if (count < 2) return;
+
+        // czasy startowe: najwolniejsze złącze jadące z maksymalną prędkością
+        segmentTime.assign(count, 0);
+        for (int i = 0; i < count; i++) {
+            int next = (i + 1) % count;
+            float T = SPLINE_MIN_SEGMENT_TIME;
+            for (int j = 0; j < jointCount; j++) {
+                float D = fabsf(points[(size_t)next * jointCount + j] - points[(size_t)i * jointCount + j]);
+                T = fmaxf(T, D / limits[j].velocity);
+            }
+            segmentTime[i] = T;
+        }
+        // skalowanie czasu każdego odcinka do jego ograniczeń; zmiana czasów zmienia prędkości w węzłach, stąd kilka przebiegów
+        for (int pass = 0; pass < 8; pass++) {
+            ComputeCoefficients(points);
+            bool changed = false;
+            for (int i = 0; i < count; i++) {
+                float ratio = SegmentLimitRatio(i);
+                if (ratio > 1.001f || (pass < 4 && ratio < 0.9f)) {
+                    segmentTime[i] = fmaxf(SPLINE_MIN_SEGMENT_TIME, segmentTime[i] * ratio);
+                    changed = true;
+                }
+            }
+            if (!changed) break;
+        }
+        ComputeCoefficients(points);
+        float worst = 1;
+        for (int i = 0; i < count; i++) worst = fmaxf(worst, SegmentLimitRatio(i));
+        float total = 0;
+        for (int i = 0; i < count; i++) total += segmentTime[i];
+        // równe przeskalowanie całości, gdyby któryś odcinek nadal przekraczał ograniczenia, i wydłużenie cyklu do pełnej
+        // liczby kroków - przejście z ostatniego wiersza tablicy do pierwszego trwa wtedy dokładnie jeden krok
+        stepCount = (int)ceilf(total * worst / timeStep - 1e-4f);
+        float scale = stepCount * timeStep / total;
+        for (int i = 0; i < count; i++) segmentTime[i] *= scale;
+        ComputeCoefficients(points);
+
+        segmentStart.resize(count);
+        for (int i = 0; i < count; i++) {
+            segmentStart[i] = duration;
+            duration += segmentTime[i];
+        }
+
+        // tablica nastaw w krokach całkowania - w trybie pracy tylko odczyt wiersza
+        tableSegment.resize(stepCount);
+        bool buildTable = withTable && (size_t)stepCount * jointCount <= SPLINE_TABLE_MAX_FLOATS;
+        if (buildTable) table.resize((size_t)stepCount * jointCount);
+        int segment = 0;
+        for (int k = 0; k < stepCount; k++) {
+            // kroki rozłożone równo na dokładnym czasie cyklu (skala liczona we float nie trafia idealnie w wielokrotność kroku)
+            double t = duration * k / stepCount;
+            while (segment < count - 1 && t >= segmentStart[segment + 1]) segment++;
+            tableSegment[k] = segment;
+            if (buildTable) Evaluate(segment, t, &table[(size_t)k * jointCount]);
+        }
+    }
+
+    // nastawy w chwili t odcinka segment
+    void Evaluate(int segment, double t, float* positions) {
+        float u = Clamp((float)((t - segmentStart[segment]) / segmentTime[segment]), 0.0f, 1.0f);
+        for (int j = 0; j < jointCount; j++) {
+            const float* c = Coefficients(segment, j);
+            positions[j] = c[0] + u * (c[1] + u * (c[2] + u * (c[3] + u * (c[4] + u * c[5]))));
+        }
+    }
+
+    // zakres nastaw całego toru z wielomianów odcinków (sklejane mogą wyjść poza punkty programu)
+    void GetRange(float* minValues, float* maxValues) {
+        const int samples = 32;
+        for (int j = 0; j < jointCount; j++) {
+            minValues[j] = FLT_MAX;
+            maxValues[j] = -FLT_MAX;
+            for (int i = 0; i < pointCount; i++) {
+                const float* c = Coefficients(i, j);
+                for (int k = 0; k <= samples; k++) {
+                    float u = (float)k / samples;
+                    float value = c[0] + u * (c[1] + u * (c[2] + u * (c[3] + u * (c[4] + u * c[5]))));
+                    minValues[j] = fminf(minValues[j], value);
+                    maxValues[j] = fmaxf(maxValues[j], value);
+                }
+            }
+        }
+    }
+
+    // nastawy w kroku step (0 <= step < GetStepCount())
+    void Sample(int step, float* positions) {
+        if (!table.empty()) {
+            const float* row = &table[(size_t)step * jointCount];
+            for (int j = 0; j < jointCount; j++) positions[j] = row[j];
+            return;
+        }
+        Evaluate(tableSegment[step], duration * step / stepCount, positions);
+    }
+
+    // krok tablicy w ułamku u (0..1) odcinka segment
+    int GetStep(int segment, float u) {
+        int step = (int)((segmentStart[segment] + u * segmentTime[segment]) / duration * stepCount);
+        return std::max(0, std::min(stepCount - 1, step));
+    }
+
+    int GetSegment(int step) { return tableSegment[step]; }
+    int GetStepCount() { return stepCount; }
+    float GetDuration() { return stepCount * timeStep; }
+    PathMode GetMode() { return mode; }
+    bool IsReady() { return stepCount > 0; }
+};
+
+// budowa toru w tle dla trybu pracy: wątek sterowania zleca budowę i tylko podmienia gotowy tor (zamiana wektorów),
+// a stary tor jest zwalniany przez wątek budowy przy kolejnym zleceniu. Zlecenie w trakcie budowy czeka na jej koniec,
+// wynik nieaktualny (jest nowsze zlecenie) jest odrzucany
+class SplineBuildTask {
+    SplineTrajectory result;
+    SplineTrajectory queuedSpline; // ustawienia (zakresy, tryb, przejście) bez zbudowanego toru
+    std::vector<float> points;
+    std::vector<float> queuedPoints;
+    int count, queuedCount;
+    int revision, queuedRevision;
+    bool queued;
+    std::thread worker;
+    std::atomic<bool> done;
+    bool started;
+
+    void StartQueued() {
+        queued = false;
+        points.swap(queuedPoints);
+        count = queuedCount;
+        revision = queuedRevision;
+        started = true;
+        done.store(false, std::memory_order_release);
+        worker = std::thread([this, settings = queuedSpline]() {
+            result = settings; // tu zwalniany jest poprzednio podmieniony tor
+            result.Build(points.data(), count);
+            done.store(true, std::memory_order_release);
+        });
+    }
+
+public:
+    SplineBuildTask() : count(0), queuedCount(0), revision(-1), queuedRevision(-1), queued(false), done(false), started(false) {}
+
+    ~SplineBuildTask() {
+        if (worker.joinable()) worker.join();
+    }
+
+    // settings - tor z ustawieniami do zbudowania; values przejmowane (swap)
+    void Request(const SplineTrajectory& settings, std::vector<float>& values, int pointCount, int programRevision) {
+        queuedSpline = settings;
+        queuedPoints.swap(values);
+        queuedCount = pointCount;
+        queuedRevision = programRevision;
+        queued = true;
+        if (!started) StartQueued();
+    }
+
+    // gotowy tor trafia do spline (poprzedni wraca do zadania); false - budowa trwa albo wynik nieaktualny
+    bool Take(SplineTrajectory& spline, int& programRevision) {
+        if (!started || !done.load(std::memory_order_acquire)) return false;
+        worker.join();
+        started = false;
+        if (queued) {
+            StartQueued();
+            return false;
+        }
+        std::swap(spline, result);
+        programRevision = revision;
+        return true;
+    }
+
+    bool IsBusy() { return started; }
+};
+
+// program robota na dysku: dziennik rekordów stałej długości (typ + wartości przegubów), tylko dopisywanych na końcu
+#define PROGRAM_FILE_VERSION 1
+#define PROGRAM_RECORD_ADD 1    // nowy punkt na końcu programu
+#define PROGRAM_RECORD_DELETE 2 // usunięcie ostatniego punktu
+#define PROGRAM_RECORD_CLEAR 3  // usunięcie wszystkich punktów
+#define PROGRAM_TAIL_RECORDS 4096 // rekordy dopisane od ostatniego mapowania trzymane w pamięci
+#define PROGRAM_COMPACT_SLACK 1024 // martwe rekordy (usunięte punkty) ponad liczbę żywych, po których dziennik jest przepisywany
+
+// ustawienie pozycji w pliku z 64-bitowym przesunięciem (long w Windows ma 32 bity)
+int FileSeek64(FILE* file, long long offset, int origin) {
+#if defined(_WIN32)
+    return _fseeki64(file, offset, origin);
+#else
+    return fseeko(file, (off_t)offset, origin);
+#endif
+}
+
+// podmiana pliku w jednym kroku - po błędzie albo przerwaniu zostaje poprzedni plik
+bool ReplaceFileAtomic(const char* from, const char* to) {
+#if defined(_WIN32)
+    const unsigned long MOVEFILE_REPLACE_EXISTING_FLAG = 1, MOVEFILE_WRITE_THROUGH_FLAG = 8;
+    return MoveFileExA(from, to, MOVEFILE_REPLACE_EXISTING_FLAG | MOVEFILE_WRITE_THROUGH_FLAG) != 0;
+#else
+    return rename(from, to) == 0;
+#endif
+}
+
+struct ProgramFileHeader {
+    char magic[4]; // "RPG1"
+    int version;
+    int jointCount;
+    int reserved;
+};
+
+class ProgramStore {
+    // żywe punkty programu jako ciągi kolejnych rekordów ADD (zwykle jeden ciąg)
+    struct Run {
+        long long firstRecord;
+        long long firstIndex; // numer pierwszego punktu ciągu w programie
+        long long count;
+    };
+    FILE* file;
+    char fileName[256];
+    MappedFile mapping;
+    int jointCount;
+    size_t recordSize;
+    long long mappedRecords;   // rekordy czytane bezpośrednio z mapowania
+    long long recordCount;     // wszystkie rekordy dziennika
+    std::vector<float> tail;   // wartości rekordów dopisanych po zmapowaniu pliku
+    std::vector<Run> runs;
+    long long count;
+    long long compactAfter;    // po nieudanym przepisaniu kolejna próba dopiero od tylu rekordów
+
+    void Push(long long record) {
+        if (!runs.empty() && runs.back().firstRecord + runs.back().count == record) runs.back().count++;
+        else runs.push_back({ record, count, 1 });
+        count++;
+    }
+
+    void Pop() {
+        if (runs.empty()) return;
+        if (--runs.back().count == 0) runs.pop_back();
+        count--;
+    }
+
+    const float* GetRecord(long long record) {
+        if (record < mappedRecords) {
+            return (const float*)(mapping.GetData() + sizeof(ProgramFileHeader) + record * recordSize + sizeof(int));
+        }
+        return &tail[(size_t)(record - mappedRecords) * jointCount];
+    }
+
+    void Write(int type, const float* values, bool flush = true) {
+        // rekord dopisywany i od razu wypychany na dysk (flush == false - wypycha wołający po kilku rekordach);
+        // bez pliku program żyje tylko w pamięci
+        tail.insert(tail.end(), values, values + jointCount);
+        if (file != NULL) {
+            fwrite(&type, sizeof(int), 1, file);
+            fwrite(values, sizeof(float), jointCount, file);
+            if (flush) fflush(file);
+        }
+        recordCount++;
+        // dziennik z przewagą usuniętych punktów jest przepisywany, inaczej mapowany ponownie przy długim nagrywaniu
+        if (file != NULL && recordCount - count > count + PROGRAM_COMPACT_SLACK && recordCount >= compactAfter && Compact()) return;
+        if (file != NULL && recordCount - mappedRecords >= PROGRAM_TAIL_RECORDS && Remap()) {
+            tail.clear();
+        }
+    }
+
+    // przepisanie dziennika: tylko żywe punkty jako kolejne rekordy ADD, przez plik tymczasowy podmieniany na końcu
+    bool Compact() {
+        std::vector<float> live;
+        live.reserve((size_t)count * jointCount);
+        for (size_t r = 0; r < runs.size(); r++) {
+            for (long long i = 0; i < runs[r].count; i++) {
+                const float* values = GetRecord(runs[r].firstRecord + i);
+                live.insert(live.end(), values, values + jointCount);
+            }
+        }
+        char tempName[270];
+        _snprintf_s(tempName, sizeof(tempName) - 1, "%s.tmp", fileName);
+        FILE* out = NULL;
+        if (fopen_s(&out, tempName, "wb") != 0 || out == NULL) return false;
+        ProgramFileHeader header;
+        memcpy(header.magic, "RPG1", 4);
+        header.version = PROGRAM_FILE_VERSION;
+        header.jointCount = jointCount;
+        header.reserved = 0;
+        bool ok = fwrite(&header, sizeof(header), 1, out) == 1;
+        int type = PROGRAM_RECORD_ADD;
+        for (long long i = 0; ok && i < count; i++) {
+            ok = fwrite(&type, sizeof(int), 1, out) == 1
+                && fwrite(&live[(size_t)i * jointCount], sizeof(float), jointCount, out) == (size_t)jointCount;
+        }
+        ok = fclose(out) == 0 && ok;
+        if (!ok) {
+            remove(tempName);
+            compactAfter = recordCount + count + PROGRAM_COMPACT_SLACK;
+            return false;
+        }
+#if defined(_WIN32)
+        // Windows nie podmienia otwartego ani zmapowanego pliku - zamknięcie przed podmianą
+        mapping.Close();
+        fclose(file);
+        file = NULL;
+#endif
+        if (!ReplaceFileAtomic(tempName, fileName)) {
+            // dziennik zostaje bez zmian; w Windows ponowne otwarcie i zmapowanie tego samego pliku
+            remove(tempName);
+            compactAfter = recordCount + count + PROGRAM_COMPACT_SLACK;
+            TraceLog(LOG_WARNING, "PROGRAM: nie mozna podmienic %s, zostaje dziennik bez przepisania", fileName);
+#if defined(_WIN32)
+            if (fopen_s(&file, fileName, "r+b") != 0) file = NULL;
+            if (file != NULL && mapping.Open(fileName)) {
+                FileSeek64(file, (long long)sizeof(header) + recordCount * (long long)recordSize, SEEK_SET);
+                return false;
+            }
+            if (file != NULL) fclose(file);
+            file = NULL;
+            TraceLog(LOG_WARNING, "PROGRAM: nie mozna otworzyc %s, program tylko w pamieci", fileName);
+            // punkty z pamięci jak po przepisaniu
+#else
+            return false;
+#endif
+        }
+        else {
+#if !defined(_WIN32)
+            mapping.Close();
+            fclose(file);
+            file = NULL;
+#endif
+            if (fopen_s(&file, fileName, "r+b") != 0) file = NULL;
+            if (file != NULL) FileSeek64(file, (long long)sizeof(header) + count * (long long)recordSize, SEEK_SET);
+            else TraceLog(LOG_WARNING, "PROGRAM: nie mozna otworzyc %s, program tylko w pamieci", fileName);
+        }
+        runs.clear();
+        if (count > 0) runs.push_back({ 0, 0, count });
+        recordCount = count;
+        mappedRecords = 0;
+        tail.swap(live); // bez mapowania punkty zostają w ogonie w pamięci
+        if (file != NULL && Remap()) tail.clear();
+        return true;
+    }
+
+    bool Remap() {
+        if (!mapping.Open(fileName)) return false;
+        mappedRecords = recordCount;
+        return true;
+    }
+
+public:
+    ProgramStore() : file(NULL), jointCount(0), recordSize(0), mappedRecords(0), recordCount(0), count(0), compactAfter(0) {
+        fileName[0] = '\0';
+    }
+
+    ~ProgramStore() {
+        if (file != NULL) fclose(file);
+    }
+
+    // writable == false: tylko odczyt istniejącego programu (tryb wsadowy), plik nie jest tworzony ani zmieniany
+    bool Open(const char* path, int joints, bool writable = true) {
+        strncpy_s(fileName, sizeof(fileName), path, sizeof(fileName) - 1);
+        jointCount = joints;
+        recordSize = sizeof(int) + jointCount * sizeof(float);
+        compactAfter = 0;
+        ProgramFileHeader header;
+        bool existing = mapping.Open(fileName);
+        if (existing) {
+            if (mapping.GetSize() < sizeof(header)) existing = false;
+            else memcpy(&header, mapping.GetData(), sizeof(header));
+            if (existing && (memcmp(header.magic, "RPG1", 4) != 0 || header.version != PROGRAM_FILE_VERSION)) existing = false;
+            if (existing && header.jointCount != jointCount) {
+                // program innego robota - nie nadpisujemy go
+                TraceLog(LOG_WARNING, "PROGRAM: %s zapisany dla %d przegubow, program tylko w pamieci", fileName, header.jointCount);
+                mapping.Close();
+                return false;
+            }
+        }
+        if (existing) {
+            // odtworzenie programu z dziennika; niepełny ostatni rekord (przerwany zapis) jest pomijany i nadpisywany
+            mappedRecords = (long long)((mapping.GetSize() - sizeof(header)) / recordSize);
+            for (long long r = 0; r < mappedRecords; r++) {
+                int type;
+                memcpy(&type, mapping.GetData() + sizeof(header) + r * recordSize, sizeof(int));
+                if (type == PROGRAM_RECORD_ADD) Push(r);
+                else if (type == PROGRAM_RECORD_DELETE) Pop();
+                else if (type == PROGRAM_RECORD_CLEAR) {
+                    runs.clear();
+                    count = 0;
+                }
+            }
+            recordCount = mappedRecords;
+            if (!writable) return true;
+            if (fopen_s(&file, fileName, "r+b") != 0) file = NULL;
+            if (file != NULL) FileSeek64(file, (long long)sizeof(header) + recordCount * (long long)recordSize, SEEK_SET);
+        }
+        else {
+            mapping.Close();
+            if (!writable) return false;
+            if (fopen_s(&file, fileName, "w+b") != 0) file = NULL;
+            if (file != NULL) {
+                memcpy(header.magic, "RPG1", 4);
+                header.version = PROGRAM_FILE_VERSION;
+                header.jointCount = jointCount;
+                header.reserved = 0;
+                fwrite(&header, sizeof(header), 1, file);
+                fflush(file);
+            }
+        }
+        if (file == NULL) TraceLog(LOG_WARNING, "PROGRAM: nie mozna zapisywac %s, program tylko w pamieci", fileName);
+        return file != NULL;
+    }
+
+    void Add(const float* values) {
+        Push(recordCount);
+        Write(PROGRAM_RECORD_ADD, values);
+    }
+
+    // pointCount punktów po jointCount wartości, na dysk wypychane raz
+    void Add(const float* values, int pointCount) {
+        for (int i = 0; i < pointCount; i++) {
+            Push(recordCount);
+            Write(PROGRAM_RECORD_ADD, values + (size_t)i * jointCount, false);
+        }
+        if (file != NULL) fflush(file);
+    }
+
+    void RemoveLast() {
+        if (count == 0) return;
+        Pop();
+        float zeros[MAX_JOINT_COUNT] = { 0 };
+        Write(PROGRAM_RECORD_DELETE, zeros);
+    }
+
+    void Clear() {
+        runs.clear();
+        count = 0;
+        float zeros[MAX_JOINT_COUNT] = { 0 };
+        Write(PROGRAM_RECORD_CLEAR, zeros);
+    }
+
+    long long GetCount() {
+        return count;
+    }
+
+    float GetValue(long long index, int joint) {
+        // punkty czytane wprost z mapowania - system wczytuje tylko strony, po które sięga tryb pracy
+        size_t r = runs.size() - 1;
+        if (runs.size() > 1) {
+            r = std::upper_bound(runs.begin(), runs.end(), index, [](long long i, const Run& run) { return i < run.firstIndex; }) - runs.begin() - 1;
+        }
+        return GetRecord(runs[r].firstRecord + (index - runs[r].firstIndex))[joint];
+    }
+};
+
+// ruch po programie w trybie pracy (punkt-punkt albo po torze sklejanym) na tablicy nastaw - bez modelu i okna,
+// wspólny dla SavedStates i trybu wsadowego
+class ProgramMotion {
+    int jointCount;
+    TrajectoryExecutor executor;
+    SplineTrajectory spline;
+    SplineTrajectory settings; // zakresy, przejście i krok dla kolejnych budów toru
+    SplineBuildTask builder;
+    bool background;     // tor budowany w tle (okno), inaczej od razu w Advance (tryb wsadowy)
+    PathMode pathMode;
+    int splineRevision;  // rewizja programu, z której zbudowano tor
+    int requestedRevision;  // rewizja i tryb ostatniego zlecenia budowy
+    PathMode requestedMode;
+    int splineGeneration;   // licznik podmian toru (podgląd)
+    bool splineRunning;  // false - dojazd do pierwszego punktu ruchem punkt-punkt
+    bool towardsFirst;   // bieżący segment punkt-punkt kończy się w pierwszym punkcie
+    int splineStep;
+    int currentState;
+    int cycleCount;      // ukończone pełne cykle
+    float cycleTime;     // czas symulacji od rozpoczęcia bieżącego cyklu
+    float lastCycleTime; // czas ostatniego pełnego cyklu
+
+    void FinishCycle() {
+        lastCycleTime = cycleTime;
+        cycleTime = 0;
+        cycleCount++;
+    }
+
+    // przebudowa toru po zmianie programu albo rodzaju toru; false - ruch punkt-punkt. W tle do czasu podmiany
+    // jedzie dalej tor już wykonywany (także dla starej rewizji), a bez niego robot jedzie punkt-punkt
+    bool UpdateSpline(ProgramStore& program, int revision) {
+        int count = (int)program.GetCount();
+        if (pathMode == PATH_POINT_TO_POINT || count < 2 || count > SPLINE_MAX_POINTS) return false;
+        if (requestedRevision != revision || requestedMode != pathMode) {
+            std::vector<float> points((size_t)count * jointCount);
+            for (int s = 0; s < count; s++) {
+                for (int j = 0; j < jointCount; j++) points[(size_t)s * jointCount + j] = program.GetValue(s, j);
+            }
+            requestedRevision = revision;
+            requestedMode = pathMode;
+            settings.SetMode(pathMode);
+            if (background) builder.Request(settings, points, count, revision);
+            else {
+                spline = settings;
+                spline.Build(points.data(), count);
+                SwapSpline(revision);
+            }
+        }
+        int builtRevision;
+        if (background && builder.Take(spline, builtRevision)) SwapSpline(builtRevision);
+        if (!spline.IsReady() || spline.GetMode() != pathMode) return false;
+        return splineRevision == revision || splineRunning;
+    }
+
+    void SwapSpline(int revision) {
+        splineRevision = revision;
+        splineGeneration++;
+        if (splineRunning) {
+            // program zmieniony w trakcie ruchu - ponowny dojazd do pierwszego punktu
+            splineRunning = false;
+            towardsFirst = false;
+            currentState = 0;
+            executor.Reset();
+        }
+    }
+
+    void StartNextSegment(ProgramStore& program, const float* positions) {
+        int next = (currentState >= program.GetCount()) ? 1 : currentState + 1;
+        if (next == 1) {
+            // cykl liczony od wyjazdu do pierwszego punktu; pierwszy dojazd z dowolnej pozycji pomijany
+            if (currentState != 0) FinishCycle();
+            cycleTime = 0;
+        }
+        currentState = next;
+        towardsFirst = (next == 1);
+        float to[MAX_JOINT_COUNT];
+        for (int i = 0;i < jointCount;i++) {
+            to[i] = program.GetValue(currentState - 1, i);
+        }
+        executor.Plan(positions, to);
+    }
+
+public:
+    ProgramMotion() : jointCount(0), background(false), pathMode(PATH_POINT_TO_POINT), splineRevision(-1), requestedRevision(-1),
+        requestedMode(PATH_POINT_TO_POINT), splineGeneration(0) {
+        Reset();
+    }
+
+    // budowa toru w wątku w tle - wątek sterowania nie czeka na przeliczenie długiego programu
+    void SetBackgroundBuild(bool enabled) {
+        background = enabled;
+    }
+
+    void SetLimits(int joints, const JointMotionLimits* limits) {
+        jointCount = joints;
+        executor.SetLimits(jointCount, limits);
+        settings.SetLimits(jointCount, limits);
+        settings.SetTimeStep(executor.GetTimeStep());
+        requestedRevision = -1;
+    }
+
+    // zakres nastaw dla torów sklejanych; stepJoint (chwytak) zatrzymuje się w każdym punkcie
+    void SetRange(const float* minValues, const float* maxValues, int stepJoint) {
+        settings.SetRange(minValues, maxValues, stepJoint);
+        requestedRevision = -1;
+    }
+
+    // stopień przejścia przez narożniki torów C1 i piątego stopnia (0 - zatrzymanie w punktach)
+    void SetBlend(float blend) {
+        settings.SetBlend(blend);
+        requestedRevision = -1;
+    }
+
+    float GetBlend() {
+        return settings.GetBlend();
+    }
+
+    void Reset() {
+        currentState = 0;
+        cycleCount = 0;
+        cycleTime = 0;
+        lastCycleTime = 0;
+        splineRunning = false;
+        towardsFirst = false;
+        splineStep = 0;
+        executor.Reset();
+    }
+
+    // ruch odmierzany czasem, a nie klatkami; positions - na wejściu aktualne nastawy, na wyjściu nowe
+    // revision - numer zmiany programu (przebudowa toru); false gdy nie minął żaden krok
+    bool Advance(float frameTime, ProgramStore& program, int revision, float* positions) {
+        if (program.GetCount() == 0) return false;
+        bool moved = false;
+        bool useSpline = UpdateSpline(program, revision);
+        executor.AddTime(frameTime);
+        while (executor.HasPendingStep()) {
+            if (useSpline && splineRunning) {
+                // ruch po torze: odczyt gotowego wiersza tablicy
+                executor.ConsumeStep();
+                spline.Sample(splineStep, positions);
+                currentState = spline.GetSegment(splineStep) + 1;
+                cycleTime += executor.GetTimeStep();
+                if (++splineStep >= spline.GetStepCount()) {
+                    splineStep = 0;
+                    FinishCycle();
+                }
+                moved = true;
+                continue;
+            }
+            if (executor.IsFinished()) {
+                if (useSpline && towardsFirst) {
+                    // robot stoi w pierwszym punkcie - dalej bez zatrzymań po torze
+                    splineRunning = true;
+                    splineStep = 0;
+                    cycleTime = 0;
+                    continue;
+                }
+                StartNextSegment(program, positions);
+            }
+            executor.Step(positions);
+            cycleTime += executor.GetTimeStep();
+            moved = true;
+        }
+        return moved;
+    }
+
+    void SetProfile(ProfileType profile) {
+        executor.SetProfile(profile);
+    }
+
+    void ToggleProfile() {
+        executor.SetProfile((executor.GetProfile() == PROFILE_TRAPEZOIDAL) ? PROFILE_SCURVE : PROFILE_TRAPEZOIDAL);
+    }
+
+    ProfileType GetProfile() {
+        return executor.GetProfile();
+    }
+
+    void SetPathMode(PathMode mode) {
+        pathMode = mode;
+    }
+
+    // kolejny rodzaj toru; zmiana w trakcie pracy kończy bieżący odcinek i przechodzi przez pierwszy punkt
+    void CyclePathMode() {
+        pathMode = (PathMode)((pathMode + 1) % PATH_MODE_COUNT);
+        if (splineRunning) {
+            splineRunning = false;
+            currentState = spline.GetSegment(splineStep) + 1;
+            cycleTime = 0;
+            lastCycleTime = 0;
+        }
+        towardsFirst = false;
+    }
+
+    PathMode GetPathMode() {
+        return pathMode;
+    }
+
+    // tor trybu pracy dla rewizji revision (zlecenie budowy jak w Advance); NULL - punkt-punkt albo tor w budowie
+    SplineTrajectory* GetPath(ProgramStore& program, int revision) {
+        if (!UpdateSpline(program, revision) || splineRevision != revision) return NULL;
+        return &spline;
+    }
+
+    // zmienia się przy każdej podmianie toru
+    int GetSplineGeneration() {
+        return splineGeneration;
+    }
+
+    float GetTimeStep() {
+        return executor.GetTimeStep();
+    }
+
+    float GetLastCycleTime() {
+        return lastCycleTime;
+    }
+
+    int GetCycleCount() {
+        return cycleCount;
+    }
+
+    int GetCurrentState() {
+        return currentState;
+    }
+};
+
+#define ROW_TEXT_SIZE 128
+#define ROW_CACHE_SIZE 256 // sformatowane wiersze panelu (więcej niż mieści się na ekranie)
+
+//zapisane pozycje robota w trybie nauki
+class SavedStates {
+    int statesCount;
+    int jointCount;
+    ProgramStore store;
+    // wiersze panelu formatowane raz i trzymane w małej pamięci podręcznej (slot = numer punktu % ROW_CACHE_SIZE)
+    std::vector<char> rowText;
+    std::vector<int> rowState;
+    RobotArm* robot;
+
+    ProgramMotion motion;
+    int revision;        // zwiększany przy każdej zmianie listy punktów
+public:
+    SavedStates(RobotArm& r, const char* programFile) {
+        revision = 0;
+        robot = &r;
+        jointCount = robot->GetBoneCount() - 1;
+        rowText.resize((size_t)ROW_CACHE_SIZE * ROW_TEXT_SIZE);
+        rowState.assign(ROW_CACHE_SIZE, 0);
+
+        // program zapisany w poprzednich sesjach
+        store.Open(programFile, jointCount);
+        statesCount = (int)store.GetCount();
+
+        JointMotionLimits limits[MAX_JOINT_COUNT];
+        float minValues[MAX_JOINT_COUNT], maxValues[MAX_JOINT_COUNT];
+        for (int i = 0; i < jointCount; i++) {
+            limits[i] = robot->GetMotionLimits(i + 1);
+            robot->GetJointLimits(i + 1, minValues[i], maxValues[i]);
+        }
+        motion.SetLimits(jointCount, limits);
+        motion.SetRange(minValues, maxValues, ManipulatorJoint(robot->GetRestChain()));
+    }
+    //zapisanie pozycji robota
+    void Save() {
+        float values[MAX_JOINT_COUNT];
+        for (int i = 1;i < jointCount + 1;i++) {
+            values[i - 1] = robot->GetJointPosition(i);
+        }
+        Append(values);
+    }
+    //dopisanie punktu o podanych wartościach przegubów (np. z nagrania)
+    void Append(const float* values) {
+        store.Add(values);
+        statesCount++;
+        revision++;
+        int slot = statesCount % ROW_CACHE_SIZE;
+        GetText(&rowText[(size_t)slot * ROW_TEXT_SIZE], statesCount);
+        rowState[slot] = statesCount;
+    }
+    //dopisanie pointCount punktów naraz (nagranie, program z optymalizacji) - jeden zapis na dysk
+    void Append(const float* values, int pointCount) {
+        if (pointCount <= 0) return;
+        store.Add(values, pointCount);
+        for (int i = 1; i <= pointCount; i++) rowState[(statesCount + i) % ROW_CACHE_SIZE] = 0;
+        statesCount += pointCount;
+        revision++;
+    }
+    //usunięcie ostatniej pozycji robota
+    void Delete() {
+        if (statesCount == 0) return;
+        store.RemoveLast();
+        rowState[statesCount % ROW_CACHE_SIZE] = 0;
+        statesCount--;
+        revision++;
+    }
+    //usunięcie całego programu (również z pliku)
+    void Reset() {
+        store.Clear();
+        rowState.assign(ROW_CACHE_SIZE, 0);
+        statesCount = 0;
+        revision++;
+        ResetCurrentState();
+    }
+
+    void ResetCurrentState() {
+        motion.Reset();
+    }
+    //tryb pracy: ruch do kolejnych punktów odmierzany czasem, a nie klatkami
+    void WorkMode(float frameTime) {
+        float positions[MAX_JOINT_COUNT];
+        for (int i = 0;i < jointCount;i++) {
+            positions[i] = robot->GetJointPosition(i + 1);
+        }
+        if (!motion.Advance(frameTime, store, revision, positions)) return;
+        for (int i = 0;i < jointCount;i++) {
+            robot->SetJointPosition(i + 1, positions[i]);
+        }
+    }
+
+    void ToggleProfile() {
+        motion.ToggleProfile();
+    }
+
+    void SetBackgroundBuild(bool enabled) {
+        motion.SetBackgroundBuild(enabled);
+    }
+
+    // kolejny stopień przejścia przez narożniki: 1, 0.75, 0.5, 0.25, 0 i znów 1; zmiana przebudowuje tor
+    void CycleBlend() {
+        float blend = motion.GetBlend() - 0.25f;
+        motion.SetBlend((blend < -0.01f) ? 1.0f : blend);
+    }
+
+    float GetBlend() {
+        return motion.GetBlend();
+    }
+
+    void SetProfile(ProfileType profile) {
+        motion.SetProfile(profile);
+    }
+
+    void SetPathMode(PathMode mode) {
+        motion.SetPathMode(mode);
+        motion.Reset();
+    }
+
+    ProfileType GetProfile() {
+        return motion.GetProfile();
+    }
+
+    void CyclePathMode() {
+        motion.CyclePathMode();
+    }
+
+    PathMode GetPathMode() {
+        return motion.GetPathMode();
+    }
+
+    // tor trybu pracy dla bieżącego programu (podgląd); NULL - punkt-punkt albo tor jeszcze w budowie
+    SplineTrajectory* GetPath() {
+        return motion.GetPath(store, revision);
+    }
+
+    int GetPathGeneration() {
+        return motion.GetSplineGeneration();
+    }
+
+    float GetLastCycleTime() {
+        return motion.GetLastCycleTime();
+    }
+
+    // tekst wiersza formatowany raz - przy zapisie punktu albo przy pierwszym pokazaniu wczytanego punktu
+    const char* GetRowText(int state) {
+        int slot = state % ROW_CACHE_SIZE;
+        char* text = &rowText[(size_t)slot * ROW_TEXT_SIZE];
+        if (rowState[slot] != state) {
+            GetText(text, state);
+            rowState[slot] = state;
+        }
+        return text;
+    }
+
+    void GetText(char* text, int selection) {
+        if (selection > statesCount) return;
+        char buffer[10];
+        _snprintf_s(buffer, 10, "%2d. ",selection);
+        strncpy_s(text, 128 * sizeof(char), buffer, 10 * sizeof(char));
+        for (int i = 0;i < jointCount;i++) {
+            _snprintf_s(buffer, 10, "%7.3f, ", GetJointParameter(selection, i));
+            strncat_s(text, 128 * sizeof(char), buffer, 10 * sizeof(char));
+        }
+        text[strnlen_s(text, 128) - 2] = '\0';
+    }
+
+    float GetJointParameter(int state, int joint) {
+        return store.GetValue(state - 1, joint);
+    }
+
+    int GetStatesCount() {
+        return statesCount;
+    }
+
+    int GetJointCount() {
+        return jointCount;
+    }
+
+    int GetRevision() {
+        return revision;
+    }
+
+    int GetCurrentState() {
+        return motion.GetCurrentState();
+    }
+};
+
+// nagrywanie ruchu prowadzonego przez operatora: próbkowanie ze stałą częstotliwością i redukcja punktów w locie
+// (okno otwierane od ostatniego punktu jak w RDP: punkt zostaje, gdy cięciwa przestaje przybliżać próbki z tolerancją)
+#define RECORD_SAMPLE_RATE 100.0f
+#define RECORD_MAX_WINDOW 256        // maksymalna liczba próbek między punktami
+#define RECORD_FLUSH_POINTS 256      // punkty czekające w pamięci, po których trafiają do programu jednym zapisem
+
+class TeachRecorder {
+    int jointCount;
+    float tolerance[MAX_JOINT_COUNT]; // dopuszczalne odchylenie od cięciwy dla każdego przegubu
+    float quantum[MAX_JOINT_COUNT];   // krok kwantyzacji zapisywanych punktów
+    bool recording;
+    float accumulator;
+    std::vector<float> window;        // próbki od ostatniego punktu (pierwsza = ten punkt)
+    float lastStored[MAX_JOINT_COUNT]; // ostatni punkt po kwantyzacji (początek kolejnego okna)
+    // punkty po kwantyzacji czekające na zapis; dziennik programu ma rekordy stałej długości z bezpośrednim dostępem
+    // przez mapowanie, więc punkty trafiają do niego jako pełne rekordy ADD, bez osobnego strumienia przyrostów
+    std::vector<float> pending;
+    long long sampleCount;
+    long long pointCount;
+
+    float Deviation(const float* a, const float* b, const float* p) {
+        // odległość próbki od cięciwy a-b w przestrzeni złączy unormowanej tolerancjami
+        float ab[MAX_JOINT_COUNT], ap[MAX_JOINT_COUNT];
+        float abab = 0, apab = 0;
+        for (int j = 0; j < jointCount; j++) {
+            ab[j] = (b[j] - a[j]) / tolerance[j];
+            ap[j] = (p[j] - a[j]) / tolerance[j];
+            abab += ab[j] * ab[j];
+            apab += ap[j] * ab[j];
+        }
+        float t = (abab > 0) ? Clamp(apab / abab, 0.0f, 1.0f) : 0.0f;
+        float d = 0;
+        for (int j = 0; j < jointCount; j++) {
+            float e = ap[j] - t * ab[j];
+            d += e * e;
+        }
+        return sqrtf(d);
+    }
+
+    void Keep(const float* values) {
+        // wartości zaokrąglane do kroku kwantyzacji - błąd punktu najwyżej pół kroku, niezależnie od poprzednich
+        for (int j = 0; j < jointCount; j++) lastStored[j] = lroundf(values[j] / quantum[j]) * quantum[j];
+        pending.insert(pending.end(), lastStored, lastStored + jointCount);
+        pointCount++;
+    }
+
+public:
+    TeachRecorder() : jointCount(0), recording(false), accumulator(0), sampleCount(0), pointCount(0) {}
+
+    bool IsRecording() {
+        return recording;
+    }
+
+    void Start(RobotArm& robot) {
+        jointCount = robot.GetBoneCount() - 1;
+        for (int j = 0; j < jointCount; j++) {
+            tolerance[j] = (robot.GetJointType(j + 1) == REVOLUTE) ? 0.5f : 0.01f;
+            quantum[j] = tolerance[j] / 4;
+        }
+        recording = true;
+        accumulator = 0;
+        sampleCount = 0;
+        pointCount = 0;
+        pending.clear();
+        window.clear();
+        float values[MAX_JOINT_COUNT];
+        for (int j = 0; j < jointCount; j++) values[j] = robot.GetJointPosition(j + 1);
+        Keep(values);
+        window.insert(window.end(), values, values + jointCount);
+    }
+
+    void Update(RobotArm& robot, SavedStates& states, float frameTime) {
+        if (!recording) return;
+        accumulator += fminf(frameTime, 0.25f);
+        float step = 1.0f / RECORD_SAMPLE_RATE;
+        while (accumulator >= step) {
+            accumulator -= step;
+            float sample[MAX_JOINT_COUNT];
+            for (int j = 0; j < jointCount; j++) sample[j] = robot.GetJointPosition(j + 1);
+            AddSample(sample);
+        }
+        if (pending.size() >= (size_t)RECORD_FLUSH_POINTS * jointCount) Flush(states);
+    }
+
+    void AddSample(const float* sample) {
+        sampleCount++;
+        int windowCount = (int)window.size() / jointCount;
+        const float* anchor = window.data();
+        bool fits = windowCount < RECORD_MAX_WINDOW;
+        for (int k = 1; k < windowCount && fits; k++) {
+            // 0.75 zamiast 1: zapas na przesunięcie punktów przy kwantyzacji (do pół kroku na przegub)
+            if (Deviation(anchor, sample, &window[(size_t)k * jointCount]) > 0.75f) fits = false;
+        }
+        if (!fits) {
+            // poprzednia próbka staje się punktem i początkiem nowego okna
+            std::vector<float> previous(window.end() - jointCount, window.end());
+            Keep(previous.data());
+            window.assign(lastStored, lastStored + jointCount);
+        }
+        window.insert(window.end(), sample, sample + jointCount);
+    }
+
+    void Flush(SavedStates& states) {
+        // czekające punkty dopisywane do programu naraz - jedno wypchnięcie pliku na zrzut
+        states.Append(pending.data(), (int)(pending.size() / jointCount));
+        pending.clear();
+    }
+
+    void Stop(SavedStates& states) {
+        if (!recording) return;
+        // ostatnia próbka zawsze kończy nagranie
+        int windowCount = (int)window.size() / jointCount;
+        if (windowCount > 1) Keep(&window[(size_t)(windowCount - 1) * jointCount]);
+        Flush(states);
+        window.clear();
+        recording = false;
+    }
+
+    long long GetSampleCount() {
+        return sampleCount;
+    }
+
+    long long GetPointCount() {
+        return pointCount;
+    }
+
+    int GetPendingPoints() {
+        return (jointCount > 0) ? (int)(pending.size() / jointCount) : 0;
+    }
+};
+
+// percentyl z wartości (kolejność w tablicy jest zmieniana)
+float Percentile(std::vector<float>& values, int percent) {
+    size_t rank = std::min(values.size() - 1, values.size() * percent / 100);
+    std::nth_element(values.begin(), values.begin() + rank, values.end());
+    return values[rank];
+}
+
+// nazwana pamięć współdzielona między procesami, bez pliku na dysku
+class SharedMemory {
+    void* data;
+    size_t size;
+#if defined(_WIN32)
+    void* mapping;
+#else
+    char name[64];
+    bool owner; // twórca usuwa nazwę przy zamknięciu
+#endif
+public:
+    SharedMemory() : data(NULL), size(0) {
+#if defined(_WIN32)
+        mapping = NULL;
+#else
+        name[0] = '\0';
+        owner = false;
+#endif
+    }
+
+    ~SharedMemory() {
+        Close();
+    }
+
+    // create - nowy obszar (istniejący o tej nazwie jest zastępowany), inaczej dołączenie do istniejącego
+    bool Open(const char* memoryName, size_t bytes, bool create) {
+        Close();
+#if defined(_WIN32)
+        const unsigned long PAGE_READWRITE_PROTECT = 4, FILE_MAP_ALL = 0xF001F;
+        char fullName[96];
+        _snprintf_s(fullName, sizeof(fullName) - 1, "Local\\%s", memoryName);
+        if (create) mapping = CreateFileMappingA((void*)(long long)-1, NULL, PAGE_READWRITE_PROTECT, (unsigned long)((unsigned long long)bytes >> 32), (unsigned long)bytes, fullName);
+        else mapping = OpenFileMappingA(FILE_MAP_ALL, 0, fullName);
+        if (mapping == NULL) return false;
+        data = MapViewOfFile(mapping, FILE_MAP_ALL, 0, 0, bytes);
+#else
+        _snprintf_s(name, sizeof(name) - 1, "/%s", memoryName);
+        int fd = shm_open(name, create ? (O_CREAT | O_RDWR) : O_RDWR, 0600);
+        if (fd < 0) return false;
+        struct stat st;
+        bool ok = create ? (ftruncate(fd, 0) == 0 && ftruncate(fd, (off_t)bytes) == 0) : (fstat(fd, &st) == 0 && (size_t)st.st_size >= bytes);
+        void* address = ok ? mmap(NULL, bytes, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0) : MAP_FAILED;
+        close(fd);
+        if (address == MAP_FAILED) {
+            if (create) shm_unlink(name);
+            return false;
+        }
+        data = address;
+        owner = create;
+#endif
+        size = bytes;
+        if (data == NULL) {
+            Close();
+            return false;
+        }
+        return true;
+    }
+
+    void Close() {
+#if defined(_WIN32)
+        if (data != NULL) UnmapViewOfFile(data);
+        if (mapping != NULL) CloseHandle(mapping);
+        mapping = NULL;
+#else
+        if (data != NULL) munmap(data, size);
+        if (owner) shm_unlink(name);
+        owner = false;
+#endif
+        data = NULL;
+        size = 0;
+    }
+
+    void* GetData() {
+        return data;
+    }
+};
+
+// Zewnętrzne sterowanie przez IPC: procesy sterownika piszą nastawy złączy do pierścienia w pamięci współdzielonej
+// (jeden pisarz, jeden czytelnik, bez blokad), wątek sterowania czyta najnowsze polecenie wprost ze slotu i odsyła
+// aktualne nastawy w bloku stanu chronionym licznikiem wersji (seqlock). Kanał sterujący (gniazdo Unix, protokół
+// tekstowy linia-odpowiedź) służy do zmiany trybu i odczytu statystyk. Czas wysłania polecenia jest z zegara
+// monotonicznego (wspólny dla procesów), więc obie strony mierzą opóźnienie bez wymiany zegarów.
+#define IPC_VERSION 1
+#define IPC_RING_SIZE 256 // potęga dwójki
+#define IPC_SHARED_NAME "robot_ipc"
+#define IPC_SOCKET_PATH "robot.sock"
+#define IPC_LATENCY_SAMPLES 4096
+#define IPC_LINE_SIZE 256
+#define IPC_READ_SIZE 4096     // bufor odczytu kanału sterującego (jedno recv najwyżej tyle bajtów)
+#define IPC_FRAME_BYTES 16384  // najwięcej bajtów odczytanych w jednej klatce
+#define IPC_FRAME_COMMANDS 32  // najwięcej poleceń obsłużonych w jednej klatce, reszta czeka na kolejną
+
+struct IpcCommand {
+    unsigned long long sequence;    // numer polecenia nadawany przez klienta
+    long long sendTime;             // [ns] zegar monotoniczny klienta
+    float targets[MAX_JOINT_COUNT]; // nastawy złączy 1..jointCount (kolejność jak w programie)
+};
+
+struct IpcState {
+    long long tick;                   // krok sterowania, w którym zapisano stan
+    unsigned long long lastSequence;  // ostatnie zastosowane polecenie (0 - brak)
+    long long lastSendTime;           // jego czas wysłania - klient liczy opóźnienie pełnej pętli
+    float positions[MAX_JOINT_COUNT]; // GetJointPosition złączy 1..jointCount
+};
+
+struct IpcShared {
+    char magic[4]; // "RIPC"
+    int version;
+    int jointCount;
+    int ringSize;
+    alignas(64) std::atomic<unsigned int> head;         // zapisuje klient
+    alignas(64) std::atomic<unsigned int> tail;         // zapisuje symulator
+    alignas(64) std::atomic<unsigned int> stateVersion; // nieparzysta - zapis stanu w toku
+    IpcState state;
+    alignas(64) IpcCommand ring[IPC_RING_SIZE];
+};
+
+inline long long MonotonicNanoseconds() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+// odczyt spójnej kopii stanu (ponawiany, gdy symulator pisał w trakcie)
+inline void ReadIpcState(IpcShared* shared, IpcState& out) {
+    unsigned int before, after;
+    do {
+        before = shared->stateVersion.load(std::memory_order_acquire);
+        memcpy(&out, &shared->state, sizeof(IpcState));
+        std::atomic_thread_fence(std::memory_order_acquire);
+        after = shared->stateVersion.load(std::memory_order_relaxed);
+    } while ((before & 1) || before != after);
+}
+
+// strona symulatora: Poll i Publish z wątku sterowania, Serve z wątku okna - wszystkie pod blokadą sterowania
+class IpcEndpoint {
+    SharedMemory memory;
+    IpcShared* shared;
+    int jointCount;
+    bool direct;     // nastawy bez wygładzania (SetJointPosition)
+    unsigned long long lastSequence;
+    long long lastSendTime;
+    long long received, applied;
+    std::vector<float> latencies; // [us] od wysłania do zastosowania, ostatnie IPC_LATENCY_SAMPLES
+    long long latencyCount;
+    int listenSocket;
+    int clientSocket;
+    char socketFile[108];
+    char input[IPC_READ_SIZE];    // odebrane bajty bez kompletnej linii
+    int inputLength;
+    char commands[IPC_FRAME_COMMANDS][IPC_LINE_SIZE]; // linie z bieżącej klatki
+    int commandCount;
+    std::vector<char> replies;    // odpowiedzi wysyłane po zwolnieniu blokady
+
+    void Reply(const char* text) {
+        replies.insert(replies.end(), text, text + strlen(text));
+    }
+
+    // kompletne linie z bufora do listy poleceń; zbyt długa linia jest obcinana jak dotąd do IPC_LINE_SIZE - 1 znaków
+    void TakeLines() {
+        int start = 0;
+        for (int i = 0; i < inputLength && commandCount < IPC_FRAME_COMMANDS; i++) {
+            if (input[i] != '\n') continue;
+            int length = std::min(i - start, IPC_LINE_SIZE - 1);
+            memcpy(commands[commandCount], input + start, length);
+            commands[commandCount++][length] = '\0';
+            start = i + 1;
+        }
+        inputLength -= start;
+        memmove(input, input + start, inputLength);
+        if (inputLength == IPC_READ_SIZE) inputLength = IPC_LINE_SIZE - 1; // bez końca linii - reszta linii pomijana
+    }
+
+    void Execute(const char* command) {
+        if (strcmp(command, "joints") == 0) {
+            Reply(TextFormat("ok %d\n", jointCount));
+        }
+        else if (strcmp(command, "mode direct") == 0 || strcmp(command, "mode smooth") == 0) {
+            direct = (strcmp(command, "mode direct") == 0);
+            Reply("ok\n");
+        }
+        else if (strcmp(command, "stats") == 0) {
+            float p50 = 0, p99 = 0, max = 0;
+            GetLatency(p50, p99, max);
+            Reply(TextFormat("ok received %lld applied %lld p50_us %.1f p99_us %.1f max_us %.1f mode %s\n",
+                received, applied, p50, p99, max, direct ? "direct" : "smooth"));
+        }
+        else if (strcmp(command, "reset") == 0) {
+            ResetStats();
+            Reply("ok\n");
+        }
+        else {
+            Reply("error nieznane polecenie\n");
+        }
+    }
+
+public:
+    IpcEndpoint() : shared(NULL), jointCount(0), direct(false), lastSequence(0), lastSendTime(0), listenSocket(-1), clientSocket(-1), inputLength(0), commandCount(0) {
+        socketFile[0] = '\0';
+        ResetStats();
+    }
+
+    ~IpcEndpoint() {
+        Close();
+    }
+
+    bool Open(int joints, const char* memoryName, const char* socketPath) {
+        if (!memory.Open(memoryName, sizeof(IpcShared), true)) {
+            TraceLog(LOG_ERROR, "IPC: nie mozna utworzyc pamieci wspoldzielonej %s", memoryName);
+            return false;
+        }
+        jointCount = joints;
+        shared = (IpcShared*)memory.GetData();
+        memset((void*)shared, 0, sizeof(IpcShared));
+        shared->version = IPC_VERSION;
+        shared->jointCount = jointCount;
+        shared->ringSize = IPC_RING_SIZE;
+        std::atomic_thread_fence(std::memory_order_release);
+        memcpy(shared->magic, "RIPC", 4); // znacznik na końcu - klient nie dołączy do niezainicjowanego obszaru
+#if !defined(_WIN32)
+        unlink(socketPath); // gniazdo po poprzednim uruchomieniu
+        sockaddr_un address;
+        memset(&address, 0, sizeof(address));
+        address.sun_family = AF_UNIX;
+        snprintf(address.sun_path, sizeof(address.sun_path), "%s", socketPath); // gałąź POSIX - bez funkcji _s z CRT Microsoftu
+        listenSocket = socket(AF_UNIX, SOCK_STREAM, 0);
+        if (listenSocket < 0 || bind(listenSocket, (sockaddr*)&address, sizeof(address)) != 0 || listen(listenSocket, 1) != 0) {
+            TraceLog(LOG_WARNING, "IPC: kanal sterujacy %s niedostepny", socketPath);
+            if (listenSocket >= 0) close(listenSocket);
+            listenSocket = -1;
+        }
+        else {
+            fcntl(listenSocket, F_SETFL, fcntl(listenSocket, F_GETFL) | O_NONBLOCK);
+            snprintf(socketFile, sizeof(socketFile), "%s", address.sun_path);
+        }
+#else
+        (void)socketPath; // gniazda Unix na Windows wymagają winsock - kanał sterujący tylko na POSIX
+#endif
+        TraceLog(LOG_INFO, "IPC: pamiec %s (%d zlaczy, pierscien %d), kanal %s", memoryName, jointCount, IPC_RING_SIZE, listenSocket >= 0 ? socketPath : "brak");
+        return true;
+    }
+
+    void Close() {
+#if !defined(_WIN32)
+        if (clientSocket >= 0) close(clientSocket);
+        if (listenSocket >= 0) close(listenSocket);
+        if (socketFile[0] != '\0') unlink(socketFile);
+#endif
+        socketFile[0] = '\0';
+        clientSocket = -1;
+        listenSocket = -1;
+        memory.Close();
+        shared = NULL;
+    }
+
+    bool IsOpen() {
+        return shared != NULL;
+    }
+
+    // najnowsze polecenie z pierścienia; starsze z tego samego kroku są pomijane (liczone w received)
+    void Poll(RobotArm& robot) {
+        if (shared == NULL) return;
+        unsigned int tail = shared->tail.load(std::memory_order_relaxed);
+        unsigned int head = shared->head.load(std::memory_order_acquire);
+        if (head == tail || head - tail > IPC_RING_SIZE) return;
+        const IpcCommand& command = shared->ring[(head - 1) & (IPC_RING_SIZE - 1)]; // odczyt wprost ze slotu
+        for (int j = 0; j < jointCount; j++) {
+            float minValue, maxValue;
+            robot.GetJointLimits(j + 1, minValue, maxValue);
+            float value = command.targets[j];
+            if (!(value >= minValue)) value = minValue; // także NaN
+            if (value > maxValue) value = maxValue;
+            if (direct) robot.SetJointPosition(j + 1, value);
+            else robot.UpdateTargetPosition(j + 1, value);
+        }
+        lastSequence = command.sequence;
+        lastSendTime = command.sendTime;
+        shared->tail.store(head, std::memory_order_release);
+        received += head - tail;
+        applied++;
+        latencies[latencyCount++ % IPC_LATENCY_SAMPLES] = (MonotonicNanoseconds() - lastSendTime) / 1000.0f;
+    }
+
+    // stan po kroku sterowania
+    void Publish(RobotArm& robot, long long tick) {
+        if (shared == NULL) return;
+        unsigned int version = shared->stateVersion.load(std::memory_order_relaxed);
+        shared->stateVersion.store(version + 1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+        shared->state.tick = tick;
+        shared->state.lastSequence = lastSequence;
+        shared->state.lastSendTime = lastSendTime;
+        for (int j = 0; j < jointCount; j++) shared->state.positions[j] = robot.GetJointPosition(j + 1);
+        shared->stateVersion.store(version + 2, std::memory_order_release);
+    }
+
+    // odczyt kanału sterującego bez czekania i bez blokady sterowania: nowe połączenie, porcje po IPC_READ_SIZE bajtów,
+    // najwyżej IPC_FRAME_BYTES bajtów i IPC_FRAME_COMMANDS poleceń na klatkę (reszta zostaje w gnieździe albo w buforze)
+    void Receive() {
+        commandCount = 0;
+#if !defined(_WIN32)
+        if (listenSocket < 0) return;
+        int incoming = accept(listenSocket, NULL, NULL);
+        if (incoming >= 0) {
+            // jedno połączenie naraz - nowe zastępuje poprzednie
+            if (clientSocket >= 0) close(clientSocket);
+            clientSocket = incoming;
+            fcntl(clientSocket, F_SETFL, fcntl(clientSocket, F_GETFL) | O_NONBLOCK);
+            inputLength = 0;
+            replies.clear();
+        }
+        int budget = IPC_FRAME_BYTES;
+        while (clientSocket >= 0) {
+            TakeLines();
+            if (commandCount == IPC_FRAME_COMMANDS || budget <= 0) return;
+            ssize_t count = recv(clientSocket, input + inputLength, std::min(IPC_READ_SIZE - inputLength, budget), 0);
+            if (count <= 0) {
+                if (count == 0 || (errno != EAGAIN && errno != EWOULDBLOCK)) {
+                    close(clientSocket);
+                    clientSocket = -1;
+                }
+                return;
+            }
+            inputLength += (int)count;
+            budget -= (int)count;
+        }
+#endif
+    }
+
+    // polecenia odebrane w tej klatce - pod blokadą sterowania (tryb i statystyki dzielone z wątkiem sterowania)
+    void Apply() {
+        for (int i = 0; i < commandCount; i++) Execute(commands[i]);
+        commandCount = 0;
+    }
+
+    // odpowiedzi po zwolnieniu blokady
+    void Flush() {
+#if !defined(_WIN32)
+        if (clientSocket >= 0 && !replies.empty() && send(clientSocket, replies.data(), replies.size(), MSG_NOSIGNAL) < 0) {
+            close(clientSocket);
+            clientSocket = -1;
+        }
+#endif
+        replies.clear();
+    }
+
+    void ResetStats() {
+        received = 0;
+        applied = 0;
+        latencies.assign(IPC_LATENCY_SAMPLES, 0);
+        latencyCount = 0;
+    }
+
+    void GetLatency(float& p50, float& p99, float& max) {
+        int count = (int)std::min<long long>(latencyCount, IPC_LATENCY_SAMPLES);
+        p50 = p99 = max = 0;
+        if (count == 0) return;
+        std::vector<float> values(latencies.begin(), latencies.begin() + count);
+        max = *std::max_element(values.begin(), values.end());
+        p50 = Percentile(values, 50);
+        p99 = Percentile(values, 99);
+    }
+
+    long long GetReceived() {
+        return received;
+    }
+
+    bool IsDirect() {
+        return direct;
+    }
+};
+
+// lokalny klient testowy w miejsce zewnętrznego sterownika: strumień nastaw (sinusoidy wokół pozycji startowej)
+// z zadaną częstotliwością, opóźnienie pełnej pętli z bloku stanu i statystyki symulatora z kanału sterującego
+int RunIpcClient(float seconds, float rate, bool direct) {
+    SharedMemory memory;
+    IpcShared* shared = memory.Open(IPC_SHARED_NAME, sizeof(IpcShared), false) ? (IpcShared*)memory.GetData() : NULL;
+    if (shared == NULL || memcmp(shared->magic, "RIPC", 4) != 0 || shared->version != IPC_VERSION) {
+        printf("IPC: symulator nie dziala (uruchom go z --ipc)\n");
+        return 1;
+    }
+    int jointCount = shared->jointCount;
+    char reply[IPC_LINE_SIZE] = "";
+#if !defined(_WIN32)
+    int control = socket(AF_UNIX, SOCK_STREAM, 0);
+    sockaddr_un address;
+    memset(&address, 0, sizeof(address));
+    address.sun_family = AF_UNIX;
+    snprintf(address.sun_path, sizeof(address.sun_path), "%s", IPC_SOCKET_PATH);
+    if (control >= 0 && connect(control, (sockaddr*)&address, sizeof(address)) != 0) {
+        close(control);
+        control = -1;
+    }
+    // polecenie i odpowiedź do końca linii (symulator odpowiada raz na klatkę)
+    auto request = [&](const char* text) {
+        reply[0] = '\0';
+        if (control < 0 || send(control, text, strlen(text), MSG_NOSIGNAL) < 0) return false;
+        int length = 0;
+        char c;
+        while (length < IPC_LINE_SIZE - 1 && recv(control, &c, 1, 0) == 1 && c != '\n') reply[length++] = c;
+        reply[length] = '\0';
+        return strncmp(reply, "ok", 2) == 0;
+    };
+    request(direct ? "mode direct\n" : "mode smooth\n");
+    request("reset\n");
+#endif
+
+    IpcState state;
+    ReadIpcState(shared, state);
+    float start[MAX_JOINT_COUNT];
+    memcpy(start, state.positions, sizeof(float) * jointCount);
+    unsigned long long sequence = state.lastSequence;
+    unsigned long long seen = state.lastSequence;
+    long long sent = 0, ringFull = 0;
+    std::vector<float> roundTrips; // [us] wysłanie -> stan po zastosowaniu (z dokładnością do okresu wysyłania)
+    roundTrips.reserve((size_t)(seconds * rate) + 1);
+
+    using clock = std::chrono::steady_clock;
+    const clock::duration period = std::chrono::duration_cast<clock::duration>(std::chrono::duration<double>(1.0 / rate));
+    clock::time_point begin = clock::now();
+    clock::time_point next = begin;
+    float elapsed = 0;
+    while (elapsed < seconds) {
+        unsigned int head = shared->head.load(std::memory_order_relaxed);
+        unsigned int tail = shared->tail.load(std::memory_order_acquire);
+        if (head - tail < IPC_RING_SIZE) {
+            // zapis wprost do slotu pierścienia, publikacja przesunięciem head
+            IpcCommand& slot = shared->ring[head & (IPC_RING_SIZE - 1)];
+            for (int j = 0; j < jointCount; j++) {
+                slot.targets[j] = (j < jointCount - 1) ? start[j] + 20.0f * sinf(2 * PI * 0.5f * elapsed + j) : start[j]; // chwytak bez zmian
+            }
+            slot.sequence = ++sequence;
+            slot.sendTime = MonotonicNanoseconds();
+            shared->head.store(head + 1, std::memory_order_release);
+            sent++;
+        }
+        else {
+            ringFull++;
+        }
+        ReadIpcState(shared, state);
+        if (state.lastSequence != seen) {
+            seen = state.lastSequence;
+            roundTrips.push_back((MonotonicNanoseconds() - state.lastSendTime) / 1000.0f);
+        }
+        next += period;
+        std::this_thread::sleep_until(next);
+        elapsed = std::chrono::duration<float>(clock::now() - begin).count();
+    }
+
+    printf("IPC klient: %.1f s, %lld polecen (%.0f/s), pelny pierscien %lld, potwierdzen %d\n",
+        elapsed, sent, sent / elapsed, ringFull, (int)roundTrips.size());
+    if (!roundTrips.empty()) {
+        float max = *std::max_element(roundTrips.begin(), roundTrips.end());
+        float p50 = Percentile(roundTrips, 50);
+        float p99 = Percentile(roundTrips, 99);
+        printf("IPC klient: petla polecenie->stan p50 %.1f us, p99 %.1f us, maks. %.1f us\n", p50, p99, max);
+    }
+#if !defined(_WIN32)
+    if (request("stats\n")) printf("IPC symulator: %s\n", reply + 3);
+    if (control >= 0) close(control);
+#endif
+    return 0;
+}
+
+#define CONTROL_RATE 1000.0f      // domyślna częstotliwość pętli sterowania [Hz]
+#define CONTROL_MAX_CATCHUP 100   // kroki nadrabiane po jednym wybudzeniu; większe opóźnienie jest porzucane
+#define JOINT_SMOOTHING 0.15f     // wygładzanie ruchu złączy na krok 1/JOINT_SMOOTHING_RATE s
+#define JOINT_SMOOTHING_RATE 60.0f
+
+// pętla sterowania o stałej częstotliwości: wykonywanie programu, nagrywanie ruchu, wygładzanie i kinematyka
+// w osobnym wątku, niezależnie od szybkości rysowania. Okno zmienia stan sterowania (klawisze, pola GUI) pod blokadą
+// Lock(), a macierze do rysowania odbiera bez blokady z potrójnego bufora. Bez wątku (rate <= 0) krok wykonuje okno
+// z czasem klatki - tak odtwarzane są nagrania wejścia, żeby przebieg zależał tylko od nagranych czasów klatek.
+class ControlLoop {
+    RobotArm& robot;
+    SavedStates& savedStates;
+    TeachRecorder& recorder;
+    IpcEndpoint* external; // nastawy z innych procesów (NULL - brak)
+    TripleBuffer<ArmSnapshot> snapshots;
+    std::mutex mutex;
+    std::thread thread;
+    std::atomic<bool> running;
+    double period; // [s]
+    bool workMode;
+    long long tick;
+    // statystyki z ostatniej sekundy pracy wątku
+    std::atomic<float> measuredRate;
+    std::atomic<float> maxStepMicros;
+    std::atomic<long long> droppedSteps;
+
+    void Step(float dt) {
+        if (external) external->Poll(robot);
+        if (workMode) savedStates.WorkMode(dt);
+        recorder.Update(robot, savedStates, dt);
+        // to samo tempo dojazdu do nastaw niezależnie od długości kroku
+        robot.UpdateJointsSmooth(1.0f - powf(1.0f - JOINT_SMOOTHING, dt * JOINT_SMOOTHING_RATE));
+        tick++;
+        if (external) external->Publish(robot, tick);
+    }
+
+    void Publish() {
+        ArmSnapshot& pose = snapshots.Back();
+        robot.Publish(pose);
+        pose.tick = tick;
+        snapshots.Publish();
+    }
+
+    void Run() {
+        using clock = std::chrono::steady_clock;
+        const clock::duration step = std::chrono::duration_cast<clock::duration>(std::chrono::duration<double>(period));
+        clock::time_point next = clock::now();
+        clock::time_point windowStart = next;
+        long long windowSteps = 0;
+        float windowMax = 0;
+        while (running.load(std::memory_order_relaxed)) {
+            std::this_thread::sleep_until(next);
+            clock::time_point now = clock::now();
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                // zaległe kroki (niedokładny sen, blokada trzymana przez okno) nadrabiane od razu - czas sterowania
+                // płynie zawsze krokami period
+                for (int n = 0; next <= now && n < CONTROL_MAX_CATCHUP; n++) {
+                    clock::time_point begin = clock::now();
+                    Step((float)period);
+                    windowMax = std::max(windowMax, std::chrono::duration<float, std::micro>(clock::now() - begin).count());
+                    next += step;
+                    windowSteps++;
+                }
+                Publish();
+            }
+            if (next <= now) {
+                long long behind = (now - next) / step + 1;
+                droppedSteps.fetch_add(behind, std::memory_order_relaxed);
+                next += step * behind;
+            }
+            if (now - windowStart >= std::chrono::seconds(1)) {
+                measuredRate.store((float)(windowSteps / std::chrono::duration<double>(now - windowStart).count()), std::memory_order_relaxed);
+                maxStepMicros.store(windowMax, std::memory_order_relaxed);
+                windowStart = now;
+                windowSteps = 0;
+                windowMax = 0;
+            }
+        }
+    }
+
+public:
+    ControlLoop(RobotArm& r, SavedStates& states, TeachRecorder& rec) : robot(r), savedStates(states), recorder(rec), external(NULL),
+        running(false), period(0), workMode(false), tick(0), measuredRate(0), maxStepMicros(0), droppedSteps(0) {
+        Publish(); // pierwsza klatka rysowana z pozycji startowej
+    }
+
+    ~ControlLoop() {
+        Stop();
+    }
+
+    // rate <= 0 - bez wątku, krok w Update
+    void Start(float rate) {
+        Stop();
+        if (rate <= 0) return;
+        period = 1.0 / rate;
+        running = true;
+        thread = std::thread(&ControlLoop::Run, this);
+    }
+
+    void Stop() {
+        if (!running) return;
+        running = false;
+        thread.join();
+    }
+
+    bool IsThreaded() {
+        return running;
+    }
+
+    // blokada stanu sterowania (ramię, program, nagrywanie) na czas obsługi wejścia i rysowania paneli
+    std::unique_lock<std::mutex> Lock() {
+        return std::unique_lock<std::mutex>(mutex);
+    }
+
+    // raz na klatkę pod blokadą; bez wątku wykonuje krok o czasie klatki
+    void Update(float frameTime) {
+        if (IsThreaded()) return;
+        Step(frameTime);
+        Publish();
+    }
+
+    void SetWorkMode(bool enabled) {
+        workMode = enabled;
+    }
+
+    // przed Start
+    void SetExternal(IpcEndpoint* endpoint) {
+        external = endpoint;
+    }
+
+    // najnowszy stan ramienia do rysowania - tylko wątek okna
+    const ArmSnapshot& Acquire() {
+        return snapshots.Acquire();
+    }
+
+    float GetMeasuredRate() {
+        return measuredRate.load(std::memory_order_relaxed);
+    }
+
+    float GetMaxStepMicroseconds() {
+        return maxStepMicros.load(std::memory_order_relaxed);
+    }
+
+    long long GetDroppedSteps() {
+        return droppedSteps.load(std::memory_order_relaxed);
+    }
+};
+
+// podgląd programu: robot w każdym zapisanym punkcie i w próbkach pomiędzy nimi, rysowany instancjami
+const char* ghostVertexShaderCode = R"(
+    #version 330
+    uniform mat4 viewProjection;
+    uniform sampler2D poses;  // wiersz = instancja, 4 teksele na macierz kości, ostatni = kolor
+    uniform int boneCount;
+    in vec3 vertexPosition;
+    in vec3 vertexNormal;
+    layout(location = 6) in float vertexBoneId; // SKIN_BONE_ATTRIB_LOCATION
+
+    out vec3 fragNormal;
+    out vec4 fragColor;
+
+    void main()
+    {
+        int bone = int(vertexBoneId + 0.5);
+        int column = bone * 4;
+        mat4 m = mat4(texelFetch(poses, ivec2(column, gl_InstanceID), 0),
+                      texelFetch(poses, ivec2(column + 1, gl_InstanceID), 0),
+                      texelFetch(poses, ivec2(column + 2, gl_InstanceID), 0),
+                      texelFetch(poses, ivec2(column + 3, gl_InstanceID), 0));
+        fragNormal = mat3(m) * vertexNormal;
+        fragColor = texelFetch(poses, ivec2(boneCount * 4, gl_InstanceID), 0);
+        gl_Position = viewProjection * m * vec4(vertexPosition, 1.0);
+    }
+    )";
+
+#define MAX_INSTANCES 4096 // wysokość tekstury z pozami
+
+// wiele pozycji tego samego robota jednym wywołaniem rysowania: macierze kości i kolor każdej instancji w teksturze RGBA32F
+class InstancedSkinnedDraw {
+    Shader shader;
+    int locViewProjection, locLightDir, locPoses, locBoneCount;
+    unsigned int poseTexture;
+    int textureWidth, textureHeight;
+    int boneCount;
+    int instanceCount;
+    std::vector<float> texels;
+    int drawCalls, uniformUploads; // ostatnie rysowanie (nakładka profilera)
+
+public:
+    InstancedSkinnedDraw() {
+        poseTexture = 0;
+        drawCalls = uniformUploads = 0;
+        textureWidth = textureHeight = 0;
+        boneCount = 0;
+        instanceCount = 0;
+        shader = LoadShaderFromMemory(ghostVertexShaderCode, skinnedFragmentShaderCode);
+        locViewProjection = GetShaderLocation(shader, "viewProjection");
+        locLightDir = GetShaderLocation(shader, "lightDir");
+        locPoses = GetShaderLocation(shader, "poses");
+        locBoneCount = GetShaderLocation(shader, "boneCount");
+    }
+
+    ~InstancedSkinnedDraw() {
+        if (poseTexture != 0) rlUnloadTexture(poseTexture);
+        UnloadShader(shader);
+    }
+
+    bool IsAvailable(const SkinnedRenderer& skinned) {
+        return shader.id != rlGetShaderIdDefault() && skinned.GetVertexArray() != 0;
+    }
+
+    void Begin(int bones, int count) {
+        // przygotowanie bufora na count instancji po bones kości
+        boneCount = bones;
+        instanceCount = (count > MAX_INSTANCES) ? MAX_INSTANCES : count;
+        texels.assign((size_t)(boneCount * 4 + 1) * instanceCount * 4, 0.0f);
+    }
+
+    void SetInstance(int instance, const Matrix* bones, Vector4 color) {
+        if (instance >= instanceCount) return;
+        int width = boneCount * 4 + 1;
+        float* row = &texels[(size_t)instance * width * 4];
+        for (int b = 0; b < boneCount; b++) {
+            Matrix m = bones[b];
+            float columns[16] = { m.m0, m.m1, m.m2, m.m3, m.m4, m.m5, m.m6, m.m7,
+                                  m.m8, m.m9, m.m10, m.m11, m.m12, m.m13, m.m14, m.m15 };
+            memcpy(row + b * 16, columns, sizeof(columns));
+        }
+        float* c = row + (width - 1) * 4;
+        c[0] = color.x;
+        c[1] = color.y;
+        c[2] = color.z;
+        c[3] = color.w;
+    }
+
+    void Upload() {
+        // tekstura tworzona ponownie tylko, gdy trzeba ją powiększyć
+        if (instanceCount == 0) return;
+        int width = boneCount * 4 + 1;
+        if (poseTexture == 0 || width != textureWidth || instanceCount > textureHeight) {
+            if (poseTexture != 0) rlUnloadTexture(poseTexture);
+            textureWidth = width;
+            textureHeight = instanceCount;
+            poseTexture = rlLoadTexture(texels.data(), textureWidth, textureHeight, RL_PIXELFORMAT_UNCOMPRESSED_R32G32B32A32, 1);
+        }
+        else {
+            rlUpdateTexture(poseTexture, 0, 0, width, instanceCount, RL_PIXELFORMAT_UNCOMPRESSED_R32G32B32A32, texels.data());
+        }
+    }
+
+    int GetInstanceCount() {
+        return instanceCount;
+    }
+
+    void Draw(const SkinnedRenderer& skinned, const Camera3D& cam, bool depthWrite) {
+        // depthWrite = false dla półprzezroczystych póz, żeby się wzajemnie nie zasłaniały
+        drawCalls = uniformUploads = 0;
+        if (instanceCount == 0 || poseTexture == 0) return;
+        Matrix view = MatrixLookAt(cam.position, cam.target, cam.up);
+        Matrix projection = MatrixPerspective(cam.fovy * DEG2RAD, (float)GetScreenWidth() / GetScreenHeight(), 0.01f, 1000.0f);
+        Vector3 lightDir = Vector3Normalize({-0.5f, -1.0f, -0.3f});
+        int slot = 0;
+
+        rlDrawRenderBatchActive();
+        rlEnableShader(shader.id);
+        rlSetUniformMatrix(locViewProjection, MatrixMultiply(view, projection));
+        rlSetUniform(locLightDir, &lightDir, SHADER_UNIFORM_VEC3, 1);
+        rlSetUniform(locBoneCount, &boneCount, SHADER_UNIFORM_INT, 1);
+        rlSetUniform(locPoses, &slot, SHADER_UNIFORM_INT, 1);
+        rlActiveTextureSlot(slot);
+        rlEnableTexture(poseTexture);
+        if (!depthWrite) rlDisableDepthMask();
+        rlEnableVertexArray(skinned.GetVertexArray());
+        rlDrawVertexArrayInstanced(0, skinned.GetVertexCount(), instanceCount);
+        rlDisableVertexArray();
+        if (!depthWrite) rlEnableDepthMask();
+        rlDisableTexture();
+        rlDisableShader();
+        drawCalls = 1;
+        uniformUploads = 4;
+    }
+
+    int GetDrawCalls() const {
+        return drawCalls;
+    }
+
+    int GetUniformUploads() const {
+        return uniformUploads;
+    }
+};
+
+class TrajectoryPreview {
+    InstancedSkinnedDraw instances;
+    int builtRevision; // wersja listy punktów, z której zbudowano pozy
+    PathMode builtMode;
+    int builtGeneration; // podmiana toru sklejanego, z której zbudowano pozy (-1 - tor liniowy)
+    int samplesPerSegment;
+    std::vector<float> configurations; // nastawy póz (Capture pod blokadą sterowania)
+    std::vector<bool> isKeyPose;
+    int jointCount;
+    bool pending;              // nastawy skopiowane, pozy jeszcze nie przeliczone
+
+public:
+    TrajectoryPreview() {
+        builtRevision = -1;
+        builtMode = PATH_POINT_TO_POINT;
+        builtGeneration = -1;
+        samplesPerSegment = 24;
+        jointCount = 0;
+        pending = false;
+    }
+
+    bool IsAvailable(const SkinnedRenderer& skinned) {
+        return instances.IsAvailable(skinned);
+    }
+
+    int GetInstanceCount() {
+        return instances.GetInstanceCount();
+    }
+
+    // pod blokadą sterowania: nastawy póz po zmianie listy (nagrywanie dopisuje punkty z wątku sterowania), rodzaju toru
+    // albo po podmianie toru sklejanego; próbki odcinków z tablicy toru trybu pracy, a dla ruchu punkt-punkt
+    // (i do czasu zbudowania toru) liniowo w przestrzeni złączy
+    void Capture(SavedStates& states) {
+        SplineTrajectory* path = states.GetPath();
+        int generation = (path != NULL) ? states.GetPathGeneration() : -1;
+        if (states.GetRevision() == builtRevision && states.GetPathMode() == builtMode && generation == builtGeneration) return;
+        builtRevision = states.GetRevision();
+        builtMode = states.GetPathMode();
+        builtGeneration = generation;
+        int statesCount = states.GetStatesCount();
+        jointCount = states.GetJointCount();
+        pending = true;
+
+        // program jest wykonywany w pętli, więc ostatni odcinek wraca do pierwszego punktu
+        int segments = (statesCount > 1) ? statesCount : 0;
+        int samples = samplesPerSegment;
+        while (samples > 1 && statesCount + segments * (samples - 1) > MAX_INSTANCES) samples--;
+        int count = statesCount + segments * (samples - 1);
+        if (count > MAX_INSTANCES) count = MAX_INSTANCES;
+
+        // konfiguracje przegubów: punkt zapisany, a za nim próbki odcinka do kolejnego punktu
+        configurations.resize((size_t)count * jointCount);
+        isKeyPose.assign(count, false);
+        int config = 0;
+        for (int s = 0; s < statesCount && config < count; s++) {
+            int next = (s + 1) % statesCount;
+            for (int k = 0; k < ((segments > 0) ? samples : 1) && config < count; k++) {
+                float t = (float)k / samples;
+                float* values = &configurations[(size_t)config * jointCount];
+                if (path != NULL && k > 0) path->Sample(path->GetStep(s, t), values);
+                else {
+                    for (int j = 0; j < jointCount; j++) {
+                        float a = states.GetJointParameter(s + 1, j);
+                        float b = states.GetJointParameter(next + 1, j);
+                        values[j] = a + (b - a) * t; // profil zsynchronizowany - tor liniowy w przestrzeni złączy
+                    }
+                }
+                isKeyPose[config] = (k == 0);
+                config++;
+            }
+        }
+    }
+
+    // bez blokady: pozy ze skopiowanych nastaw, łańcuch spoczynkowy i chwytak z modelu (dane stałe)
+    void Update(RobotArm& robot, const SkinnedRenderer& skinned) {
+        // pozy przeliczane tylko po zmianie nastaw
+        if (!pending) return;
+        pending = false;
+        int count = (jointCount > 0) ? (int)(configurations.size() / jointCount) : 0;
+        int armBones = skinned.GetArmBoneCount();
+        int deviceBones = skinned.GetDeviceBoneCount();
+        if (count == 0) {
+            instances.Begin(armBones + deviceBones, 0);
+            return;
+        }
+        JointBatch joints(jointCount, count);
+        for (int i = 0; i < count; i++) joints.SetConfiguration(i, &configurations[(size_t)i * jointCount]);
+
+        PoseBatch poses;
+        const KinematicChain& chain = robot.GetRestChain();
+        BatchKinematics(chain).Compute(joints, poses, true);
+
+        instances.Begin(armBones + deviceBones, count);
+        GripperChain gripper = GripperChainFromModel(robot.GetDevice().GetModel());
+        for (int i = 0; i < count; i++) {
+            Matrix bones[MAX_SKIN_BONES];
+            for (int b = 0; b < armBones; b++) bones[b] = poses.GetPose(i, chain.meshLinks[b]);
+            GripperTransforms(gripper, joints.GetValue(i, jointCount - 1), poses.GetFlange(i), bones + armBones);
+            // punkty zapisane wyraźniej niż próbki pośrednie
+            Vector4 color = isKeyPose[i] ? Vector4{ 0.4f, 0.8f, 1.0f, 0.45f } : Vector4{ 0.3f, 0.6f, 1.0f, 0.12f };
+            instances.SetInstance(i, bones, color);
+        }
+        instances.Upload();
+    }
+
+    void Draw(const SkinnedRenderer& skinned, const Camera3D& cam) {
+        instances.Draw(skinned, cam, false);
+    }
+
+    int GetDrawCalls() const {
+        return instances.GetDrawCalls();
+    }
+
+    int GetUniformUploads() const {
+        return instances.GetUniformUploads();
+    }
+};
+
+// typ robota w celi: model ramienia i chwytaka oraz bufory GPU współdzielone przez wszystkie jego egzemplarze
+struct RobotType {
+    char armFile[256];
+    char deviceFile[256];
+    KinematicChain chain;
+    int jointCount; // wartości przegubów (ostatnia to rozstaw chwytaka)
+    int meshCount;  // siatki ramienia
+    std::unique_ptr<Device> device;
+    std::unique_ptr<SkinnedRenderer> skinned;
+    std::unique_ptr<InstancedSkinnedDraw> instances;
+    std::vector<int> members; // roboty tego typu
+};
+
+// cela robocza z wieloma robotami; dane wszystkich robotów w ciągłych tablicach sceny
+class RobotCell {
+    ModelLibrary& library;
+    Shader& shader;
+    std::vector<std::unique_ptr<RobotType>> types;
+
+    std::vector<int> robotType;
+    std::vector<Matrix> placements;    // położenie podstawy robota w celi
+    std::vector<int> jointOffset;      // początek wartości przegubów robota w joints
+    std::vector<int> linkOffset;       // początek macierzy ogniw robota w linkTransforms
+    std::vector<int> deviceOffset;     // początek macierzy palców chwytaka w deviceTransforms
+    std::vector<float> joints;
+    std::vector<Matrix> linkTransforms;
+    std::vector<Matrix> deviceTransforms;
+    float lastUpdateMicroseconds;
+    int drawCalls, uniformUploads; // ostatnie rysowanie wszystkich typów (nakładka profilera)
+
+    int FindType(const char* armFile, const char* deviceFile) {
+        for (size_t i = 0; i < types.size(); i++) {
+            if (strcmp(types[i]->armFile, armFile) == 0 && strcmp(types[i]->deviceFile, deviceFile) == 0) return (int)i;
+        }
+        std::unique_ptr<RobotType> type(new RobotType());
+        strncpy_s(type->armFile, sizeof(type->armFile), armFile, sizeof(type->armFile) - 1);
+        strncpy_s(type->deviceFile, sizeof(type->deviceFile), deviceFile, sizeof(type->deviceFile) - 1);
+        const Model& model = library.Get(armFile);
+        type->chain = LoadArmChain(model, armFile);
+        type->jointCount = model.boneCount - 1;
+        type->meshCount = model.meshCount;
+        type->device.reset(new Device(library, deviceFile, shader));
+        type->skinned.reset(new SkinnedRenderer());
+        type->skinned->Build(model, type->device->GetModel());
+        type->instances.reset(new InstancedSkinnedDraw());
+        types.push_back(std::move(type));
+        return (int)types.size() - 1;
+    }
+
+public:
+    RobotCell(ModelLibrary& lib, Shader& shaderRef) : library(lib), shader(shaderRef) {
+        lastUpdateMicroseconds = 0;
+        drawCalls = uniformUploads = 0;
+    }
+
+    int AddRobot(const char* armFile, const char* deviceFile, Vector3 position, float yaw) {
+        // robot stoi w position, obrócony o yaw stopni wokół osi Y
+        int t = FindType(armFile, deviceFile);
+        RobotType& type = *types[t];
+        int robot = (int)robotType.size();
+        robotType.push_back(t);
+        placements.push_back(MatrixMultiply(MatrixRotateY(yaw * DEG2RAD), MatrixTranslate(position.x, position.y, position.z)));
+        jointOffset.push_back((int)joints.size());
+        linkOffset.push_back((int)linkTransforms.size());
+        deviceOffset.push_back((int)deviceTransforms.size());
+        for (int j = 0; j < type.jointCount; j++) {
+            joints.push_back((j == type.jointCount - 1) ? type.device->GetPosition() : 0.0f);
+        }
+        linkTransforms.resize(linkTransforms.size() + type.chain.linkCount);
+        deviceTransforms.resize(deviceTransforms.size() + type.device->GetBoneCount());
+        type.members.push_back(robot);
+        return robot;
+    }
+
+    int GetRobotCount() {
+        return (int)robotType.size();
+    }
+
+    int GetTypeCount() {
+        return (int)types.size();
+    }
+
+    int GetJointCount(int robot) {
+        return types[robotType[robot]]->jointCount;
+    }
+
+    float* GetJoints(int robot) {
+        // wskaźnik ważny do dodania kolejnego robota
+        return &joints[jointOffset[robot]];
+    }
+
+    const Matrix* GetLinkTransforms(int robot) {
+        return &linkTransforms[linkOffset[robot]];
+    }
+
+    float GetLastUpdateMicroseconds() {
+        return lastUpdateMicroseconds;
+    }
+
+    void Update() {
+        // kinematyka wszystkich robotów: jedno przejście wsadowe na typ robota
+        auto start = std::chrono::steady_clock::now();
+        PoseBatch poses;
+        for (size_t t = 0; t < types.size(); t++) {
+            RobotType& type = *types[t];
+            int count = (int)type.members.size();
+            if (count == 0) continue;
+            JointBatch batch(type.jointCount, count);
+            for (int k = 0; k < count; k++) {
+                batch.SetConfiguration(k, &joints[jointOffset[type.members[k]]]);
+            }
+            BatchKinematics(type.chain).Compute(batch, poses, true);
+            for (int k = 0; k < count; k++) {
+                int robot = type.members[k];
+                Matrix* links = &linkTransforms[linkOffset[robot]];
+                for (int l = 0; l < type.chain.linkCount; l++) {
+                    links[l] = MatrixMultiply(poses.GetPose(k, l), placements[robot]);
+                }
+                type.device->ComputeTransforms(batch.GetValue(k, type.jointCount - 1), links[type.chain.linkCount - 1], &deviceTransforms[deviceOffset[robot]]);
+            }
+        }
+        lastUpdateMicroseconds = std::chrono::duration<float, std::micro>(std::chrono::steady_clock::now() - start).count();
+    }
+
+    void Draw(const Camera3D& cam) {
+        // jedno wywołanie rysowania na typ robota
+        drawCalls = uniformUploads = 0;
+        for (size_t t = 0; t < types.size(); t++) {
+            RobotType& type = *types[t];
+            if (type.members.empty() || !type.instances->IsAvailable(*type.skinned)) continue;
+            int deviceBones = type.skinned->GetDeviceBoneCount();
+            type.instances->Begin(type.meshCount + deviceBones, (int)type.members.size());
+            for (size_t k = 0; k < type.members.size(); k++) {
+                int robot = type.members[k];
+                Matrix bones[MAX_SKIN_BONES];
+                for (int b = 0; b < type.meshCount; b++) bones[b] = linkTransforms[linkOffset[robot] + type.chain.meshLinks[b]];
+                for (int b = 0; b < deviceBones; b++) bones[type.meshCount + b] = deviceTransforms[deviceOffset[robot] + b];
+                type.instances->SetInstance((int)k, bones, { 0.85f, 0.85f, 0.85f, 1.0f });
+            }
+            type.instances->Upload();
+            type.instances->Draw(*type.skinned, cam, true);
+            drawCalls += type.instances->GetDrawCalls();
+            uniformUploads += type.instances->GetUniformUploads();
+        }
+    }
+
+    int GetDrawCalls() {
+        return drawCalls;
+    }
+
+    int GetUniformUploads() {
+        return uniformUploads;
+    }
+};
+
+// czcionka TTF rasteryzowana leniwie: glify dodawane do atlasu przy pierwszym użyciu, osobno dla każdego rozmiaru
+class GlyphCache {
+    struct SizedFont {
+        int size;
+        Font font;
+        Image atlas;  // GRAY_ALPHA, jak atlasy raylib
+        std::vector<GlyphInfo> glyphs;
+        std::vector<Rectangle> recs;
+        int penX, penY, rowHeight; // pozycja wstawiania w bieżącym wierszu atlasu
+        float scale;
+        bool changed;    // atlas zmieniony od ostatniego wysłania na GPU
+    };
+    static const int padding = 2;
+    static const int atlasWidth = 256;
+
+    unsigned char* fileData;
+    stbtt_fontinfo info;
+    bool loaded;
+    int ascent;
+    std::vector<std::unique_ptr<SizedFont>> fonts;
+
+    SizedFont& GetSized(int size) {
+        for (size_t i = 0; i < fonts.size(); i++) {
+            if (fonts[i]->size == size) return *fonts[i];
+        }
+        std::unique_ptr<SizedFont> f(new SizedFont());
+        f->size = size;
+        f->font = Font();
+        f->font.baseSize = size;
+        f->font.glyphPadding = padding;
+        f->atlas = GenImageColor(atlasWidth, 32, BLANK);
+        ImageFormat(&f->atlas, PIXELFORMAT_UNCOMPRESSED_GRAY_ALPHA);
+        f->penX = f->penY = f->rowHeight = 0;
+        f->scale = stbtt_ScaleForPixelHeight(&info, (float)size);
+        f->changed = true;
+        // znaki ASCII są potrzebne zawsze, reszta (polskie litery, °) dopiero gdy pojawi się w tekście
+        for (int c = 32; c < 127; c++) AddGlyph(*f, c);
+        fonts.push_back(std::move(f));
+        return *fonts.back();
+    }
+
+    bool HasGlyph(const SizedFont& f, int codepoint) {
+        for (size_t i = 0; i < f.glyphs.size(); i++) {
+            if (f.glyphs[i].value == codepoint) return true;
+        }
+        return false;
+    }
+
+    void AddGlyph(SizedFont& f, int codepoint) {
+        if (stbtt_FindGlyphIndex(&info, codepoint) == 0 && codepoint != 32) return; // brak w czcionce - raylib pokaże '?'
+        int w = 0, h = 0, offsetX = 0, offsetY = 0;
+        unsigned char* bitmap = stbtt_GetCodepointBitmap(&info, 0, f.scale, codepoint, &w, &h, &offsetX, &offsetY);
+        int advance = 0, leftBearing = 0;
+        stbtt_GetCodepointHMetrics(&info, codepoint, &advance, &leftBearing);
+
+        // pakowanie półkowe: kolejne glify w wierszu, nowy wiersz gdy brak miejsca, atlas rośnie w dół
+        int cellW = w + 2 * padding;
+        int cellH = h + 2 * padding;
+        if (f.penX + cellW > f.atlas.width) {
+            f.penX = 0;
+            f.penY += f.rowHeight;
+            f.rowHeight = 0;
+        }
+        if (f.penY + cellH > f.atlas.height) {
+            int height = f.atlas.height;
+            while (f.penY + cellH > height) height *= 2;
+            ImageResizeCanvas(&f.atlas, f.atlas.width, height, 0, 0, BLANK);
+        }
+        unsigned char* pixels = (unsigned char*)f.atlas.data;
+        for (int y = 0; y < h; y++) {
+            for (int x = 0; x < w; x++) {
+                unsigned char* p = pixels + ((size_t)(f.penY + padding + y) * f.atlas.width + (f.penX + padding + x)) * 2;
+                p[0] = 255;
+                p[1] = bitmap[y * w + x];
+            }
+        }
+        if (bitmap != NULL) stbtt_FreeBitmap(bitmap, NULL);
+
+        GlyphInfo glyph = {};
+        glyph.value = codepoint;
+        glyph.offsetX = offsetX;
+        glyph.offsetY = offsetY + (int)(ascent * f.scale);
+        glyph.advanceX = (int)(advance * f.scale);
+        f.glyphs.push_back(glyph);
+        f.recs.push_back({ (float)(f.penX + padding), (float)(f.penY + padding), (float)w, (float)h });
+        f.penX += cellW;
+        if (cellH > f.rowHeight) f.rowHeight = cellH;
+        f.changed = true;
+    }
+
+    void Upload(SizedFont& f) {
+        // tablice mogły zostać przeniesione przy dodawaniu glifów
+        f.font.glyphs = f.glyphs.data();
+        f.font.recs = f.recs.data();
+        f.font.glyphCount = (int)f.glyphs.size();
+        if (!f.changed) return;
+        if (f.font.texture.id == 0 || f.font.texture.height != f.atlas.height) {
+            // dotychczasowe wywołania w buforze rlgl korzystają jeszcze ze starej tekstury
+            rlDrawRenderBatchActive();
+            if (f.font.texture.id != 0) UnloadTexture(f.font.texture);
+            f.font.texture = LoadTextureFromImage(f.atlas);
+        }
+        else {
+            UpdateTexture(f.font.texture, f.atlas.data);
+        }
+        f.changed = false;
+    }
+
+public:
+    GlyphCache(const char* fileName) {
+        int size = 0;
+        fileData = LoadFileData(fileName, &size);
+        loaded = fileData != NULL && stbtt_InitFont(&info, fileData, stbtt_GetFontOffsetForIndex(fileData, 0));
+        ascent = 0;
+        if (loaded) {
+            int descent = 0, lineGap = 0;
+            stbtt_GetFontVMetrics(&info, &ascent, &descent, &lineGap);
+        }
+    }
+
+    ~GlyphCache() {
+        for (size_t i = 0; i < fonts.size(); i++) {
+            UnloadImage(fonts[i]->atlas);
+            if (fonts[i]->font.texture.id != 0) UnloadTexture(fonts[i]->font.texture);
+        }
+        UnloadFileData(fileData);
+    }
+
+    // czcionka w danym rozmiarze zawierająca wszystkie znaki tekstu
+    Font Get(int size, const char* text = NULL) {
+        if (!loaded) return GetFontDefault();
+        SizedFont& f = GetSized(size);
+        if (text != NULL) {
+            for (int i = 0; text[i] != '\0';) {
+                int bytes = 0;
+                int codepoint = GetCodepointNext(text + i, &bytes);
+                if (codepoint >= 127 && !HasGlyph(f, codepoint)) AddGlyph(f, codepoint);
+                i += (bytes > 0) ? bytes : 1;
+            }
+        }
+        Upload(f);
+        return f.font;
+    }
+
+    bool IsLoaded() {
+        return loaded;
+    }
+
+    int GetGlyphCount() {
+        int count = 0;
+        for (size_t i = 0; i < fonts.size(); i++) count += (int)fonts[i]->glyphs.size();
+        return count;
+    }
+
+    size_t GetAtlasBytes() {
+        size_t bytes = 0;
+        for (size_t i = 0; i < fonts.size(); i++) bytes += (size_t)fonts[i]->atlas.width * fonts[i]->atlas.height * 2;
+        return bytes;
+    }
+};
+
+// szkielet modelu glTF (kości i pozycja spoczynkowa) bez siatek i kontekstu GL; pozycja spoczynkowa składana
+// z rodziców jak w LoadModel, więc łańcuchy DH wychodzą takie same jak w oknie. Zwalniany przez UnloadModel.
+Model LoadSkeleton(const char* fileName) {
+    Model model;
+    memset(&model, 0, sizeof(model));
+    model.transform = MatrixIdentity();
+    cgltf_options options;
+    memset(&options, 0, sizeof(options));
+    cgltf_data* data = NULL;
+    if (cgltf_parse_file(&options, fileName, &data) != cgltf_result_success) {
+        TraceLog(LOG_WARNING, "SKELETON: nie mozna wczytac %s", fileName);
+        return model;
+    }
+    if (data->skins_count == 1) {
+        const cgltf_skin& skin = data->skins[0];
+        model.boneCount = (int)skin.joints_count;
+        model.bones = (BoneInfo*)MemAlloc(model.boneCount * sizeof(BoneInfo));
+        model.bindPose = (Transform*)MemAlloc(model.boneCount * sizeof(Transform));
+        for (int i = 0; i < model.boneCount; i++) {
+            const cgltf_node* node = skin.joints[i];
+            if (node->name != NULL) strncpy_s(model.bones[i].name, sizeof(model.bones[i].name), node->name, sizeof(model.bones[i].name) - 1);
+            model.bones[i].parent = -1;
+            for (int j = 0; j < model.boneCount; j++) {
+                if (skin.joints[j] == node->parent) model.bones[i].parent = j;
+            }
+            model.bindPose[i].translation = { node->translation[0], node->translation[1], node->translation[2] };
+            model.bindPose[i].rotation = { node->rotation[0], node->rotation[1], node->rotation[2], node->rotation[3] };
+            model.bindPose[i].scale = { node->scale[0], node->scale[1], node->scale[2] };
+        }
+        for (int i = 0; i < model.boneCount; i++) {
+            int parent = model.bones[i].parent;
+            if (parent < 0 || parent > i) continue;
+            Transform& t = model.bindPose[i];
+            const Transform& p = model.bindPose[parent];
+            t.rotation = QuaternionMultiply(p.rotation, t.rotation);
+            t.translation = Vector3Add(Vector3RotateByQuaternion(t.translation, p.rotation), p.translation);
+            t.scale = Vector3Multiply(t.scale, p.scale);
+        }
+    }
+    else {
+        TraceLog(LOG_WARNING, "SKELETON: %s - oczekiwany jeden szkielet, jest %d", fileName, (int)data->skins_count);
+    }
+    cgltf_free(data);
+    return model;
+}
+
+// szkielet i trójkąty siatek (tylko położenia i indeksy) bez kontekstu GL - obliczenia bez okna; siatki numerowane
+// jak w LoadModel (każdy prymityw osobno, prymitywy inne niż trójkąty zostają puste). Zwalniany przez UnloadModel.
+Model LoadGeometry(const char* fileName) {
+    Model model = LoadSkeleton(fileName);
+    cgltf_options options;
+    memset(&options, 0, sizeof(options));
+    cgltf_data* data = NULL;
+    if (cgltf_parse_file(&options, fileName, &data) != cgltf_result_success) return model;
+    if (cgltf_load_buffers(&options, data, fileName) != cgltf_result_success) {
+        TraceLog(LOG_WARNING, "GEOMETRY: brak danych siatek %s", fileName);
+        cgltf_free(data);
+        return model;
+    }
+    int primitiveCount = 0;
+    for (size_t i = 0; i < data->meshes_count; i++) primitiveCount += (int)data->meshes[i].primitives_count;
+    model.meshCount = primitiveCount;
+    model.meshes = (Mesh*)MemAlloc(std::max(1, primitiveCount) * sizeof(Mesh));
+    int index = 0;
+    for (size_t i = 0; i < data->meshes_count; i++) {
+        for (size_t p = 0; p < data->meshes[i].primitives_count; p++, index++) {
+            const cgltf_primitive& primitive = data->meshes[i].primitives[p];
+            Mesh& mesh = model.meshes[index];
+            if (primitive.type != cgltf_primitive_type_triangles) continue;
+            for (size_t a = 0; a < primitive.attributes_count; a++) {
+                const cgltf_accessor* positions = primitive.attributes[a].data;
+                if (primitive.attributes[a].type != cgltf_attribute_type_position || positions->type != cgltf_type_vec3) continue;
+                mesh.vertexCount = (int)positions->count;
+                mesh.vertices = (float*)MemAlloc(mesh.vertexCount * 3 * sizeof(float));
+                cgltf_accessor_unpack_floats(positions, mesh.vertices, (cgltf_size)mesh.vertexCount * 3);
+            }
+            if (primitive.indices != NULL) {
+                // indeksy 16-bitowe jak w LoadModel
+                mesh.triangleCount = (int)primitive.indices->count / 3;
+                mesh.indices = (unsigned short*)MemAlloc((unsigned int)primitive.indices->count * sizeof(unsigned short));
+                for (size_t k = 0; k < primitive.indices->count; k++) mesh.indices[k] = (unsigned short)cgltf_accessor_read_index(primitive.indices, k);
+            }
+            else mesh.triangleCount = mesh.vertexCount / 3;
+        }
+    }
+    cgltf_free(data);
+    return model;
+}
+
+// tryb wsadowy: programy wykonywane bez okna na symulowanej trajektorii, wiele programów naraz na wszystkich rdzeniach
+#define BATCH_MAX_SIMULATED_TIME 3600.0f // [s] zabezpieczenie przed programem, który nigdy nie kończy cyklu
+#define BATCH_LIMIT_MARGIN 1.05f         // zapas na błąd różnic skończonych przy sprawdzaniu prędkości i przyspieszeń
+#define BATCH_ACCEL_STRIDE 5             // przyspieszenie z różnic co tyle kroków - szum zaokrągleń nastaw float maleje z kwadratem
+
+struct BatchResult {
+    bool loaded;
+    int points;
+    int cycles;
+    float cycleTime;        // czas ostatniego pełnego cyklu [s]
+    double simulatedTime;   // z dojazdem do pierwszego punktu [s]
+    long long positionViolations;     // kroki z nastawą poza zakresem złącza
+    unsigned violatingJoints;         // maska przegubów z dowolnym naruszeniem (bit 0 - przegub 1)
+    long long velocityViolations;
+    long long accelerationViolations;
+    float worstVelocity;     // największy stosunek do ograniczenia
+    float worstAcceleration;
+    float finalJoints[MAX_JOINT_COUNT];
+    Vector3 finalTCP;
+    Vector3 fingers[2];
+    float milliseconds;      // czas obliczeń
+};
+
+class BatchRunner {
+    KinematicChain arm;
+    GripperChain gripper;
+    InverseKinematics kinematics; // tylko kinematyka prosta końcowych pozycji
+    JointMotionLimits limits[MAX_JOINT_COUNT];
+    float minLimits[MAX_JOINT_COUNT];
+    float maxLimits[MAX_JOINT_COUNT];
+    float home[MAX_JOINT_COUNT]; // nastawy pozycji spoczynkowej modelu - start symulacji
+    int jointCount;
+    PathMode pathMode;
+    ProfileType profile;
+    float blend;
+    int cycles;
+
+public:
+    BatchRunner() : jointCount(0), pathMode(PATH_POINT_TO_POINT), profile(PROFILE_TRAPEZOIDAL), blend(1), cycles(1) {
+    }
+
+    bool Load(const char* armFile, const char* deviceFile) {
+        Model armModel = LoadSkeleton(armFile);
+        Model deviceModel = LoadSkeleton(deviceFile);
+        bool ok = armModel.boneCount >= 5 && deviceModel.boneCount >= 3;
+        if (ok) {
+            arm = LoadArmChain(armModel, armFile);
+            gripper = GripperChainFromModel(deviceModel);
+            kinematics.SetChain(arm);
+            jointCount = arm.linkCount - 1;
+            for (int j = 0; j < jointCount; j++) {
+                JointType jt = arm.jointTypes[j + 1];
+                limits[j] = arm.motionLimits[j + 1];
+                minLimits[j] = arm.minLimits[j + 1];
+                maxLimits[j] = arm.maxLimits[j + 1];
+                // jak RobotArm::GetJointPosition dla modelu w pozycji spoczynkowej
+                if (jt == REVOLUTE) home[j] = arm.DHparameters[j + 1].x * RAD2DEG;
+                else if (jt == PRISMATIC) home[j] = arm.DHparameters[j + 1].y;
+                else home[j] = gripper.DHparameters[2].y - gripper.DHparameters[1].y;
+            }
+        }
+        else {
+            TraceLog(LOG_ERROR, "BATCH: niepelne szkielety %s (%d kosci) / %s (%d kosci)", armFile, armModel.boneCount, deviceFile, deviceModel.boneCount);
+        }
+        UnloadModel(armModel);
+        UnloadModel(deviceModel);
+        return ok;
+    }
+
+    void SetPathMode(PathMode mode) { pathMode = mode; }
+    void SetProfile(ProfileType p) { profile = p; }
+    void SetBlend(float b) { blend = b; }
+    void SetCycles(int count) { cycles = (count < 1) ? 1 : count; }
+    int GetJointCount() { return jointCount; }
+
+    // jeden program: dojazd z pozycji spoczynkowej i zadana liczba pełnych cykli krok po kroku integratora
+    BatchResult Run(const char* programFile) {
+        auto start = std::chrono::steady_clock::now();
+        BatchResult result;
+        memset(&result, 0, sizeof(result));
+        ProgramStore store;
+        result.loaded = store.Open(programFile, jointCount, false);
+        result.points = (int)store.GetCount();
+        if (!result.loaded || result.points == 0) {
+            result.loaded = false;
+            return result;
+        }
+
+        ProgramMotion motion;
+        motion.SetLimits(jointCount, limits);
+        motion.SetRange(minLimits, maxLimits, ManipulatorJoint(arm));
+        motion.SetBlend(blend);
+        motion.SetPathMode(pathMode);
+        motion.SetProfile(profile);
+        float dt = motion.GetTimeStep();
+        const int historySize = 2 * BATCH_ACCEL_STRIDE + 1;
+        float positions[MAX_JOINT_COUNT];
+        float history[historySize][MAX_JOINT_COUNT]; // ostatnie nastawy, history[step % historySize]
+        for (int j = 0; j < jointCount; j++) {
+            positions[j] = home[j];
+            for (int h = 0; h < historySize; h++) history[h][j] = home[j];
+        }
+        double time = 0;
+        long long step = 0;
+        float strideTime = BATCH_ACCEL_STRIDE * dt;
+        while (motion.GetCycleCount() < cycles && time < BATCH_MAX_SIMULATED_TIME) {
+            motion.Advance(dt, store, 0, positions);
+            time += dt;
+            step++;
+            const float* previous = history[(step - 1) % historySize];
+            const float* back = history[(step - BATCH_ACCEL_STRIDE + historySize) % historySize];
+            const float* back2 = history[(step - 2 * BATCH_ACCEL_STRIDE + historySize) % historySize];
+            for (int j = 0; j < jointCount; j++) {
+                bool violation = false;
+                if (positions[j] < minLimits[j] - 1e-3f || positions[j] > maxLimits[j] + 1e-3f) {
+                    result.positionViolations++;
+                    violation = true;
+                }
+                float vRatio = fabsf(positions[j] - previous[j]) / dt / limits[j].velocity;
+                float a = ((positions[j] - back[j]) - (back[j] - back2[j])) / (strideTime * strideTime);
+                float aRatio = fabsf(a) / limits[j].acceleration;
+                result.worstVelocity = fmaxf(result.worstVelocity, vRatio);
+                result.worstAcceleration = fmaxf(result.worstAcceleration, aRatio);
+                if (vRatio > BATCH_LIMIT_MARGIN) {
+                    result.velocityViolations++;
+                    violation = true;
+                }
+                if (aRatio > BATCH_LIMIT_MARGIN) {
+                    result.accelerationViolations++;
+                    violation = true;
+                }
+                if (violation) result.violatingJoints |= 1u << j;
+            }
+            memcpy(history[step % historySize], positions, jointCount * sizeof(float));
+        }
+
+        result.cycles = motion.GetCycleCount();
+        result.cycleTime = motion.GetLastCycleTime();
+        result.simulatedTime = time;
+        for (int j = 0; j < jointCount; j++) result.finalJoints[j] = positions[j];
+        Matrix frames[MAX_JOINT_COUNT], fingers[MAX_JOINT_COUNT];
+        kinematics.ForwardFrames(positions, frames);
+        const Matrix& flange = frames[arm.linkCount - 1];
+        result.finalTCP = { flange.m12, flange.m13, flange.m14 };
+        GripperTransforms(gripper, positions[jointCount - 1], flange, fingers);
+        for (int f = 0; f < 2; f++) result.fingers[f] = { fingers[f + 1].m12, fingers[f + 1].m13, fingers[f + 1].m14 };
+        result.milliseconds = std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - start).count();
+        return result;
+    }
+
+    // wszystkie programy na threads wątkach (0 - liczba rdzeni); raport na stdout, zwraca liczbę programów z błędami
+    int RunAll(char** files, int count, int threads) {
+        auto start = std::chrono::steady_clock::now();
+        std::vector<BatchResult> results(count);
+        std::atomic<int> next(0);
+        if (threads <= 0) threads = (int)std::thread::hardware_concurrency();
+        threads = std::max(1, std::min(threads, count));
+        std::vector<std::thread> workers;
+        for (int t = 0; t < threads; t++) {
+            workers.emplace_back([&]() {
+                for (int i = next++; i < count; i = next++) results[i] = Run(files[i]);
+            });
+        }
+        for (std::thread& worker : workers) worker.join();
+        float wall = std::chrono::duration<float>(std::chrono::steady_clock::now() - start).count();
+
+        int failed = 0;
+        double simulated = 0;
+        for (int i = 0; i < count; i++) {
+            const BatchResult& r = results[i];
+            if (!r.loaded) {
+                printf("%s: BLAD - brak programu, pusty albo dla innego robota\n", files[i]);
+                failed++;
+                continue;
+            }
+            bool violations = r.positionViolations || r.velocityViolations || r.accelerationViolations || r.cycles < cycles;
+            if (violations) failed++;
+            simulated += r.simulatedTime;
+            printf("%s: %s, %d pkt, cykl %.3f s (%d cykli), naruszenia: zakres %lld, predkosc %lld (maks. %.2f), przyspieszenie %lld (maks. %.2f)\n",
+                files[i], violations ? "BLAD" : "OK", r.points, r.cycleTime, r.cycles, r.positionViolations, r.velocityViolations, r.worstVelocity,
+                r.accelerationViolations, r.worstAcceleration);
+            if (r.violatingJoints) {
+                printf("    przeguby z naruszeniami:");
+                for (int j = 0; j < jointCount; j++) {
+                    if (r.violatingJoints & (1u << j)) printf(" %d", j + 1);
+                }
+                printf("\n");
+            }
+            printf("    nastawy koncowe:");
+            for (int j = 0; j < jointCount; j++) printf(" %.3f", r.finalJoints[j]);
+            printf("\n    TCP (%.3f, %.3f, %.3f), palce (%.3f, %.3f, %.3f) (%.3f, %.3f, %.3f), obliczenia %.1f ms\n",
+                r.finalTCP.x, r.finalTCP.y, r.finalTCP.z, r.fingers[0].x, r.fingers[0].y, r.fingers[0].z,
+                r.fingers[1].x, r.fingers[1].y, r.fingers[1].z, r.milliseconds);
+        }
+        printf("Programy: %d, z bledami: %d, watki: %d, czas %.3f s, symulowano %.1f s (%.0fx szybciej niz w czasie rzeczywistym)\n",
+            count, failed, threads, wall, simulated, wall > 0 ? simulated / wall : 0);
+        return failed;
+    }
+};
+
+// równoległe przetwarzanie fragmentów 0..count-1 z podkradaniem pracy: każdy wątek zaczyna od własnego ciągłego
+// zakresu i bierze z niego fragmenty od początku, a bezczynny zabiera innemu wątkowi połowę pozostałego zakresu.
+// Zakres [begin, end) wątku to jedna liczba 64-bitowa, więc wzięcie i kradzież to pojedyncze CAS.
+// Zwraca liczbę kradzieży.
+int RunWorkStealing(int count, int threads, const std::function<void(int worker, int chunk)>& work) {
+    struct alignas(64) Range {
+        std::atomic<unsigned long long> value;
+    };
+    auto pack = [](unsigned int begin, unsigned int end) { return ((unsigned long long)end << 32) | begin; };
+    std::vector<Range> ranges(threads);
+    for (int t = 0; t < threads; t++) {
+        ranges[t].value.store(pack((unsigned int)((long long)count * t / threads), (unsigned int)((long long)count * (t + 1) / threads)));
+    }
+    std::atomic<int> steals(0);
+    auto body = [&](int self) {
+        std::atomic<unsigned long long>& own = ranges[self].value;
+        for (;;) {
+            unsigned long long range = own.load(std::memory_order_acquire);
+            unsigned int begin = (unsigned int)range, end = (unsigned int)(range >> 32);
+            if (begin < end) {
+                if (own.compare_exchange_weak(range, pack(begin + 1, end), std::memory_order_acq_rel)) work(self, (int)begin);
+                continue;
+            }
+            bool stolen = false;
+            for (int k = 1; k < threads && !stolen; k++) {
+                std::atomic<unsigned long long>& victim = ranges[(self + k) % threads].value;
+                unsigned long long other = victim.load(std::memory_order_acquire);
+                while (!stolen && (unsigned int)other < (unsigned int)(other >> 32)) {
+                    unsigned int otherBegin = (unsigned int)other, otherEnd = (unsigned int)(other >> 32);
+                    unsigned int half = (otherEnd - otherBegin + 1) / 2;
+                    if (victim.compare_exchange_weak(other, pack(otherBegin, otherEnd - half), std::memory_order_acq_rel)) {
+                        own.store(pack(otherEnd - half, otherEnd), std::memory_order_release);
+                        steals++;
+                        stolen = true;
+                    }
+                }
+            }
+            // wszystkie zakresy puste; skradziony, a jeszcze nie zapisany zakres dokończy złodziej
+            if (!stolen) return;
+        }
+    };
+    std::vector<std::thread> workers;
+    for (int t = 1; t < threads; t++) workers.emplace_back(body, t);
+    body(0);
+    for (std::thread& worker : workers) worker.join();
+    return steals;
+}
+
+// Mapa zasięgu: konfiguracje z regularnej siatki w zakresach złączy, kinematyka prosta paczkami (BatchKinematics)
+// i rzadka siatka wokseli z liczbą trafień oraz wskaźnikiem manipulowalności sqrt(det(J J^T)) jakobianu położenia.
+// Wynik zapisywany obok modelu robota (.reach) z kluczem z tablicy DH, zakresów i parametrów próbkowania.
+#define REACH_FILE_VERSION 1
+#define REACH_SAMPLES_PER_JOINT 128
+#define REACH_VOXEL_SIZE 1.0f   // jak oczko siatki w widoku
+#define REACH_CHUNK 4096        // konfiguracje w jednym fragmencie pracy
+#define REACH_MANIPULABILITY_SCALE 1000.0f // suma manipulowalności w liczbach całkowitych - wynik niezależny od kolejności wątków
+
+struct ReachVoxel {
+    unsigned long long manipulabilitySum; // * REACH_MANIPULABILITY_SCALE
+    int x, y, z;                          // indeks woksela (środek = (x + 0.5) * rozmiar)
+    unsigned int count;                   // trafienia
+    float meanManipulability;
+    float maxManipulability;
+};
+
+struct ReachMapHeader {
+    char magic[4]; // "RRM1"
+    int version;
+    unsigned long long key;
+    int samplesPerJoint;
+    float voxelSize;
+    long long configurations;
+    int voxelCount;
+    float maxManipulability; // największa średnia woksela (skala kolorów)
+};
+
+class ReachabilityMap {
+    KinematicChain chain;
+    int jointCount;
+    int activeJoints[MAX_JOINT_COUNT]; // złącza zmieniające położenie końcówki (bez chwytaka)
+    int activeCount;
+    float minLimits[MAX_JOINT_COUNT];
+    float maxLimits[MAX_JOINT_COUNT];
+    int samplesPerJoint;
+    float voxelSize;
+    std::vector<ReachVoxel> voxels; // posortowane po (x, y, z)
+    long long configurations;
+    float maxManipulability;
+    float milliseconds;
+    int threadsUsed;
+    int steals;
+    bool fromCache;
+
+    static unsigned long long VoxelKey(int x, int y, int z) {
+        return ((unsigned long long)(x + (1 << 20)) << 42) | ((unsigned long long)(y + (1 << 20)) << 21) | (unsigned long long)(z + (1 << 20));
+    }
+
+    void Hash(unsigned long long& h, const void* data, size_t size) {
+        // FNV-1a
+        const unsigned char* bytes = (const unsigned char*)data;
+        for (size_t i = 0; i < size; i++) {
+            h ^= bytes[i];
+            h *= 1099511628211ULL;
+        }
+    }
+
+    // fragment konfiguracji [first, first + REACH_CHUNK): nastawy z indeksu siatki, kinematyka, jakobian, woksele
+    void ComputeChunk(long long first, JointBatch& joints, PoseBatch& poses, std::unordered_map<unsigned long long, ReachVoxel>& grid) {
+        int count = (int)std::min<long long>(REACH_CHUNK, configurations - first);
+        float values[MAX_JOINT_COUNT] = { 0 };
+        for (int c = 0; c < REACH_CHUNK; c++) {
+            long long index = first + std::min(c, count - 1); // dopełnienie paczki ostatnią konfiguracją
+            for (int a = activeCount - 1; a >= 0; a--) {
+                int j = activeJoints[a];
+                int sample = (int)(index % samplesPerJoint);
+                index /= samplesPerJoint;
+                values[j] = minLimits[j] + (maxLimits[j] - minLimits[j]) * sample / (samplesPerJoint - 1);
+            }
+            joints.SetConfiguration(c, values);
+        }
+        BatchKinematics(chain).Compute(joints, poses, true);
+        int flange = chain.linkCount - 1;
+        for (int c = 0; c < count; c++) {
+            Vector3 tcp = { poses.GetStream(flange, 9)[c], poses.GetStream(flange, 10)[c], poses.GetStream(flange, 11)[c] };
+            // kolumny jakobianu jak w InverseKinematics: oś Y ogniwa, dla obrotu oś x (TCP - początek ogniwa)
+            float A[3][3] = { { 0 } };
+            for (int a = 0; a < activeCount; a++) {
+                int link = activeJoints[a] + 1;
+                Vector3 axis = { poses.GetStream(link, 3)[c], poses.GetStream(link, 4)[c], poses.GetStream(link, 5)[c] };
+                Vector3 column = axis;
+                if (chain.jointTypes[link] == REVOLUTE) {
+                    Vector3 origin = { poses.GetStream(link, 9)[c], poses.GetStream(link, 10)[c], poses.GetStream(link, 11)[c] };
+                    column = Vector3CrossProduct(axis, Vector3Subtract(tcp, origin));
+                }
+                const float v[3] = { column.x, column.y, column.z };
+                for (int r = 0; r < 3; r++) {
+                    for (int k = 0; k < 3; k++) A[r][k] += v[r] * v[k];
+                }
+            }
+            float det = A[0][0] * (A[1][1] * A[2][2] - A[1][2] * A[2][1]) - A[0][1] * (A[1][0] * A[2][2] - A[1][2] * A[2][0])
+                + A[0][2] * (A[1][0] * A[2][1] - A[1][1] * A[2][0]);
+            float manipulability = sqrtf(fmaxf(det, 0.0f));
+
+            int x = (int)floorf(tcp.x / voxelSize), y = (int)floorf(tcp.y / voxelSize), z = (int)floorf(tcp.z / voxelSize);
+            ReachVoxel& voxel = grid[VoxelKey(x, y, z)];
+            if (voxel.count == 0) {
+                voxel.x = x;
+                voxel.y = y;
+                voxel.z = z;
+            }
+            voxel.count++;
+            voxel.manipulabilitySum += (unsigned long long)llroundf(manipulability * REACH_MANIPULABILITY_SCALE);
+            voxel.maxManipulability = fmaxf(voxel.maxManipulability, manipulability);
+        }
+    }
+
+public:
+    ReachabilityMap() : jointCount(0), activeCount(0), samplesPerJoint(REACH_SAMPLES_PER_JOINT), voxelSize(REACH_VOXEL_SIZE),
+        configurations(0), maxManipulability(0), milliseconds(0), threadsUsed(0), steals(0), fromCache(false) {
+        chain.linkCount = 0;
+    }
+
+    void SetChain(const KinematicChain& c) {
+        chain = c;
+        jointCount = chain.linkCount - 1;
+        activeCount = 0;
+        for (int j = 0; j < jointCount; j++) {
+            minLimits[j] = chain.minLimits[j + 1];
+            maxLimits[j] = chain.maxLimits[j + 1];
+            if (chain.jointTypes[j + 1] != MANIPULATOR) activeJoints[activeCount++] = j;
+            else minLimits[j] = maxLimits[j] = 0;
+        }
+    }
+
+    void SetSampling(int samples, float voxel) {
+        samplesPerJoint = std::max(2, samples);
+        voxelSize = voxel;
+    }
+
+    // klucz pamięci podręcznej: łańcuch DH, zakresy złączy i parametry próbkowania
+    unsigned long long GetKey() {
+        unsigned long long h = 14695981039346656037ULL;
+        int version = REACH_FILE_VERSION;
+        Hash(h, &version, sizeof(version));
+        Hash(h, &chain.linkCount, sizeof(chain.linkCount));
+        Hash(h, &chain.base, sizeof(chain.base));
+        Hash(h, chain.DHparameters, sizeof(Vector4) * chain.linkCount);
+        Hash(h, chain.jointTypes, sizeof(JointType) * chain.linkCount);
+        Hash(h, minLimits, sizeof(float) * jointCount);
+        Hash(h, maxLimits, sizeof(float) * jointCount);
+        Hash(h, &samplesPerJoint, sizeof(samplesPerJoint));
+        Hash(h, &voxelSize, sizeof(voxelSize));
+        return h;
+    }
+
+    void Compute(int threads) {
+        auto start = std::chrono::steady_clock::now();
+        configurations = 1;
+        for (int a = 0; a < activeCount; a++) configurations *= samplesPerJoint;
+        int chunks = (int)((configurations + REACH_CHUNK - 1) / REACH_CHUNK);
+        if (threads <= 0) threads = (int)std::thread::hardware_concurrency();
+        threads = std::max(1, std::min(threads, chunks));
+
+        // stan każdego wątku osobno, łączony po zakończeniu
+        std::vector<std::unique_ptr<JointBatch>> joints;
+        std::vector<PoseBatch> poses(threads);
+        std::vector<std::unordered_map<unsigned long long, ReachVoxel>> grids(threads);
+        for (int t = 0; t < threads; t++) joints.emplace_back(new JointBatch(jointCount, REACH_CHUNK));
+        steals = RunWorkStealing(chunks, threads, [&](int worker, int chunk) {
+            ComputeChunk((long long)chunk * REACH_CHUNK, *joints[worker], poses[worker], grids[worker]);
+        });
+
+        std::unordered_map<unsigned long long, ReachVoxel>& merged = grids[0];
+        for (int t = 1; t < threads; t++) {
+            for (auto& entry : grids[t]) {
+                ReachVoxel& voxel = merged[entry.first];
+                if (voxel.count == 0) voxel = entry.second;
+                else {
+                    voxel.count += entry.second.count;
+                    voxel.manipulabilitySum += entry.second.manipulabilitySum;
+                    voxel.maxManipulability = fmaxf(voxel.maxManipulability, entry.second.maxManipulability);
+                }
+            }
+            grids[t].clear();
+        }
+        voxels.clear();
+        voxels.reserve(merged.size());
+        maxManipulability = 0;
+        for (auto& entry : merged) {
+            ReachVoxel voxel = entry.second;
+            voxel.meanManipulability = (float)((double)voxel.manipulabilitySum / REACH_MANIPULABILITY_SCALE / voxel.count);
+            maxManipulability = fmaxf(maxManipulability, voxel.meanManipulability);
+            voxels.push_back(voxel);
+        }
+        std::sort(voxels.begin(), voxels.end(), [](const ReachVoxel& a, const ReachVoxel& b) {
+            return VoxelKey(a.x, a.y, a.z) < VoxelKey(b.x, b.y, b.z);
+        });
+        threadsUsed = threads;
+        fromCache = false;
+        milliseconds = std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - start).count();
+    }
+
+    bool Save(const char* fileName) {
+        FILE* file = NULL;
+        if (fopen_s(&file, fileName, "wb") != 0 || file == NULL) return false;
+        ReachMapHeader header;
+        memset(&header, 0, sizeof(header));
+        memcpy(header.magic, "RRM1", 4);
+        header.version = REACH_FILE_VERSION;
+        header.key = GetKey();
+        header.samplesPerJoint = samplesPerJoint;
+        header.voxelSize = voxelSize;
+        header.configurations = configurations;
+        header.voxelCount = (int)voxels.size();
+        header.maxManipulability = maxManipulability;
+        bool ok = fwrite(&header, sizeof(header), 1, file) == 1 && fwrite(voxels.data(), sizeof(ReachVoxel), voxels.size(), file) == voxels.size();
+        fclose(file);
+        return ok;
+    }
+
+    // false gdy brak pliku albo policzony dla innego łańcucha/próbkowania
+    bool Load(const char* fileName) {
+        auto start = std::chrono::steady_clock::now();
+        FILE* file = NULL;
+        if (fopen_s(&file, fileName, "rb") != 0 || file == NULL) return false;
+        ReachMapHeader header;
+        bool ok = fread(&header, sizeof(header), 1, file) == 1 && memcmp(header.magic, "RRM1", 4) == 0 && header.version == REACH_FILE_VERSION
+            && header.key == GetKey() && header.voxelCount >= 0;
+        if (ok) {
+            voxels.resize(header.voxelCount);
+            ok = fread(voxels.data(), sizeof(ReachVoxel), voxels.size(), file) == voxels.size();
+        }
+        fclose(file);
+        if (!ok) return false;
+        configurations = header.configurations;
+        maxManipulability = header.maxManipulability;
+        fromCache = true;
+        threadsUsed = 0;
+        steals = 0;
+        milliseconds = std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - start).count();
+        return true;
+    }
+
+    // odczyt z pliku, a gdy nieaktualny - obliczenie i zapis
+    void LoadOrCompute(const char* fileName, int threads) {
+        if (Load(fileName)) return;
+        Compute(threads);
+        if (!Save(fileName)) TraceLog(LOG_WARNING, "REACH: nie mozna zapisac %s", fileName);
+    }
+
+    const std::vector<ReachVoxel>& GetVoxels() const { return voxels; }
+    float GetVoxelSize() const { return voxelSize; }
+    float GetMaxManipulability() const { return maxManipulability; }
+    long long GetConfigurations() const { return configurations; }
+    float GetMilliseconds() const { return milliseconds; }
+    int GetThreads() const { return threadsUsed; }
+    int GetSteals() const { return steals; }
+    bool IsFromCache() const { return fromCache; }
+};
+
+inline void GetReachMapPath(const char* robotFile, char* path, int size) {
+    // mapa leży obok modelu robota
+    snprintf(path, size, "%s.reach", robotFile);
+}
+
+// mapa zasięgu w widoku 3D: półprzezroczyste sześciany wokseli, kolor od czerwonego (słabe uwarunkowanie)
+// do zielonego (największa manipulowalność). Liczona albo wczytywana w tle przy pierwszym włączeniu.
+class ReachOverlay {
+    ReachabilityMap map;
+    char cachePath[300];
+    std::thread worker;
+    std::atomic<bool> done;
+    bool started;
+    Mesh mesh;
+    Material material;
+    bool uploaded;
+
+    void Build() {
+        const std::vector<ReachVoxel>& voxels = map.GetVoxels();
+        float size = map.GetVoxelSize();
+        float half = size * 0.45f;
+        memset(&mesh, 0, sizeof(mesh));
+        mesh.vertexCount = (int)voxels.size() * 36;
+        mesh.triangleCount = (int)voxels.size() * 12;
+        mesh.vertices = (float*)MemAlloc(mesh.vertexCount * 3 * sizeof(float));
+        mesh.colors = (unsigned char*)MemAlloc(mesh.vertexCount * 4);
+        // ściana: normalna n i styczne u, v (u x v = n), wierzchołki przeciwnie do ruchu wskazówek zegara od zewnątrz
+        const Vector3 faces[6][3] = {
+            { { 1, 0, 0 }, { 0, 1, 0 }, { 0, 0, 1 } }, { { -1, 0, 0 }, { 0, 0, 1 }, { 0, 1, 0 } },
+            { { 0, 1, 0 }, { 0, 0, 1 }, { 1, 0, 0 } }, { { 0, -1, 0 }, { 1, 0, 0 }, { 0, 0, 1 } },
+            { { 0, 0, 1 }, { 1, 0, 0 }, { 0, 1, 0 } }, { { 0, 0, -1 }, { 0, 1, 0 }, { 1, 0, 0 } } };
+        const float corners[6][2] = { { -1, -1 }, { 1, -1 }, { 1, 1 }, { -1, -1 }, { 1, 1 }, { -1, 1 } };
+        float maxManipulability = fmaxf(map.GetMaxManipulability(), 1e-6f);
+        int v = 0;
+        for (const ReachVoxel& voxel : voxels) {
+            Vector3 center = { (voxel.x + 0.5f) * size, (voxel.y + 0.5f) * size, (voxel.z + 0.5f) * size };
+            Color color = ColorFromHSV(120.0f * voxel.meanManipulability / maxManipulability, 0.85f, 0.95f);
+            color.a = 24;
+            for (int f = 0; f < 6; f++) {
+                for (int k = 0; k < 6; k++, v++) {
+                    Vector3 p = Vector3Add(center, Vector3Scale(Vector3Add(faces[f][0], Vector3Add(Vector3Scale(faces[f][1], corners[k][0]), Vector3Scale(faces[f][2], corners[k][1]))), half));
+                    mesh.vertices[v * 3] = p.x;
+                    mesh.vertices[v * 3 + 1] = p.y;
+                    mesh.vertices[v * 3 + 2] = p.z;
+                    memcpy(&mesh.colors[v * 4], &color, 4);
+                }
+            }
+        }
+        UploadMesh(&mesh, false);
+        material = LoadMaterialDefault();
+        uploaded = true;
+    }
+
+public:
+    ReachOverlay() : done(false), started(false), uploaded(false) {
+        cachePath[0] = '\0';
+        memset(&mesh, 0, sizeof(mesh));
+    }
+
+    ~ReachOverlay() {
+        if (worker.joinable()) worker.join();
+        if (uploaded) {
+            UnloadMesh(mesh);
+            UnloadMaterial(material);
+        }
+    }
+
+    // łańcuch z pozycji spoczynkowej modelu - klucz mapy nie zależy od bieżących nastaw
+    void Start(const KinematicChain& chain, const char* robotFile) {
+        if (started) return;
+        started = true;
+        map.SetChain(chain);
+        GetReachMapPath(robotFile, cachePath, sizeof(cachePath));
+        worker = std::thread([this]() {
+            map.LoadOrCompute(cachePath, 0);
+            done.store(true, std::memory_order_release);
+        });
+    }
+
+    bool IsReady() {
+        return done.load(std::memory_order_acquire);
+    }
+
+    void Draw() {
+        if (!IsReady()) return;
+        if (!uploaded) Build();
+        // bez zapisu głębokości - woksele nie zasłaniają robota ani siebie nawzajem
+        rlDrawRenderBatchActive();
+        rlDisableDepthMask();
+        DrawMesh(mesh, material, MatrixIdentity());
+        rlEnableDepthMask();
+    }
+
+    const ReachabilityMap& GetMap() {
+        return map;
+    }
+};
+
+// Planowanie ruchu między punktami programu (RRT-Connect) w przestrzeni złączy znormalizowanej do zakresów [0, 1].
+// Krawędź sprawdzana jest paczką: kinematyka prosta wszystkich konfiguracji naraz (BatchKinematics), potem kolizje
+// ramienia i chwytaka (CollisionChecker: własne ogniwa, podłoga, prostopadłościany sceny) od środka krawędzi
+// w kolejności bisekcji - kolizja zwykle wychodzi po kilku sprawdzeniach.
+#define PLANNER_STEP 0.08f        // krok rozrostu drzewa (ułamek zakresu złącza)
+#define PLANNER_RESOLUTION 0.01f  // odstęp sprawdzanych konfiguracji na krawędzi (ułamek zakresu złącza)
+#define PLANNER_MAX_NODES 20000
+#define PLANNER_TIMEOUT 5.0f      // [s] na odcinek
+#define PLANNER_SHORTCUTS 100     // próby skrócenia znalezionej ścieżki
+
+// drzewo k-d budowane przyrostowo (węzły drzew RRT dochodzą w losowej kolejności, więc bez równoważenia)
+class JointKdTree {
+    struct Node {
+        int left, right;
+    };
+    int dims;
+    std::vector<float> points;
+    std::vector<Node> nodes;
+
+    void Search(int node, int depth, const float* p, int& best, float& bestDistance) const {
+        if (node < 0) return;
+        const float* q = &points[(size_t)node * dims];
+        float distance = 0;
+        for (int d = 0; d < dims; d++) distance += (p[d] - q[d]) * (p[d] - q[d]);
+        if (distance < bestDistance) {
+            bestDistance = distance;
+            best = node;
+        }
+        int axis = depth % dims;
+        float delta = p[axis] - q[axis];
+        Search(delta < 0 ? nodes[node].left : nodes[node].right, depth + 1, p, best, bestDistance);
+        // druga gałąź tylko gdy płaszczyzna podziału jest bliżej niż najlepszy punkt
+        if (delta * delta < bestDistance) Search(delta < 0 ? nodes[node].right : nodes[node].left, depth + 1, p, best, bestDistance);
+    }
+
+public:
+    JointKdTree() : dims(1) {}
+
+    void Reset(int dimensions) {
+        dims = dimensions;
+        points.clear();
+        nodes.clear();
+    }
+
+    int Add(const float* p) {
+        int index = (int)nodes.size();
+        points.insert(points.end(), p, p + dims);
+        nodes.push_back({ -1, -1 });
+        if (index == 0) return index;
+        int node = 0;
+        for (int depth = 0;; depth++) {
+            int axis = depth % dims;
+            int& child = (p[axis] < points[(size_t)node * dims + axis]) ? nodes[node].left : nodes[node].right;
+            if (child < 0) {
+                child = index;
+                return index;
+            }
+            node = child;
+        }
+    }
+
+    int Nearest(const float* p) const {
+        int best = -1;
+        float bestDistance = FLT_MAX;
+        Search(nodes.empty() ? -1 : 0, 0, p, best, bestDistance);
+        return best;
+    }
+
+    const float* Get(int index) const {
+        return &points[(size_t)index * dims];
+    }
+
+    int GetCount() const {
+        return (int)nodes.size();
+    }
+};
+
+struct PlannedSegment {
+    bool found;
+    const char* status;            // opis wyniku dla panelu i logu
+    float solutionMilliseconds;    // do pierwszego połączenia drzew
+    float milliseconds;            // razem ze skracaniem
+    float length;                  // długość ścieżki w przestrzeni złączy (stopnie / jednostki)
+    float straightLength;          // długość odcinka prostego
+    int nodes;                     // węzły obu drzew
+    long long checks;              // sprawdzone konfiguracje
+    std::vector<float> path;       // konfiguracje od początku do końca odcinka (jointCount na punkt)
+    std::vector<Vector3> tcp;      // tor końcówki do podglądu
+};
+
+// planer jednego odcinka; osobny egzemplarz (z własną kopią sprawdzania kolizji) na każdy wątek
+class SegmentPlanner {
+    KinematicChain chain;
+    GripperChain gripper;
+    CollisionChecker collision;
+    int jointCount;
+    int gripperJoint; // nastawa chwytaka (rozstaw palców) albo -1
+    float minLimits[MAX_JOINT_COUNT];
+    float maxLimits[MAX_JOINT_COUNT];
+    JointKdTree trees[2];
+    std::vector<int> parents[2];
+    PoseBatch poses;
+    std::mt19937 random;
+    long long checks;
+
+    void ToJoints(const float* u, float* q) {
+        for (int j = 0; j < jointCount; j++) q[j] = minLimits[j] + u[j] * (maxLimits[j] - minLimits[j]);
+    }
+
+    void ToUnit(const float* q, float* u) {
+        for (int j = 0; j < jointCount; j++) u[j] = (maxLimits[j] > minLimits[j]) ? Clamp((q[j] - minLimits[j]) / (maxLimits[j] - minLimits[j]), 0, 1) : 0;
+    }
+
+    float JointDistance(const float* a, const float* b) {
+        float sum = 0;
+        for (int j = 0; j < jointCount; j++) sum += (a[j] - b[j]) * (a[j] - b[j]);
+        return sqrtf(sum);
+    }
+
+    bool PoseCollides(int index, float opening) {
+        Matrix arm[MAX_JOINT_COUNT];
+        Matrix device[MAX_JOINT_COUNT];
+        for (int link = 0; link < chain.linkCount; link++) arm[link] = poses.GetPose(index, link);
+        GripperTransforms(gripper, opening, arm[chain.linkCount - 1], device);
+        checks++;
+        return collision.Update(arm, device);
+    }
+
+    // konfiguracje krawędzi a -> b (bez a) co PLANNER_RESOLUTION, kinematyka paczką, kolizje w kolejności bisekcji
+    bool EdgeValid(const float* a, const float* b, bool includeStart = false) {
+        float longest = 0;
+        for (int j = 0; j < jointCount; j++) longest = fmaxf(longest, fabsf(b[j] - a[j]));
+        int count = std::max(1, (int)ceilf(longest / PLANNER_RESOLUTION)) + (includeStart ? 1 : 0);
+        int offset = includeStart ? 0 : 1;
+        int steps = count - (includeStart ? 1 : 0);
+        JointBatch joints(jointCount, count);
+        std::vector<float> openings(count, 0.0f);
+        float u[MAX_JOINT_COUNT], q[MAX_JOINT_COUNT];
+        for (int k = 0; k < count; k++) {
+            float t = (float)(k + offset) / std::max(1, steps);
+            for (int j = 0; j < jointCount; j++) u[j] = a[j] + (b[j] - a[j]) * t;
+            ToJoints(u, q);
+            joints.SetConfiguration(k, q);
+            if (gripperJoint >= 0) openings[k] = q[gripperJoint];
+        }
+        BatchKinematics(chain).Compute(joints, poses, true);
+        int stride = 1;
+        while (stride * 2 <= count) stride *= 2;
+        std::vector<char> visited(count, 0);
+        for (; stride >= 1; stride /= 2) {
+            for (int k = stride - 1; k < count; k += stride) {
+                if (visited[k]) continue;
+                visited[k] = 1;
+                if (PoseCollides(k, openings[k])) return false;
+            }
+        }
+        return true;
+    }
+
+    // krok drzewa w stronę target; 0 - zablokowany, 1 - przybliżony, 2 - osiągnięty
+    int Extend(int tree, const float* target) {
+        int nearest = trees[tree].Nearest(target);
+        const float* from = trees[tree].Get(nearest);
+        float next[MAX_JOINT_COUNT];
+        float distance = JointDistance(from, target);
+        bool reached = distance <= PLANNER_STEP;
+        for (int j = 0; j < jointCount; j++) next[j] = reached ? target[j] : from[j] + (target[j] - from[j]) * PLANNER_STEP / distance;
+        if (!EdgeValid(from, next)) return 0;
+        trees[tree].Add(next);
+        parents[tree].push_back(nearest);
+        return reached ? 2 : 1;
+    }
+
+    void AppendBranch(int tree, int node, std::vector<float>& out, bool towardsRoot) {
+        std::vector<int> chainNodes;
+        for (int n = node; n >= 0; n = parents[tree][n]) chainNodes.push_back(n);
+        if (!towardsRoot) std::reverse(chainNodes.begin(), chainNodes.end());
+        for (int n : chainNodes) out.insert(out.end(), trees[tree].Get(n), trees[tree].Get(n) + jointCount);
+    }
+
+public:
+    SegmentPlanner(const KinematicChain& arm, const GripperChain& device, const CollisionChecker& checker, unsigned int seed)
+        : chain(arm), gripper(device), collision(checker), random(seed), checks(0) {
+        jointCount = chain.linkCount - 1;
+        gripperJoint = -1;
+        for (int j = 0; j < jointCount; j++) {
+            minLimits[j] = chain.minLimits[j + 1];
+            maxLimits[j] = chain.maxLimits[j + 1];
+            if (chain.jointTypes[j + 1] == MANIPULATOR) gripperJoint = j;
+        }
+    }
+
+    // cancel != generation przerywa planowanie (nowe zlecenie z okna)
+    PlannedSegment Plan(const float* from, const float* to, const std::atomic<int>& cancel, int generation) {
+        auto start = std::chrono::steady_clock::now();
+        auto elapsed = [&]() { return std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - start).count(); };
+        PlannedSegment result;
+        result.found = false;
+        result.status = "brak polaczenia";
+        result.solutionMilliseconds = 0;
+        result.nodes = 0;
+        result.straightLength = JointDistance(from, to);
+        checks = 0;
+
+        float a[MAX_JOINT_COUNT], b[MAX_JOINT_COUNT];
+        ToUnit(from, a);
+        ToUnit(to, b);
+        std::vector<float> path; // znormalizowane
+        if (!EdgeValid(a, a, true)) result.status = "punkt poczatkowy w kolizji";
+        else if (!EdgeValid(b, b, true)) result.status = "punkt koncowy w kolizji";
+        else if (EdgeValid(a, b)) {
+            // najczęstszy przypadek - odcinek prosty jest wolny
+            path.insert(path.end(), a, a + jointCount);
+            path.insert(path.end(), b, b + jointCount);
+            result.found = true;
+            result.status = "prosto";
+        }
+        else {
+            for (int t = 0; t < 2; t++) {
+                trees[t].Reset(jointCount);
+                parents[t].clear();
+            }
+            trees[0].Add(a);
+            parents[0].push_back(-1);
+            trees[1].Add(b);
+            parents[1].push_back(-1);
+            std::uniform_real_distribution<float> uniform(0.0f, 1.0f);
+            int active = 0; // drzewo rozrastane w tej iteracji (0 - od początku odcinka)
+            while (!result.found) {
+                if (cancel.load(std::memory_order_relaxed) != generation) {
+                    result.status = "przerwane";
+                    break;
+                }
+                if (trees[0].GetCount() + trees[1].GetCount() >= PLANNER_MAX_NODES || elapsed() > PLANNER_TIMEOUT * 1000.0f) {
+                    result.status = "limit czasu lub wezlow";
+                    break;
+                }
+                float sample[MAX_JOINT_COUNT];
+                for (int j = 0; j < jointCount; j++) sample[j] = uniform(random);
+                if (gripperJoint >= 0) sample[gripperJoint] = a[gripperJoint] + (b[gripperJoint] - a[gripperJoint]) * uniform(random);
+                if (Extend(active, sample) == 0) {
+                    active = 1 - active;
+                    continue;
+                }
+                // drugie drzewo łączy się z nowym węzłem zachłannie
+                int other = 1 - active;
+                int added = trees[active].GetCount() - 1;
+                float target[MAX_JOINT_COUNT];
+                memcpy(target, trees[active].Get(added), sizeof(float) * jointCount);
+                int state;
+                do state = Extend(other, target); while (state == 1);
+                if (state == 2) {
+                    int startNode = (active == 0) ? added : trees[0].GetCount() - 1;
+                    int goalNode = (active == 0) ? trees[1].GetCount() - 1 : added;
+                    AppendBranch(0, startNode, path, false);
+                    // węzeł wspólny jest już na końcu gałęzi drzewa początkowego
+                    if (parents[1][goalNode] >= 0) AppendBranch(1, parents[1][goalNode], path, true);
+                    result.found = true;
+                    result.status = "RRT-Connect";
+                }
+                active = 1 - active;
+            }
+            result.nodes = trees[0].GetCount() + trees[1].GetCount();
+        }
+        result.solutionMilliseconds = elapsed();
+
+        if (result.found) {
+            // skracanie: losowe pary punktów połączone wprost, gdy krawędź jest wolna
+            std::uniform_int_distribution<int> pick(0, 1 << 30);
+            for (int s = 0; s < PLANNER_SHORTCUTS; s++) {
+                int count = (int)path.size() / jointCount;
+                if (count < 3) break;
+                int i = pick(random) % count, k = pick(random) % count;
+                if (i > k) std::swap(i, k);
+                if (k - i < 2) continue;
+                if (!EdgeValid(&path[(size_t)i * jointCount], &path[(size_t)k * jointCount])) continue;
+                path.erase(path.begin() + (size_t)(i + 1) * jointCount, path.begin() + (size_t)k * jointCount);
+            }
+            int count = (int)path.size() / jointCount;
+            result.path.resize(path.size());
+            for (int i = 0; i < count; i++) ToJoints(&path[(size_t)i * jointCount], &result.path[(size_t)i * jointCount]);
+            // ścieżka zaczyna się i kończy dokładnie w punktach programu (bez błędu normalizacji)
+            memcpy(result.path.data(), from, sizeof(float) * jointCount);
+            memcpy(&result.path[(size_t)(count - 1) * jointCount], to, sizeof(float) * jointCount);
+            result.length = 0;
+            for (int i = 1; i < count; i++) result.length += JointDistance(&result.path[(size_t)(i - 1) * jointCount], &result.path[(size_t)i * jointCount]);
+
+            // tor końcówki do podglądu - kilka próbek na krawędź
+            const int samples = 8;
+            JointBatch joints(jointCount, (count - 1) * samples + 1);
+            float q[MAX_JOINT_COUNT];
+            for (int i = 0; i < joints.GetCount(); i++) {
+                int edge = std::min(i / samples, count - 2);
+                float t = (float)(i - edge * samples) / samples;
+                const float* p0 = &result.path[(size_t)edge * jointCount];
+                const float* p1 = &result.path[(size_t)(edge + 1) * jointCount];
+                for (int j = 0; j < jointCount; j++) q[j] = p0[j] + (p1[j] - p0[j]) * t;
+                joints.SetConfiguration(i, q);
+            }
+            PoseBatch tcpPoses;
+            BatchKinematics(chain).Compute(joints, tcpPoses);
+            for (int i = 0; i < joints.GetCount(); i++) result.tcp.push_back(tcpPoses.GetFlangePosition(i));
+        }
+        else {
+            result.length = 0;
+        }
+        result.checks = checks;
+        result.milliseconds = elapsed();
+        return result;
+    }
+};
+
+// pula wątków planowania: odcinki programu (także powrót z ostatniego punktu do pierwszego) planowane niezależnie,
+// okno tylko zleca i odczytuje wyniki
+class MotionPlannerPool {
+    std::vector<std::thread> threads;
+    std::vector<std::unique_ptr<SegmentPlanner>> planners;
+    std::mutex mutex;
+    std::condition_variable wake;
+    std::deque<int> queue;
+    bool stopping;
+    std::atomic<int> generation;
+    int jointCount;
+    int stateCount;
+    int revision;                    // rewizja programu, dla której zlecono planowanie
+    std::vector<float> states;
+    std::vector<PlannedSegment> results;
+    std::vector<char> finishedSegments;
+    int finished;
+    std::chrono::steady_clock::time_point requested;
+    float totalMilliseconds;
+
+    void Worker(int index) {
+        for (;;) {
+            int segment, job;
+            float from[MAX_JOINT_COUNT], to[MAX_JOINT_COUNT];
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                wake.wait(lock, [&]() { return stopping || !queue.empty(); });
+                if (stopping) return;
+                segment = queue.front();
+                queue.pop_front();
+                job = generation.load();
+                memcpy(from, &states[(size_t)segment * jointCount], sizeof(float) * jointCount);
+                memcpy(to, &states[(size_t)((segment + 1) % stateCount) * jointCount], sizeof(float) * jointCount);
+            }
+            PlannedSegment result = planners[index]->Plan(from, to, generation, job);
+            std::lock_guard<std::mutex> lock(mutex);
+            if (job != generation.load()) continue; // wynik nieaktualnego zlecenia
+            results[segment] = std::move(result);
+            finishedSegments[segment] = 1;
+            finished++;
+            if (finished == (int)results.size()) {
+                totalMilliseconds = std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - requested).count();
+                LogResults();
+            }
+        }
+    }
+
+    // wywoływane pod blokadą przez wątek, który skończył ostatni odcinek
+    void LogResults() {
+        for (size_t s = 0; s < results.size(); s++) {
+            const PlannedSegment& r = results[s];
+            TraceLog(r.found ? LOG_INFO : LOG_WARNING, "PLANER: odcinek %d-%d: %s, rozwiazanie %.1f ms, razem %.1f ms, %d wezlow, %lld konfiguracji, dlugosc %.1f (prosto %.1f), %d pkt",
+                (int)s + 1, (int)(s + 1) % stateCount + 1, r.status, r.solutionMilliseconds, r.milliseconds, r.nodes, r.checks, r.length, r.straightLength,
+                (int)r.path.size() / std::max(1, jointCount));
+        }
+        TraceLog(LOG_INFO, "PLANER: %d odcinkow w %.1f ms", (int)results.size(), totalMilliseconds);
+    }
+
+public:
+    MotionPlannerPool() : stopping(false), generation(0), jointCount(0), stateCount(0), revision(-1), finished(0), totalMilliseconds(0) {}
+
+    ~MotionPlannerPool() {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stopping = true;
+            generation++;
+        }
+        wake.notify_all();
+        for (std::thread& thread : threads) thread.join();
+    }
+
+    // łańcuchy z pozycji spoczynkowej modeli, kolizje jako kopia (każdy wątek ma własne drzewa BVH)
+    void Start(const KinematicChain& arm, const GripperChain& device, const CollisionChecker& collision, int count) {
+        if (!threads.empty()) return;
+        if (count <= 0) count = std::max(1, (int)std::thread::hardware_concurrency() - 1); // jeden rdzeń dla okna
+        jointCount = arm.linkCount - 1;
+        for (int t = 0; t < count; t++) planners.emplace_back(new SegmentPlanner(arm, device, collision, 1234u + t));
+        for (int t = 0; t < count; t++) threads.emplace_back(&MotionPlannerPool::Worker, this, t);
+    }
+
+    bool IsStarted() {
+        return !threads.empty();
+    }
+
+    // nowe zlecenie przerywa poprzednie; values - punkty programu po jointCount nastaw
+    void Plan(const float* values, int count, int programRevision) {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            generation++;
+            queue.clear();
+            states.assign(values, values + (size_t)count * jointCount);
+            stateCount = count;
+            revision = programRevision;
+            int segments = (count > 1) ? count : 0;
+            results.assign(segments, PlannedSegment());
+            finishedSegments.assign(segments, 0);
+            finished = 0;
+            totalMilliseconds = 0;
+            requested = std::chrono::steady_clock::now();
+            for (int s = 0; s < segments; s++) queue.push_back(s);
+        }
+        wake.notify_all();
+    }
+
+    // tory końcówki gotowych odcinków: zielone - znaleziona ścieżka, czerwone - odcinek bez rozwiązania
+    void Draw() {
+        std::lock_guard<std::mutex> lock(mutex);
+        for (size_t s = 0; s < results.size(); s++) {
+            if (!finishedSegments[s]) continue;
+            const PlannedSegment& r = results[s];
+            for (size_t i = 1; i < r.tcp.size(); i++) DrawLine3D(r.tcp[i - 1], r.tcp[i], r.found ? GREEN : RED);
+        }
+    }
+
+    // podsumowanie do panelu: gotowe odcinki, znalezione, suma długości i czas do ostatniego wyniku
+    void GetSummary(int& segments, int& done, int& found, float& length, float& straight, float& milliseconds, float& slowest) {
+        std::lock_guard<std::mutex> lock(mutex);
+        segments = (int)results.size();
+        done = finished;
+        found = 0;
+        length = straight = slowest = 0;
+        for (size_t s = 0; s < results.size(); s++) {
+            if (!finishedSegments[s]) continue;
+            if (results[s].found) found++;
+            length += results[s].length;
+            straight += results[s].straightLength;
+            slowest = fmaxf(slowest, results[s].solutionMilliseconds);
+        }
+        milliseconds = (finished == segments) ? totalMilliseconds
+            : std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - requested).count();
+    }
+
+    // program z punktami pośrednimi ścieżek; false gdy planowanie trwa, program się zmienił albo odcinek nie ma rozwiązania
+    bool BuildProgram(int programRevision, std::vector<float>& out) {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (revision != programRevision || results.empty() || finished != (int)results.size()) return false;
+        out.clear();
+        for (size_t s = 0; s < results.size(); s++) {
+            if (!results[s].found) return false;
+            // ostatni punkt ścieżki to początek kolejnego odcinka
+            const std::vector<float>& path = results[s].path;
+            out.insert(out.end(), path.begin(), path.end() - jointCount);
+        }
+        return true;
+    }
+};
+
+// Optymalizacja czasu cyklu programu: ten sam czas odcinków co w trybie pracy (TrajectoryExecutor dla ruchu punkt-punkt,
+// SplineTrajectory dla torów sklejanych, ograniczenia prędkości, przyspieszenia i zrywu złączy), sprawdzone wszystkie
+// rodzaje toru i profile, a dla programów typu "pobierz-odłóż" opcjonalnie także kolejność punktów (pierwszy zostaje
+// na miejscu). Kolejność szukana 2-opt z wielu punktów startowych na macierzy czasów ruchu punkt-punkt.
+// Czasy odcinków nie są zapisywane: tryb pracy sam planuje każdy odcinek najszybciej w granicach złączy, więc wynikiem
+// jest wybór rodzaju toru i profilu (oraz kolejność), a nie program z własnymi czasami.
+#define OPTIMIZER_MAX_ORDER_POINTS 512 // powyżej kolejność punktów nie jest zmieniana (macierz czasów N^2)
+#define OPTIMIZER_ORDER_STARTS 64      // punkty startowe przeszukiwania kolejności
+#define LEGACY_FRAMES_PER_POINT 60     // dawny tryb pracy: kolejny punkt co 60 klatek
+#define LEGACY_FPS 60.0f
+
+struct CycleCandidate {
+    PathMode path;
+    ProfileType profile;   // tylko dla ruchu punkt-punkt
+    bool reordered;
+    float cycleTime;       // [s]
+    bool inRange;          // tor w zakresach złączy (sklejane mogą przestrzelić punkty)
+};
+
+struct CycleReport {
+    int points;
+    float legacyTime;           // 60 klatek na punkt przy 60 FPS
+    float currentTime;          // bieżący rodzaj toru i profil
+    float bestInOrder;          // najlepszy czas w zapisanej kolejności (tylko tory w zakresach złączy)
+    CycleCandidate best;
+    std::vector<CycleCandidate> candidates;
+    std::vector<int> order;     // kolejność punktów najlepszego kandydata (numery od 0)
+    int orderStarts;
+    float milliseconds;
+    int threads;
+    int steals;
+};
+
+class CycleTimeOptimizer {
+    int jointCount;
+    JointMotionLimits limits[MAX_JOINT_COUNT];
+    float minLimits[MAX_JOINT_COUNT];
+    float maxLimits[MAX_JOINT_COUNT];
+    int stepJoint; // chwytak - zatrzymanie w każdym punkcie toru sklejanego
+
+    // czas pełnego cyklu po punktach w kolejności order
+    float CycleTime(const std::vector<float>& points, const std::vector<int>& order, PathMode path, ProfileType profile, bool& inRange) {
+        inRange = true;
+        int n = (int)order.size();
+        if (path == PATH_POINT_TO_POINT) {
+            TrajectoryExecutor executor;
+            executor.SetLimits(jointCount, limits);
+            executor.SetProfile(profile);
+            float total = 0;
+            for (int i = 0; i < n; i++) {
+                total += executor.Plan(&points[(size_t)order[i] * jointCount], &points[(size_t)order[(i + 1) % n] * jointCount]);
+            }
+            return total;
+        }
+        std::vector<float> ordered((size_t)n * jointCount);
+        for (int i = 0; i < n; i++) memcpy(&ordered[(size_t)i * jointCount], &points[(size_t)order[i] * jointCount], sizeof(float) * jointCount);
+        SplineTrajectory spline;
+        spline.SetLimits(jointCount, limits);
+        spline.SetRange(minLimits, maxLimits, stepJoint);
+        spline.SetMode(path);
+        spline.Build(ordered.data(), n, false);
+        float low[MAX_JOINT_COUNT], high[MAX_JOINT_COUNT];
+        spline.GetRange(low, high);
+        for (int j = 0; j < jointCount; j++) {
+            if (low[j] < minLimits[j] - 1e-3f || high[j] > maxLimits[j] + 1e-3f) inRange = false;
+        }
+        return spline.GetDuration();
+    }
+
+    // długość cyklu dla macierzy czasów odcinków
+    static float TourCost(const std::vector<float>& cost, int n, const std::vector<int>& order) {
+        float total = 0;
+        for (int i = 0; i < n; i++) total += cost[(size_t)order[i] * n + order[(i + 1) % n]];
+        return total;
+    }
+
+    // 2-opt: odwrócenie fragmentu order[i..k] gdy skraca cykl; punkt 0 nie jest ruszany
+    static void TwoOpt(const std::vector<float>& cost, int n, std::vector<int>& order) {
+        bool improved = true;
+        while (improved) {
+            improved = false;
+            for (int i = 1; i < n - 1; i++) {
+                for (int k = i + 1; k < n; k++) {
+                    int a = order[i - 1], b = order[i], c = order[k], d = order[(k + 1) % n];
+                    float delta = cost[(size_t)a * n + c] + cost[(size_t)b * n + d] - cost[(size_t)a * n + b] - cost[(size_t)c * n + d];
+                    if (delta < -1e-5f) {
+                        std::reverse(order.begin() + i, order.begin() + k + 1);
+                        improved = true;
+                    }
+                }
+            }
+        }
+    }
+
+public:
+    CycleTimeOptimizer() : jointCount(0), stepJoint(-1) {}
+
+    void SetLimits(int joints, const JointMotionLimits* jointLimits, const float* minValues, const float* maxValues, int stopJoint) {
+        jointCount = joints;
+        stepJoint = stopJoint;
+        for (int j = 0; j < jointCount; j++) {
+            limits[j] = jointLimits[j];
+            minLimits[j] = minValues[j];
+            maxLimits[j] = maxValues[j];
+        }
+    }
+
+    // points - count punktów programu; current* - ustawienia trybu pracy do porównania
+    CycleReport Optimize(const std::vector<float>& points, int count, PathMode currentPath, ProfileType currentProfile, bool reorder, int threads) {
+        auto start = std::chrono::steady_clock::now();
+        if (threads <= 0) threads = std::max(1, (int)std::thread::hardware_concurrency());
+        CycleReport report;
+        report.points = count;
+        report.legacyTime = count * LEGACY_FRAMES_PER_POINT / LEGACY_FPS;
+        report.orderStarts = 0;
+        report.steals = 0;
+        report.threads = threads;
+        std::vector<int> identity(count);
+        for (int i = 0; i < count; i++) identity[i] = i;
+        report.order = identity;
+
+        // kolejność: macierz czasów ruchu punkt-punkt (wiersze równolegle), potem 2-opt z wielu startów równolegle
+        std::vector<int> bestOrder;
+        if (reorder && count >= 3 && count <= OPTIMIZER_MAX_ORDER_POINTS) {
+            std::vector<float> cost((size_t)count * count);
+            std::vector<TrajectoryExecutor> executors(threads);
+            for (TrajectoryExecutor& executor : executors) {
+                executor.SetLimits(jointCount, limits);
+                executor.SetProfile(currentProfile);
+            }
+            report.steals += RunWorkStealing(count, threads, [&](int worker, int row) {
+                for (int k = 0; k < count; k++) {
+                    cost[(size_t)row * count + k] = (k == row) ? 0 : executors[worker].Plan(&points[(size_t)row * jointCount], &points[(size_t)k * jointCount]);
+                }
+            });
+            report.orderStarts = OPTIMIZER_ORDER_STARTS;
+            std::vector<std::vector<int>> tours(report.orderStarts);
+            std::vector<float> tourCost(report.orderStarts);
+            report.steals += RunWorkStealing(report.orderStarts, threads, [&](int, int s) {
+                std::vector<int>& order = tours[s];
+                if (s == 0) order = identity; // zapisana kolejność
+                else if (s == 1) {
+                    // najbliższy (najszybciej osiągalny) sąsiad
+                    std::vector<char> used(count, 0);
+                    order.push_back(0);
+                    used[0] = 1;
+                    for (int i = 1; i < count; i++) {
+                        int last = order.back(), next = -1;
+                        for (int k = 0; k < count; k++) {
+                            if (!used[k] && (next < 0 || cost[(size_t)last * count + k] < cost[(size_t)last * count + next])) next = k;
+                        }
+                        order.push_back(next);
+                        used[next] = 1;
+                    }
+                }
+                else {
+                    order = identity;
+                    std::mt19937 random(s);
+                    std::shuffle(order.begin() + 1, order.end(), random);
+                }
+                TwoOpt(cost, count, order);
+                tourCost[s] = TourCost(cost, count, order);
+            });
+            int best = (int)(std::min_element(tourCost.begin(), tourCost.end()) - tourCost.begin());
+            if (tours[best] != identity) bestOrder = tours[best];
+        }
+
+        // kandydaci: każdy rodzaj toru (punkt-punkt z oboma profilami) w zapisanej i w znalezionej kolejności
+        for (int order = 0; order < (bestOrder.empty() ? 1 : 2); order++) {
+            report.candidates.push_back({ PATH_POINT_TO_POINT, PROFILE_TRAPEZOIDAL, order == 1, 0, true });
+            report.candidates.push_back({ PATH_POINT_TO_POINT, PROFILE_SCURVE, order == 1, 0, true });
+            for (int path = PATH_CUBIC_C1; path < PATH_MODE_COUNT; path++) report.candidates.push_back({ (PathMode)path, PROFILE_TRAPEZOIDAL, order == 1, 0, true });
+        }
+        if (count >= 2) {
+            report.steals += RunWorkStealing((int)report.candidates.size(), threads, [&](int, int c) {
+                CycleCandidate& candidate = report.candidates[c];
+                candidate.cycleTime = CycleTime(points, candidate.reordered ? bestOrder : identity, candidate.path, candidate.profile, candidate.inRange);
+            });
+        }
+
+        report.best = report.candidates[0];
+        report.bestInOrder = FLT_MAX;
+        report.currentTime = 0;
+        for (const CycleCandidate& candidate : report.candidates) {
+            if (candidate.reordered) continue;
+            if (candidate.path == currentPath && (candidate.path != PATH_POINT_TO_POINT || candidate.profile == currentProfile)) report.currentTime = candidate.cycleTime;
+        }
+        // punkt-punkt zawsze w zakresach (postój w punktach programu), więc najlepszy zawsze istnieje
+        for (const CycleCandidate& candidate : report.candidates) {
+            if (!candidate.inRange) continue;
+            if (candidate.cycleTime < report.best.cycleTime) report.best = candidate;
+            if (!candidate.reordered) report.bestInOrder = fminf(report.bestInOrder, candidate.cycleTime);
+        }
+        if (report.best.reordered) report.order = bestOrder;
+        report.milliseconds = std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - start).count();
+        return report;
+    }
+};
+
+// raport optymalizacji do logu albo na stdout
+void PrintCycleReport(const CycleReport& r, FILE* out) {
+    fprintf(out, "Punkty: %d, dawny tryb pracy (%d klatek na punkt przy %.0f FPS): %.3f s, biezace ustawienia: %.3f s\n",
+        r.points, LEGACY_FRAMES_PER_POINT, LEGACY_FPS, r.legacyTime, r.currentTime);
+    for (const CycleCandidate& c : r.candidates) {
+        fprintf(out, "  %-12s %-9s %-19s %9.3f s%s\n", pathModeNames[c.path], c.path == PATH_POINT_TO_POINT ? (c.profile == PROFILE_SCURVE ? "S" : "trapezowy") : "-",
+            c.reordered ? "zmieniona kolejnosc" : "zapisana kolejnosc", c.cycleTime, c.inRange ? "" : "  poza zakresem zlaczy");
+    }
+    fprintf(out, "Najlepszy: %s%s%s, %.3f s (%+.1f%% wzgledem dawnego trybu, %+.1f%% wzgledem biezacych ustawien)\n",
+        pathModeNames[r.best.path], r.best.path == PATH_POINT_TO_POINT ? (r.best.profile == PROFILE_SCURVE ? ", profil S" : ", profil trapezowy") : "",
+        r.best.reordered ? ", zmieniona kolejnosc" : "", r.best.cycleTime, (r.best.cycleTime / r.legacyTime - 1) * 100,
+        r.currentTime > 0 ? (r.best.cycleTime / r.currentTime - 1) * 100 : 0.0f);
+    if (r.best.reordered) fprintf(out, "Najlepszy w zapisanej kolejnosci: %.3f s\n", r.bestInOrder);
+    fprintf(out, "Obliczenia: %.1f ms, %d watki, %d startow kolejnosci, %d kradziezy\n", r.milliseconds, r.threads, r.orderStarts, r.steals);
+}
+
+// optymalizacja w tle dla okna; wynik stosowany dopiero na żądanie (Ctrl+O)
+class CycleOptimizerTask {
+    CycleTimeOptimizer optimizer;
+    CycleReport report;
+    std::vector<float> points;
+    int revision;       // rewizja programu, dla której liczono
+    std::thread worker;
+    std::atomic<bool> done;
+    bool started;
+
+public:
+    CycleOptimizerTask() : revision(-1), done(false), started(false) {}
+
+    ~CycleOptimizerTask() {
+        if (worker.joinable()) worker.join();
+    }
+
+    // values - count punktów programu; reorder (--reorder) tylko dla krótkich programów (OPTIMIZER_MAX_ORDER_POINTS)
+    void Start(const float* values, int count, int jointCount, const JointMotionLimits* limits, const float* minValues, const float* maxValues,
+        int stepJoint, PathMode path, ProfileType profile, bool reorder, int programRevision) {
+        if (started && !done.load()) return;
+        if (worker.joinable()) worker.join();
+        points.assign(values, values + (size_t)count * jointCount);
+        optimizer.SetLimits(jointCount, limits, minValues, maxValues, stepJoint);
+        revision = programRevision;
+        started = true;
+        done = false;
+        worker = std::thread([this, count, path, profile, reorder]() {
+            report = optimizer.Optimize(points, count, path, profile, reorder, 0);
+            PrintCycleReport(report, stdout);
+            done = true;
+        });
+    }
+
+    bool IsStarted() { return started; }
+    bool IsReady() { return started && done.load(); }
+    bool IsCurrent(int programRevision) { return revision == programRevision; }
+    const CycleReport& GetReport() { return report; }
+    const std::vector<float>& GetPoints() { return points; }
+};
+
+// plik wynikowy obok programu: program.rpg -> program<extension>
+inline void GetProgramOutputPath(const char* programFile, const char* extension, char* path, int size) {
+    int length = (int)strlen(programFile) - (IsFileExtension(programFile, ".rpg") ? 4 : 0);
+    snprintf(path, size, "%.*s%s", length, programFile, extension);
+}
+
+// --optimize: raport dla programu z dysku i program w znalezionej kolejności obok (plik.opt.rpg)
+int RunCycleOptimizer(const char* robotFile, const char* programFile, bool reorder, int threads) {
+    Model skeleton = LoadSkeleton(robotFile);
+    if (skeleton.boneCount < 2) return 1;
+    KinematicChain chain = LoadArmChain(skeleton, robotFile);
+    UnloadModel(skeleton);
+    int jointCount = chain.linkCount - 1;
+    ProgramStore store;
+    if (!store.Open(programFile, jointCount, false)) {
+        printf("%s: brak programu\n", programFile);
+        return 1;
+    }
+    int count = (int)store.GetCount();
+    if (count < 2) {
+        printf("%s: za malo punktow (%d)\n", programFile, count);
+        return 1;
+    }
+    std::vector<float> points((size_t)count * jointCount);
+    for (int i = 0; i < count; i++) {
+        for (int j = 0; j < jointCount; j++) points[(size_t)i * jointCount + j] = store.GetValue(i, j);
+    }
+    CycleTimeOptimizer optimizer;
+    optimizer.SetLimits(jointCount, chain.motionLimits + 1, chain.minLimits + 1, chain.maxLimits + 1, ManipulatorJoint(chain));
+    CycleReport report = optimizer.Optimize(points, count, PATH_POINT_TO_POINT, PROFILE_TRAPEZOIDAL, reorder, threads);
+    printf("%s:\n", programFile);
+    PrintCycleReport(report, stdout);
+
+    // plik programu nie przechowuje czasów - zapisywana jest kolejność, tor i profil podawane przy odtwarzaniu
+    char outFile[300];
+    GetProgramOutputPath(programFile, ".opt.rpg", outFile, sizeof(outFile));
+    ProgramStore out;
+    if (!out.Open(outFile, jointCount)) return 1;
+    out.Clear();
+    for (int i = 0; i < count; i++) out.Add(&points[(size_t)report.order[i] * jointCount]);
+    const char* pathOptions[PATH_MODE_COUNT] = { "p2p", "c1", "c2", "quintic" };
+    printf("%s: zapisany, odtwarzanie: --path %s --profile %s\n", outFile, pathOptions[report.best.path], report.best.profile == PROFILE_SCURVE ? "s" : "trapez");
+    return 0;
+}
+
+// Objętość zajmowana przez robota w czasie programu (ogrodzenie, rozstawienie sąsiednich maszyn): tor między wszystkimi
+// punktami próbkowany jak w trybie pracy, kinematyka prosta próbek paczką (macierze ogniw jak absoluteTransforms ramienia,
+// palce jak Device::ComputeTransforms), trójkąty siatek rasteryzowane równolegle do wspólnej siatki bitów (atomowe OR).
+// Siatka, której ruch od ostatniej rasteryzacji w tym fragmencie jest mniejszy od ułamka woksela, jest pomijana;
+// pominięcia i odstępy między próbkami pokrywa poszerzenie zajętych wokseli o ceil(ułamek + największy ruch) wokseli.
+// Na koniec wypełnienie z zewnątrz: woksele nieosiągalne z brzegu siatki należą do bryły, ściany bryły od strony
+// zewnętrznej tworzą siatkę eksportowaną do OBJ i rysowaną w widoku.
+#define SWEPT_SAMPLES 10000
+#define SWEPT_VOXEL_SIZE 0.25f
+#define SWEPT_CHUNK 64          // próbki w jednym fragmencie pracy
+#define SWEPT_SKIP_FRACTION 0.5f // ruch siatki (ułamek woksela), poniżej którego próbka nie jest rasteryzowana
+#define SWEPT_MAX_CELLS (1LL << 26) // większa siatka - woksel powiększany (bity i znaczniki wypełnienia w pamięci)
+
+struct SweptFace {
+    int x, y, z;   // woksel bryły
+    int direction; // 0..5: +x, -x, +y, -y, +z, -z (sąsiad po tej stronie leży na zewnątrz)
+};
+
+class SweptVolume {
+    struct Body {
+        int link;      // ogniwo ramienia albo palec chwytaka
+        bool device;
+        std::vector<Vector3> triangles; // w układzie modelu
+        Vector3 corners[8];             // prostopadłościan modelu (największe przesunięcie wierzchołka to przesunięcie narożnika)
+    };
+    KinematicChain chain;
+    GripperChain gripper;
+    int jointCount;
+    int gripperJoint;
+    std::vector<Body> bodies;
+
+    float voxelSize;
+    Vector3 origin; // narożnik siatki
+    int size[3];
+    std::unique_ptr<std::atomic<unsigned long long>[]> bits;
+    std::vector<unsigned char> outside;
+    std::vector<SweptFace> faces;
+
+    int samples;
+    long long rasterized; // siatki rasteryzowane w próbkach
+    long long skipped;    // pominięte - za mały ruch
+    long long surfaceVoxels;
+    long long solidVoxels;
+    float maxGap;         // największy ruch wierzchołka między kolejnymi próbkami
+    int dilation;         // poszerzenie bryły [woksele]
+    float milliseconds;
+    int threads;
+    int steals;
+
+    long long CellIndex(int x, int y, int z) const {
+        return ((long long)z * size[1] + y) * size[0] + x;
+    }
+
+    void SetCell(int x, int y, int z) {
+        long long index = CellIndex(x, y, z);
+        std::atomic<unsigned long long>& word = bits[index >> 6];
+        unsigned long long bit = 1ULL << (index & 63);
+        if (!(word.load(std::memory_order_relaxed) & bit)) word.fetch_or(bit, std::memory_order_relaxed);
+    }
+
+    bool GetCell(long long index) const {
+        return (bits[index >> 6].load(std::memory_order_relaxed) >> (index & 63)) & 1;
+    }
+
+    // tor programu jak w trybie pracy: punkt-punkt po prostych w przestrzeni złączy (próbki według najdłuższego
+    // względnego ruchu złącza), sklejane - równo w czasie cyklu
+    void SampleProgram(const std::vector<float>& points, int count, const JointMotionLimits* limits, PathMode path, std::vector<float>& out) {
+        out.assign((size_t)samples * jointCount, 0.0f);
+        if (path != PATH_POINT_TO_POINT && count >= 2) {
+            SplineTrajectory spline;
+            spline.SetLimits(jointCount, limits);
+            spline.SetRange(chain.minLimits + 1, chain.maxLimits + 1, ManipulatorJoint(chain));
+            spline.SetMode(path);
+            spline.Build(points.data(), count, false);
+            for (int k = 0; k < samples; k++) spline.Sample((int)((long long)k * spline.GetStepCount() / samples), &out[(size_t)k * jointCount]);
+            return;
+        }
+        std::vector<float> weights(count);
+        float total = 0;
+        for (int i = 0; i < count; i++) {
+            const float* a = &points[(size_t)i * jointCount];
+            const float* b = &points[(size_t)((i + 1) % count) * jointCount];
+            float longest = 0;
+            for (int j = 0; j < jointCount; j++) {
+                float range = fmaxf(chain.maxLimits[j + 1] - chain.minLimits[j + 1], 1e-6f);
+                longest = fmaxf(longest, fabsf(b[j] - a[j]) / range);
+            }
+            weights[i] = longest;
+            total += longest;
+        }
+        int k = 0;
+        double covered = 0;
+        for (int i = 0; i < count && k < samples; i++) {
+            // zaokrąglanie narastająco - suma próbek odcinków równa samples
+            covered += (total > 0) ? weights[i] / total : 1.0 / count;
+            int end = (i == count - 1) ? samples : std::min(samples, (int)llround(covered * samples));
+            const float* a = &points[(size_t)i * jointCount];
+            const float* b = &points[(size_t)((i + 1) % count) * jointCount];
+            int n = std::max(1, end - k);
+            for (int s = 0; k < end; s++, k++) {
+                for (int j = 0; j < jointCount; j++) out[(size_t)k * jointCount + j] = a[j] + (b[j] - a[j]) * s / n;
+            }
+        }
+    }
+
+    // macierze siatek próbki: ogniwa z paczki, palce od kołnierza z rozstawem z nastawy chwytaka
+    void BodyTransforms(PoseBatch& poses, const std::vector<float>& configurations, int sample, Matrix* out) {
+        Matrix device[MAX_JOINT_COUNT];
+        Matrix flange = poses.GetFlange(sample);
+        float opening = (gripperJoint >= 0) ? configurations[(size_t)sample * jointCount + gripperJoint] : 0;
+        GripperTransforms(gripper, opening, flange, device);
+        for (size_t b = 0; b < bodies.size(); b++) out[b] = bodies[b].device ? device[bodies[b].link] : poses.GetPose(sample, bodies[b].link);
+    }
+
+    // największe przesunięcie punktu siatki między dwoma położeniami (funkcja wypukła - maksimum w narożniku)
+    float Displacement(const Body& body, const Matrix& a, const Matrix& b) const {
+        float largest = 0;
+        for (int c = 0; c < 8; c++) largest = fmaxf(largest, Vector3Distance(Vector3Transform(body.corners[c], a), Vector3Transform(body.corners[c], b)));
+        return largest;
+    }
+
+    // trójkąt w układzie siatki wokseli (jednostka = woksel): test Schwarza-Seidela (płaszczyzna i rzuty na trzy płaszczyzny osi,
+    // odpowiednik osi rozdzielających TriangleBoxIntersect) z funkcjami krawędzi liczonymi raz na trójkąt; wzdłuż osi
+    // dominującej normalnej sprawdzane są tylko woksele kolumny, które przecina płaszczyzna trójkąta
+    void RasterizeTriangle(const Vector3* t) {
+        float v[3][3] = { { t[0].x, t[0].y, t[0].z }, { t[1].x, t[1].y, t[1].z }, { t[2].x, t[2].y, t[2].z } };
+        int from[3], to[3];
+        for (int a = 0; a < 3; a++) {
+            from[a] = std::max(0, std::min(size[a] - 1, (int)floorf(fminf(v[0][a], fminf(v[1][a], v[2][a])))));
+            to[a] = std::max(0, std::min(size[a] - 1, (int)floorf(fmaxf(v[0][a], fmaxf(v[1][a], v[2][a])))));
+        }
+        // mały trójkąt w jednym wokselu
+        if (from[0] == to[0] && from[1] == to[1] && from[2] == to[2]) {
+            SetCell(from[0], from[1], from[2]);
+            return;
+        }
+        float e[3][3];
+        for (int i = 0; i < 3; i++) {
+            for (int a = 0; a < 3; a++) e[i][a] = v[(i + 1) % 3][a] - v[i][a];
+        }
+        float n[3] = { e[0][1] * e[1][2] - e[0][2] * e[1][1], e[0][2] * e[1][0] - e[0][0] * e[1][2], e[0][0] * e[1][1] - e[0][1] * e[1][0] };
+        if (n[0] == 0 && n[1] == 0 && n[2] == 0) return;
+        // rzut k na osie (a, b) wzdłuż c; krawędź i: ne . (p_a, p_b) + de >= 0 dla narożnika p woksela
+        static const int axes[3][3] = { { 0, 1, 2 }, { 1, 2, 0 }, { 2, 0, 1 } };
+        float ne[3][3][2], de[3][3];
+        for (int k = 0; k < 3; k++) {
+            int a = axes[k][0], b = axes[k][1], c = axes[k][2];
+            float sign = (n[c] >= 0) ? 1.0f : -1.0f;
+            for (int i = 0; i < 3; i++) {
+                ne[k][i][0] = -e[i][b] * sign;
+                ne[k][i][1] = e[i][a] * sign;
+                de[k][i] = -(ne[k][i][0] * v[i][a] + ne[k][i][1] * v[i][b]) + fmaxf(0, ne[k][i][0]) + fmaxf(0, ne[k][i][1]);
+            }
+        }
+        auto inside = [&](int k, int pa, int pb) {
+            for (int i = 0; i < 3; i++) {
+                if (ne[k][i][0] * pa + ne[k][i][1] * pb + de[k][i] < 0) return false;
+            }
+            return true;
+        };
+        int w = (fabsf(n[0]) > fabsf(n[1])) ? (fabsf(n[0]) > fabsf(n[2]) ? 0 : 2) : (fabsf(n[1]) > fabsf(n[2]) ? 1 : 2);
+        int k = (w + 1) % 3; // rzut, którego oś c == w
+        int u = axes[k][0], uv = axes[k][1];
+        int other1 = (k + 1) % 3, other2 = (k + 2) % 3;
+        float plane = n[0] * v[0][0] + n[1] * v[0][1] + n[2] * v[0][2];
+        int p[3];
+        for (p[u] = from[u]; p[u] <= to[u]; p[u]++) {
+            for (p[uv] = from[uv]; p[uv] <= to[uv]; p[uv]++) {
+                if (!inside(k, p[u], p[uv])) continue;
+                // zakres płaszczyzny nad kwadratem kolumny
+                float base = (plane - n[u] * p[u] - n[uv] * p[uv]) / n[w];
+                float du = -n[u] / n[w], dv = -n[uv] / n[w];
+                float low = base + fminf(0, du) + fminf(0, dv);
+                float high = base + fmaxf(0, du) + fmaxf(0, dv);
+                int first = std::max(from[w], (int)floorf(low));
+                int last = std::min(to[w], (int)floorf(high));
+                for (p[w] = first; p[w] <= last; p[w]++) {
+                    if (inside(other1, p[axes[other1][0]], p[axes[other1][1]]) && inside(other2, p[axes[other2][0]], p[axes[other2][1]])) SetCell(p[0], p[1], p[2]);
+                }
+            }
+        }
+    }
+
+    // m - położenie siatki w układzie siatki wokseli
+    void RasterizeBody(const Body& body, const Matrix& m) {
+        for (size_t i = 0; i < body.triangles.size(); i += 3) {
+            Vector3 t[3];
+            for (int k = 0; k < 3; k++) t[k] = Vector3Transform(body.triangles[i + k], m);
+            RasterizeTriangle(t);
+        }
+    }
+
+    // poszerzenie zajętych wokseli o radius w każdej osi (prostopadłościan, osie po kolei); linie wzdłuż osi równolegle
+    void Dilate(int radius) {
+        if (radius <= 0) return;
+        long long cellCount = (long long)size[0] * size[1] * size[2];
+        std::vector<unsigned char> solid((size_t)cellCount);
+        for (long long i = 0; i < cellCount; i++) solid[i] = GetCell(i);
+        const long long steps[3] = { 1, size[0], (long long)size[0] * size[1] };
+        for (int a = 0; a < 3; a++) {
+            int u = (a + 1) % 3, v = (a + 2) % 3;
+            steals += RunWorkStealing(size[u], threads, [&](int, int row) {
+                std::vector<unsigned char> line(size[a]);
+                for (int column = 0; column < size[v]; column++) {
+                    int cell[3];
+                    cell[a] = 0;
+                    cell[u] = row;
+                    cell[v] = column;
+                    long long first = CellIndex(cell[0], cell[1], cell[2]);
+                    for (int c = 0; c < size[a]; c++) line[c] = solid[first + c * steps[a]];
+                    // odległość do najbliższego zajętego woksela przed i za
+                    int last = -radius - 1;
+                    for (int c = 0; c < size[a]; c++) {
+                        if (line[c]) last = c;
+                        solid[first + c * steps[a]] = (c - last <= radius);
+                    }
+                    last = size[a] + radius;
+                    for (int c = size[a] - 1; c >= 0; c--) {
+                        if (line[c]) last = c;
+                        if (last - c <= radius) solid[first + c * steps[a]] = 1;
+                    }
+                }
+            });
+        }
+        size_t wordCount = (size_t)((cellCount + 63) / 64);
+        for (size_t w = 0; w < wordCount; w++) {
+            unsigned long long word = 0;
+            for (int b = 0; b < 64 && (long long)(w * 64 + b) < cellCount; b++) {
+                if (solid[w * 64 + b]) word |= 1ULL << b;
+            }
+            bits[w].store(word, std::memory_order_relaxed);
+        }
+    }
+
+    // woksele osiągalne z narożnika siatki (pusta warstwa na brzegu) przez puste sąsiednie woksele
+    void FillOutside() {
+        long long cellCount = (long long)size[0] * size[1] * size[2];
+        outside.assign((size_t)cellCount, 0);
+        std::vector<long long> stack;
+        stack.push_back(0);
+        outside[0] = 1;
+        const long long steps[3] = { 1, size[0], (long long)size[0] * size[1] };
+        while (!stack.empty()) {
+            long long index = stack.back();
+            stack.pop_back();
+            int cell[3] = { (int)(index % size[0]), (int)(index / size[0] % size[1]), (int)(index / steps[2]) };
+            for (int a = 0; a < 3; a++) {
+                for (int sign = -1; sign <= 1; sign += 2) {
+                    int c = cell[a] + sign;
+                    if (c < 0 || c >= size[a]) continue;
+                    long long next = index + sign * steps[a];
+                    if (outside[next] || GetCell(next)) continue;
+                    outside[next] = 1;
+                    stack.push_back(next);
+                }
+            }
+        }
+    }
+
+public:
+    SweptVolume() : jointCount(0), gripperJoint(-1), voxelSize(SWEPT_VOXEL_SIZE), origin({ 0, 0, 0 }), samples(0), rasterized(0), skipped(0),
+        surfaceVoxels(0), solidVoxels(0), maxGap(0), dilation(0), milliseconds(0), threads(0), steals(0) {
+        size[0] = size[1] = size[2] = 0;
+    }
+
+    // łańcuch ramienia z pozycji spoczynkowej (GetRestChain), siatki w pamięci (trójkąty kopiowane)
+    void SetRobot(const KinematicChain& arm, const GripperChain& device, const Model& armModel, const Model& deviceModel) {
+        chain = arm;
+        gripper = device;
+        jointCount = chain.linkCount - 1;
+        gripperJoint = -1;
+        for (int j = 0; j < jointCount; j++) {
+            if (chain.jointTypes[j + 1] == MANIPULATOR) gripperJoint = j;
+        }
+        bodies.clear();
+        for (int i = 0; i < armModel.meshCount + deviceModel.meshCount; i++) {
+            bool isDevice = i >= armModel.meshCount;
+            const Mesh& mesh = isDevice ? deviceModel.meshes[i - armModel.meshCount] : armModel.meshes[i];
+            if (mesh.vertices == NULL || mesh.triangleCount == 0) continue;
+            Body body;
+            body.device = isDevice;
+            body.link = isDevice ? i - armModel.meshCount : chain.meshLinks[i];
+            body.triangles.resize((size_t)mesh.triangleCount * 3);
+            for (int v = 0; v < mesh.triangleCount * 3; v++) {
+                int index = (mesh.indices != NULL) ? mesh.indices[v] : v;
+                body.triangles[v] = { mesh.vertices[index * 3], mesh.vertices[index * 3 + 1], mesh.vertices[index * 3 + 2] };
+            }
+            BoundingBox box = GetMeshBoundingBox(mesh);
+            for (int c = 0; c < 8; c++) body.corners[c] = { (c & 1) ? box.max.x : box.min.x, (c & 2) ? box.max.y : box.min.y, (c & 4) ? box.max.z : box.min.z };
+            bodies.push_back(body);
+        }
+    }
+
+    // points - count punktów programu; false dla pustego programu
+    bool Compute(const std::vector<float>& points, int count, const JointMotionLimits* limits, PathMode path, int sampleCount, float voxel, int threadCount) {
+        auto start = std::chrono::steady_clock::now();
+        if (count < 1 || bodies.empty()) return false;
+        samples = std::max(1, sampleCount);
+        voxelSize = (voxel > 0) ? voxel : SWEPT_VOXEL_SIZE;
+        threads = (threadCount > 0) ? threadCount : std::max(1, (int)std::thread::hardware_concurrency());
+        std::vector<float> configurations;
+        SampleProgram(points, count, limits, path, configurations);
+        JointBatch joints(jointCount, samples);
+        for (int k = 0; k < samples; k++) joints.SetConfiguration(k, &configurations[(size_t)k * jointCount]);
+        PoseBatch poses;
+        BatchKinematics(chain).Compute(joints, poses, true);
+
+        // granice siatki z prostopadłościanów siatek we wszystkich próbkach, z pustą warstwą na brzegu
+        Vector3 low = { FLT_MAX, FLT_MAX, FLT_MAX }, high = { -FLT_MAX, -FLT_MAX, -FLT_MAX };
+        std::vector<Matrix> previous(bodies.size()), current(bodies.size());
+        maxGap = 0;
+        for (int k = 0; k < samples; k++) {
+            BodyTransforms(poses, configurations, k, current.data());
+            for (size_t b = 0; b < bodies.size(); b++) {
+                for (int c = 0; c < 8; c++) {
+                    Vector3 p = Vector3Transform(bodies[b].corners[c], current[b]);
+                    low = Vector3Min(low, p);
+                    high = Vector3Max(high, p);
+                }
+                if (k > 0) maxGap = fmaxf(maxGap, Displacement(bodies[b], previous[b], current[b]));
+            }
+            previous.swap(current);
+        }
+        // miejsce na poszerzenie i pusta warstwa na brzegu
+        Vector3 extent = Vector3Subtract(high, low);
+        long long cellCount;
+        int margin;
+        for (;;) {
+            dilation = (int)ceilf(SWEPT_SKIP_FRACTION + maxGap / voxelSize);
+            margin = dilation + 1;
+            size[0] = (int)ceilf(extent.x / voxelSize) + 2 * margin;
+            size[1] = (int)ceilf(extent.y / voxelSize) + 2 * margin;
+            size[2] = (int)ceilf(extent.z / voxelSize) + 2 * margin;
+            cellCount = (long long)size[0] * size[1] * size[2];
+            if (cellCount <= SWEPT_MAX_CELLS) break;
+            voxelSize *= 1.26f; // ~ dwa razy mniej wokseli
+        }
+        origin = Vector3Subtract(low, { margin * voxelSize, margin * voxelSize, margin * voxelSize });
+        size_t wordCount = (size_t)((cellCount + 63) / 64);
+        bits.reset(new std::atomic<unsigned long long>[wordCount]);
+        for (size_t w = 0; w < wordCount; w++) bits[w].store(0, std::memory_order_relaxed);
+
+        Matrix toGrid = MatrixMultiply(MatrixTranslate(Vector3Negate(origin)), MatrixScale(1 / voxelSize, 1 / voxelSize, 1 / voxelSize));
+        // fragmenty kolejnych próbek; pierwsza próbka fragmentu rasteryzuje wszystkie siatki
+        std::atomic<long long> rasterizedCount(0), skippedCount(0);
+        int chunks = (samples + SWEPT_CHUNK - 1) / SWEPT_CHUNK;
+        steals = RunWorkStealing(chunks, threads, [&](int, int chunk) {
+            std::vector<Matrix> last(bodies.size()), transforms(bodies.size());
+            long long done = 0, skip = 0;
+            for (int k = chunk * SWEPT_CHUNK; k < std::min(samples, (chunk + 1) * SWEPT_CHUNK); k++) {
+                BodyTransforms(poses, configurations, k, transforms.data());
+                for (size_t b = 0; b < bodies.size(); b++) {
+                    if (k > chunk * SWEPT_CHUNK && Displacement(bodies[b], last[b], transforms[b]) < voxelSize * SWEPT_SKIP_FRACTION) {
+                        skip++;
+                        continue;
+                    }
+                    RasterizeBody(bodies[b], MatrixMultiply(transforms[b], toGrid));
+                    last[b] = transforms[b];
+                    done++;
+                }
+            }
+            rasterizedCount += done;
+            skippedCount += skip;
+        });
+        rasterized = rasterizedCount;
+        skipped = skippedCount;
+
+        surfaceVoxels = 0;
+        for (long long i = 0; i < cellCount; i++) surfaceVoxels += GetCell(i);
+        Dilate(dilation);
+        FillOutside();
+        const int offsets[6][3] = { { 1, 0, 0 }, { -1, 0, 0 }, { 0, 1, 0 }, { 0, -1, 0 }, { 0, 0, 1 }, { 0, 0, -1 } };
+        faces.clear();
+        solidVoxels = 0;
+        for (int z = 0; z < size[2]; z++) {
+            for (int y = 0; y < size[1]; y++) {
+                for (int x = 0; x < size[0]; x++) {
+                    long long index = CellIndex(x, y, z);
+                    if (outside[index]) continue;
+                    solidVoxels++;
+                    // pusta warstwa brzegowa - sąsiad woksela bryły zawsze mieści się w siatce
+                    for (int d = 0; d < 6; d++) {
+                        if (outside[CellIndex(x + offsets[d][0], y + offsets[d][1], z + offsets[d][2])]) faces.push_back({ x, y, z, d });
+                    }
+                }
+            }
+        }
+        milliseconds = std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - start).count();
+        return true;
+    }
+
+    // narożniki ściany przeciwnie do ruchu wskazówek zegara patrząc z zewnątrz (w jednostkach woksela)
+    void GetFaceCorners(const SweptFace& face, int corners[4][3]) const {
+        // normalna n i styczne u, v (u x v = n) jak w ReachOverlay
+        static const int axes[6][3][3] = {
+            { { 1, 0, 0 }, { 0, 1, 0 }, { 0, 0, 1 } }, { { -1, 0, 0 }, { 0, 0, 1 }, { 0, 1, 0 } },
+            { { 0, 1, 0 }, { 0, 0, 1 }, { 1, 0, 0 } }, { { 0, -1, 0 }, { 1, 0, 0 }, { 0, 0, 1 } },
+            { { 0, 0, 1 }, { 1, 0, 0 }, { 0, 1, 0 } }, { { 0, 0, -1 }, { 0, 1, 0 }, { 1, 0, 0 } } };
+        static const int signs[4][2] = { { -1, -1 }, { 1, -1 }, { 1, 1 }, { -1, 1 } };
+        const int cell[3] = { face.x, face.y, face.z };
+        const int (*f)[3] = axes[face.direction];
+        for (int c = 0; c < 4; c++) {
+            for (int a = 0; a < 3; a++) corners[c][a] = cell[a] + (1 + f[0][a] + signs[c][0] * f[1][a] + signs[c][1] * f[2][a]) / 2;
+        }
+    }
+
+    Vector3 GridToWorld(const int* corner) const {
+        return { origin.x + corner[0] * voxelSize, origin.y + corner[1] * voxelSize, origin.z + corner[2] * voxelSize };
+    }
+
+    // ściany bryły jako czworokąty ze wspólnymi wierzchołkami
+    bool ExportObj(const char* fileName) const {
+        FILE* file = NULL;
+        if (fopen_s(&file, fileName, "w") != 0 || file == NULL) return false;
+        fprintf(file, "# objetosc robocza programu: %lld wokseli %.3f, %zu scian\n", solidVoxels, voxelSize, faces.size());
+        std::unordered_map<long long, int> vertices;
+        std::vector<int> indices(faces.size() * 4);
+        for (size_t f = 0; f < faces.size(); f++) {
+            int corners[4][3];
+            GetFaceCorners(faces[f], corners);
+            for (int c = 0; c < 4; c++) {
+                long long key = ((long long)corners[c][2] * (size[1] + 1) + corners[c][1]) * (size[0] + 1) + corners[c][0];
+                auto found = vertices.find(key);
+                if (found == vertices.end()) {
+                    found = vertices.emplace(key, (int)vertices.size() + 1).first;
+                    Vector3 p = GridToWorld(corners[c]);
+                    fprintf(file, "v %.4f %.4f %.4f\n", p.x, p.y, p.z);
+                }
+                indices[f * 4 + c] = found->second;
+            }
+        }
+        for (size_t f = 0; f < faces.size(); f++) fprintf(file, "f %d %d %d %d\n", indices[f * 4], indices[f * 4 + 1], indices[f * 4 + 2], indices[f * 4 + 3]);
+        fclose(file);
+        return true;
+    }
+
+    const std::vector<SweptFace>& GetFaces() const { return faces; }
+    int GetSamples() const { return samples; }
+    long long GetRasterized() const { return rasterized; }
+    long long GetSkipped() const { return skipped; }
+    long long GetSurfaceVoxels() const { return surfaceVoxels; }
+    long long GetSolidVoxels() const { return solidVoxels; }
+    float GetVolume() const { return solidVoxels * voxelSize * voxelSize * voxelSize; }
+    float GetVoxelSize() const { return voxelSize; }
+    float GetMaxGap() const { return maxGap; }
+    int GetDilation() const { return dilation; }
+    float GetMilliseconds() const { return milliseconds; }
+    int GetThreads() const { return threads; }
+    int GetSteals() const { return steals; }
+    BoundingBox GetBounds() const {
+        return { Vector3Add(origin, { voxelSize, voxelSize, voxelSize }),
+            Vector3Add(origin, { (size[0] - 1) * voxelSize, (size[1] - 1) * voxelSize, (size[2] - 1) * voxelSize }) };
+    }
+};
+
+void PrintSweptVolume(const SweptVolume& volume, FILE* out) {
+    BoundingBox bounds = volume.GetBounds();
+    fprintf(out, "Objetosc robocza: %.1f j^3 (%lld wokseli %.3f, powierzchnia %lld), %zu scian\n", volume.GetVolume(), volume.GetSolidVoxels(),
+        volume.GetVoxelSize(), volume.GetSurfaceVoxels(), volume.GetFaces().size());
+    fprintf(out, "Granice: (%.2f, %.2f, %.2f) - (%.2f, %.2f, %.2f)\n", bounds.min.x, bounds.min.y, bounds.min.z, bounds.max.x, bounds.max.y, bounds.max.z);
+    fprintf(out, "Probki: %d, najwiekszy ruch miedzy probkami %.3f (%.1f woksela), rasteryzacje siatek %lld, pominiete %lld, poszerzenie %d wokseli\n",
+        volume.GetSamples(), volume.GetMaxGap(), volume.GetMaxGap() / volume.GetVoxelSize(), volume.GetRasterized(), volume.GetSkipped(), volume.GetDilation());
+    fprintf(out, "Obliczenia: %.1f ms, %d watki, %d kradziezy\n", volume.GetMilliseconds(), volume.GetThreads(), volume.GetSteals());
+}
+
+// objętość robocza w widoku 3D: półprzezroczyste ściany bryły, liczona w tle po włączeniu i po zmianie programu
+class SweptOverlay {
+    SweptVolume volume;
+    std::vector<float> points;
+    JointMotionLimits limits[MAX_JOINT_COUNT];
+    char exportPath[300];
+    int revision;
+    bool exported;
+    std::thread worker;
+    std::atomic<bool> done;
+    bool started;
+    Mesh mesh;
+    Material material;
+    bool uploaded;
 
-    int GetBoneCount() {
-        return model.boneCount;
+    void Build() {
+        const std::vector<SweptFace>& faces = volume.GetFaces();
+        memset(&mesh, 0, sizeof(mesh));
+        mesh.vertexCount = (int)faces.size() * 6;
+        mesh.triangleCount = (int)faces.size() * 2;
+        mesh.vertices = (float*)MemAlloc(mesh.vertexCount * 3 * sizeof(float));
+        mesh.colors = (unsigned char*)MemAlloc(mesh.vertexCount * 4);
+        // jaśniejsze ściany górne - kształt bryły czytelny bez oświetlenia
+        const unsigned char shades[6] = { 170, 150, 230, 110, 190, 130 };
+        const int order[6] = { 0, 1, 2, 0, 2, 3 };
+        int v = 0;
+        for (const SweptFace& face : faces) {
+            int corners[4][3];
+            volume.GetFaceCorners(face, corners);
+            Color color = { shades[face.direction], (unsigned char)(shades[face.direction] * 0.6f), 40, 40 };
+            for (int k = 0; k < 6; k++, v++) {
+                Vector3 p = volume.GridToWorld(corners[order[k]]);
+                mesh.vertices[v * 3] = p.x;
+                mesh.vertices[v * 3 + 1] = p.y;
+                mesh.vertices[v * 3 + 2] = p.z;
+                memcpy(&mesh.colors[v * 4], &color, 4);
+            }
+        }
+        UploadMesh(&mesh, false);
+        if (material.shader.id == 0) material = LoadMaterialDefault();
+        uploaded = true;
     }
-};
 
-class RobotArm {
-    Device* device;
-    Model model;
-    Matrix absoluteTransforms[MAX_JOINT_COUNT];
-    Vector4 DHparameters[MAX_JOINT_COUNT];
-    JointType jointTypes[MAX_JOINT_COUNT];
-    float targetPositions[MAX_JOINT_COUNT];
-    Shader& shader;
 public:
-    RobotArm(const char* fileName, Device& d, Shader& shaderRef) : shader(shaderRef) {
-        LoadRobotModel(fileName);
-
-        device = &d;
-        device->UpdateTransforms(absoluteTransforms[model.boneCount - 1]);
-        targetPositions[model.boneCount - 1] = GetJointPosition(model.boneCount - 1);
+    SweptOverlay() : revision(-1), exported(false), done(false), started(false), uploaded(false) {
+        exportPath[0] = '\0';
+        memset(&mesh, 0, sizeof(mesh));
+        memset(&material, 0, sizeof(material));
     }
 
-    ~RobotArm() {
-        UnloadModel(model);
+    ~SweptOverlay() {
+        if (worker.joinable()) worker.join();
+        if (uploaded) UnloadMesh(mesh);
+        if (material.shader.id != 0) UnloadMaterial(material);
     }
 
-    void LoadRobotModel(const char* fileName) {
-        model = LoadModel(fileName);  // wczytywanie modelu 
-        
-        for (int i = 1; i < model.boneCount; i++) {
-            absoluteTransforms[i] = MatrixTranslate(model.bindPose[i].translation);
-            jointTypes[i] = REVOLUTE;
+    // values - count punktów programu; wynik zapisywany także do pliku OBJ obok programu
+    void Start(const KinematicChain& chain, const GripperChain& gripper, const Model& arm, const Model& device, const float* values, int count,
+        const JointMotionLimits* jointLimits, PathMode path, const char* programFile, int programRevision) {
+        if (started && !done.load(std::memory_order_acquire)) return;
+        if (worker.joinable()) worker.join();
+        if (uploaded) {
+            UnloadMesh(mesh);
+            uploaded = false;
         }
-        jointTypes[model.boneCount - 1] = MANIPULATOR;
-        // nadanie parametrów DH
-        DHparameters[0] = { 0, 0, 0, 0 };
-        DHparameters[1] = { 0,model.bindPose[1].translation.y - model.bindPose[0].translation.y,0,0 };
-        DHparameters[2] = { 0, 0,0 , 90 * DEG2RAD };
-        DHparameters[3] = { 0, 0, model.bindPose[3].translation.y - model.bindPose[2].translation.y, 0 };
-        DHparameters[4] = { 0, model.bindPose[4].translation.x - model.bindPose[3].translation.x, model.bindPose[4].translation.y - model.bindPose[3].translation.y, 0 };
+        int jointCount = chain.linkCount - 1;
+        points.assign(values, values + (size_t)count * jointCount);
+        for (int j = 0; j < jointCount; j++) limits[j] = jointLimits[j];
+        volume.SetRobot(chain, gripper, arm, device);
+        GetProgramOutputPath(programFile, ".swept.obj", exportPath, sizeof(exportPath));
+        revision = programRevision;
+        started = true;
+        done.store(false, std::memory_order_release);
+        worker = std::thread([this, count, path]() {
+            if (volume.Compute(points, count, limits, path, SWEPT_SAMPLES, SWEPT_VOXEL_SIZE, 0)) {
+                exported = volume.ExportObj(exportPath);
+                PrintSweptVolume(volume, stdout);
+            }
+            done.store(true, std::memory_order_release);
+        });
+    }
 
-        absoluteTransforms[0] = MatrixTranslate(model.bindPose[0].translation);
-        for (int i = 1; i < model.boneCount; i++) {
-            absoluteTransforms[i] = MatrixMultiply(DHtoMatrix(DHparameters[i]), absoluteTransforms[i - 1]);
-        }
+    bool IsStarted() { return started; }
+    bool IsReady() { return started && done.load(std::memory_order_acquire); }
+    bool IsCurrent(int programRevision) { return revision == programRevision; }
+    bool IsExported() { return exported; }
+    const char* GetExportPath() { return exportPath; }
+    const SweptVolume& GetVolume() { return volume; }
 
-        for (int i = 0; i < model.materialCount; i++) {
-            model.materials[i].shader = shader;
-        }
+    void Draw() {
+        if (!IsReady() || volume.GetFaces().empty()) return;
+        if (!uploaded) Build();
+        // bez zapisu głębokości - bryła nie zasłania robota
+        rlDrawRenderBatchActive();
+        rlDisableDepthMask();
+        DrawMesh(mesh, material, MatrixIdentity());
+        rlEnableDepthMask();
+        DrawBoundingBox(volume.GetBounds(), Fade(ORANGE, 0.6f));
+    }
+};
 
-        for (int i = 0; i < model.boneCount - 1; i++) {
-            targetPositions[i] = GetJointPosition(i);
+// --swept: objętość robocza programu z dysku, raport i plik.swept.obj
+int RunSweptVolume(const char* robotFile, const char* deviceFile, const char* programFile, PathMode path, int samples, float voxel, int threads) {
+    // trójkąty siatek wczytywane bez kontekstu GL - bez okna
+    int result = 1;
+    Model arm = LoadGeometry(robotFile);
+    Model device = LoadGeometry(deviceFile);
+    {
+        KinematicChain chain = LoadArmChain(arm, robotFile);
+        int jointCount = chain.linkCount - 1;
+        ProgramStore store;
+        if (arm.boneCount < 2 || device.boneCount < 3) printf("%s, %s: niepelne szkielety\n", robotFile, deviceFile);
+        else if (!store.Open(programFile, jointCount, false) || store.GetCount() < 1) printf("%s: brak programu\n", programFile);
+        else {
+            int count = (int)store.GetCount();
+            std::vector<float> points((size_t)count * jointCount);
+            for (int i = 0; i < count; i++) {
+                for (int j = 0; j < jointCount; j++) points[(size_t)i * jointCount + j] = store.GetValue(i, j);
+            }
+            SweptVolume volume;
+            volume.SetRobot(chain, GripperChainFromModel(device), arm, device);
+            char outFile[300];
+            GetProgramOutputPath(programFile, ".swept.obj", outFile, sizeof(outFile));
+            if (volume.Compute(points, count, chain.motionLimits + 1, path, samples, voxel, threads)) {
+                printf("%s:\n", programFile);
+                PrintSweptVolume(volume, stdout);
+                if (volume.ExportObj(outFile)) {
+                    printf("%s: zapisany\n", outFile);
+                    result = 0;
+                }
+            }
         }
     }
+    UnloadModel(arm);
+    UnloadModel(device);
+    return result;
+}
 
-    void Draw(int selection, const Camera3D& cam, Shader& shader) {
-        // rysowanie robota wraz z shaderami
-        Matrix view = MatrixLookAt(cam.position, cam.target, cam.up);
-        Matrix projection = MatrixPerspective(cam.fovy * DEG2RAD, (float)GetScreenWidth() / GetScreenHeight(), 0.01f, 1000.0f);
+// scenariusz wejścia do powtarzalnych pomiarów: zmiany stanu klawiszy, przycisków, pozycji myszy i rozmiaru okna
+// oraz czas każdej klatki. Przy odtwarzaniu zdarzenia trafiają do raylib (PlayAutomationEvent) na początku klatki,
+// a symulacja dostaje nagrane czasy klatek - ten sam przebieg niezależnie od szybkości komputera.
+// Wbudowane nagrywanie raylib zapisuje każdy wciśnięty klawisz w każdej klatce i loguje każde zdarzenie, stąd własny zapis.
+// Znaki wpisywane w pola (GetCharPressed) nie są nagrywane - raylib nie pozwala ich wstrzyknąć.
+#define INPUT_FILE_VERSION 1
+#define INPUT_MOUSE_BUTTONS 7
 
-        for (int i = 0; i < model.meshCount; i++) {
-            Matrix mModel = absoluteTransforms[i];
-            Matrix mvp = MatrixMultiply(MatrixMultiply(mModel, view), projection);
-              // shadery
-            SetShaderValue(shader, GetShaderLocation(shader, "mvp"), &mvp, 4);
-            SetShaderValue(shader, GetShaderLocation(shader, "matModel"), &mModel, 4);
+struct InputFileHeader {
+    char magic[4]; // "RIN1"
+    int version;
+    int frameCount;
+    int eventCount;
+};
 
-            Vector3 lightDir = Vector3Normalize({-0.5f, -1.0f, -0.3f});
-            SetShaderValue(shader, GetShaderLocation(shader, "lightDir"), &lightDir, SHADER_UNIFORM_VEC3);
+// numery typów zdarzeń jak w AutomationEventType (rcore.c - typ nie jest publiczny w raylib.h)
+enum InputEventType {
+    INPUT_KEY_UP = 1,
+    INPUT_KEY_DOWN = 2,
+    INPUT_MOUSE_BUTTON_UP = 5,
+    INPUT_MOUSE_BUTTON_DOWN = 6,
+    INPUT_MOUSE_POSITION = 7,
+    INPUT_MOUSE_WHEEL_MOTION = 8,
+    WINDOW_RESIZE = 21
+};
 
-            Color clr = (i == selection) ? YELLOW : WHITE; //zaznaczenie kolorem wybranego przegubu
-            Vector4 baseColor = { clr.r / 255.0f, clr.g / 255.0f, clr.b / 255.0f, clr.a / 255.0f };
-            SetShaderValue(shader, GetShaderLocation(shader, "baseColor"), &baseColor, SHADER_UNIFORM_VEC4);
+struct InputEvent {
+    int frame;
+    int type;      // InputEventType
+    int params[2];
+};
 
-            DrawMesh(model.meshes[i], model.materials[model.meshMaterial[i]], mModel);
-        }
-        
-        Color clr = (model.meshCount == selection) ? YELLOW : WHITE;
-        device->Draw(clr, cam, shader);
+struct FrameTimeStats {
+    int frames;
+    float avg, p50, p95, p99, max; // [ms]
+};
+
+class InputScenario {
+    enum Mode { IDLE, RECORDING, REPLAYING };
+    Mode mode;
+    char fileName[256];
+    std::vector<float> frameTimes;  // czasy klatek podawane symulacji
+    std::vector<InputEvent> events;
+    std::vector<float> measured;    // rzeczywiste czasy klatek odtwarzania [ms]
+    size_t nextEvent;
+    int frame;
+    float frameTime;
+    std::chrono::steady_clock::time_point lastFrame;
+
+    // stan z poprzedniej klatki nagrywania
+    bool keys[512];
+    bool buttons[INPUT_MOUSE_BUTTONS];
+    int mouseX, mouseY;
+    int screenWidth, screenHeight;
+
+    void Add(int type, int p0, int p1) {
+        events.push_back({ frame, type, { p0, p1 } });
     }
 
-    void MoveJoint(int selection, float newValue) {
-        // aktualizacja pozycji przegubów
-        switch (jointTypes[selection]) {
-        case REVOLUTE:
-            DHparameters[selection].x = newValue * DEG2RAD;
-            break;
-        case PRISMATIC:
-            DHparameters[selection].y = newValue;
-            break;
-        case MANIPULATOR:
-            if (device) device->MoveJoint(newValue);
-            break;
+    void Capture() {
+        if (GetScreenWidth() != screenWidth || GetScreenHeight() != screenHeight) {
+            screenWidth = GetScreenWidth();
+            screenHeight = GetScreenHeight();
+            Add(WINDOW_RESIZE, screenWidth, screenHeight);
         }
-
-        for (int i = 1; i < model.boneCount; i++) {
-            absoluteTransforms[i] = MatrixMultiply(DHtoMatrix(DHparameters[i]), absoluteTransforms[i - 1]);
+        for (int key = 1; key < 512; key++) {
+            bool down = IsKeyDown(key);
+            if (down != keys[key]) Add(down ? INPUT_KEY_DOWN : INPUT_KEY_UP, key, 0);
+            keys[key] = down;
         }
-        device->UpdateTransforms(absoluteTransforms[model.boneCount - 1]);
+        for (int button = 0; button < INPUT_MOUSE_BUTTONS; button++) {
+            bool down = IsMouseButtonDown(button);
+            if (down != buttons[button]) Add(down ? INPUT_MOUSE_BUTTON_DOWN : INPUT_MOUSE_BUTTON_UP, button, 0);
+            buttons[button] = down;
+        }
+        Vector2 mouse = GetMousePosition();
+        int x = (int)roundf(mouse.x), y = (int)roundf(mouse.y);
+        if (x != mouseX || y != mouseY) {
+            // pozycja zaokrąglana do piksela jak w zdarzeniach raylib - przy odtwarzaniu kamera dostaje te same przyrosty
+            Add(INPUT_MOUSE_POSITION, x, y);
+            mouseX = x;
+            mouseY = y;
+        }
+        float wheel = GetMouseWheelMove();
+        if (wheel != 0) Add(INPUT_MOUSE_WHEEL_MOTION, (int)roundf(wheel), 0); // raylib odtwarza tylko param[0]
     }
 
-    void MoveJointDiscrete(int selection, int direction) {
-        // przesuwanie przegubu
-        float delta = 0;
-        switch (jointTypes[selection]) {
-        case REVOLUTE:
-            delta = 5;
-            break;
-        case PRISMATIC:
-            delta = 0.1;
-            break;
-        case MANIPULATOR:
-            delta = 0.05;
-            break;
+public:
+    InputScenario() : mode(IDLE), nextEvent(0), frame(0), frameTime(0), mouseX(INT_MIN), mouseY(INT_MIN), screenWidth(0), screenHeight(0) {
+        fileName[0] = '\0';
+        memset(keys, 0, sizeof(keys));
+        memset(buttons, 0, sizeof(buttons));
+    }
+
+    void StartRecording(const char* path) {
+        strncpy_s(fileName, sizeof(fileName), path, sizeof(fileName) - 1);
+        mode = RECORDING;
+    }
+
+    bool LoadReplay(const char* path) {
+        strncpy_s(fileName, sizeof(fileName), path, sizeof(fileName) - 1);
+        FILE* file = NULL;
+        if (fopen_s(&file, fileName, "rb") != 0 || file == NULL) return false;
+        InputFileHeader header;
+        bool ok = fread(&header, sizeof(header), 1, file) == 1 && memcmp(header.magic, "RIN1", 4) == 0 && header.version == INPUT_FILE_VERSION
+            && header.frameCount >= 0 && header.eventCount >= 0;
+        if (ok) {
+            frameTimes.resize(header.frameCount);
+            events.resize(header.eventCount);
+            ok = fread(frameTimes.data(), sizeof(float), frameTimes.size(), file) == frameTimes.size()
+                && fread(events.data(), sizeof(InputEvent), events.size(), file) == events.size();
+        }
+        fclose(file);
+        if (!ok) {
+            TraceLog(LOG_ERROR, "INPUT: %s nie jest nagraniem wejscia", fileName);
+            return false;
         }
-        UpdateTargetPosition(selection, GetJointPosition(selection) + direction * delta);
+        measured.reserve(frameTimes.size());
+        mode = REPLAYING;
+        return true;
     }
 
-    bool UpdateJointsSmooth(float lerpFactor = 0.1f) {
-        // animacja przejścia złącza do nadanej pozycji
-        bool jointMoves = false;
-        for (int i = 0; i < model.boneCount; i++) {
-            float currentPos = GetJointPosition(i);
-            float diff = targetPositions[i] - currentPos;
-            if (fabs(diff) > 0.001f) {
-                float newPos = currentPos + diff * lerpFactor;
-                MoveJoint(i, newPos);
-                jointMoves = true;
+    bool IsReplaying() { return mode == REPLAYING; }
+    bool IsRecording() { return mode == RECORDING; }
+
+    // początek klatki: zapis albo wstrzyknięcie wejścia; false gdy nagranie się skończyło
+    bool BeginFrame() {
+        if (mode == RECORDING) {
+            Capture();
+            frameTime = GetFrameTime();
+            frameTimes.push_back(frameTime);
+        }
+        else if (mode == REPLAYING) {
+            auto now = std::chrono::steady_clock::now();
+            if (frame > 0) measured.push_back(std::chrono::duration<float, std::milli>(now - lastFrame).count());
+            lastFrame = now;
+            if (frame >= (int)frameTimes.size()) return false;
+            for (; nextEvent < events.size() && events[nextEvent].frame == frame; nextEvent++) {
+                const InputEvent& e = events[nextEvent];
+                AutomationEvent event = { (unsigned int)frame, (unsigned int)e.type, { e.params[0], e.params[1], 0, 0 } };
+                PlayAutomationEvent(event);
             }
+            frameTime = frameTimes[frame];
         }
-        return jointMoves;
+        else {
+            frameTime = GetFrameTime();
+        }
+        frame++;
+        return true;
     }
 
-    void UpdateTargetPosition(int selection, float newValue) {
-        targetPositions[selection] = newValue;
+    // czas klatki dla symulacji (przy odtwarzaniu - nagrany)
+    float GetFrameDelta() {
+        return frameTime;
     }
 
-    float GetJointPosition(int selection) {
-        switch (jointTypes[selection]) {
-        case REVOLUTE:
-            return DHparameters[selection].x * RAD2DEG;
-        case PRISMATIC:
-            return DHparameters[selection].y;
-        case MANIPULATOR:
-            return device->GetPosition();
-        }
-        return 0;
+    // zapis nagrania po zamknięciu okna
+    bool Finish() {
+        if (mode != RECORDING) return true;
+        mode = IDLE;
+        FILE* file = NULL;
+        if (fopen_s(&file, fileName, "wb") != 0 || file == NULL) return false;
+        InputFileHeader header;
+        memcpy(header.magic, "RIN1", 4);
+        header.version = INPUT_FILE_VERSION;
+        header.frameCount = (int)frameTimes.size();
+        header.eventCount = (int)events.size();
+        fwrite(&header, sizeof(header), 1, file);
+        fwrite(frameTimes.data(), sizeof(float), frameTimes.size(), file);
+        fwrite(events.data(), sizeof(InputEvent), events.size(), file);
+        fclose(file);
+        TraceLog(LOG_INFO, "INPUT: %s - %d klatek, %d zdarzen", fileName, header.frameCount, header.eventCount);
+        return true;
     }
 
-    int GetBoneCount() {
-        return model.boneCount;
+    // statystyki rzeczywistych czasów klatek odtwarzania
+    FrameTimeStats GetStats() {
+        FrameTimeStats stats = { (int)measured.size(), 0, 0, 0, 0, 0 };
+        if (measured.empty()) return stats;
+        std::vector<float> values = measured;
+        double sum = 0;
+        for (float v : values) sum += v;
+        stats.avg = (float)(sum / values.size());
+        stats.max = *std::max_element(values.begin(), values.end());
+        stats.p50 = Percentile(values, 50);
+        stats.p95 = Percentile(values, 95);
+        stats.p99 = Percentile(values, 99);
+        return stats;
     }
+};
 
-    JointType GetJointType(int selection) {
-        return jointTypes[selection];
+// kopia dziennika programu (brak źródła - usunięcie celu, czyli start z pustym programem)
+void CopyProgramFile(const char* from, const char* to) {
+    int size = 0;
+    unsigned char* data = FileExists(from) ? LoadFileData(from, &size) : NULL;
+    if (data != NULL) {
+        SaveFileData(to, data, size);
+        UnloadFileData(data);
     }
-
-    float GetTargetPosition(int selection) {
-        return targetPositions[selection];
+    else {
+        remove(to);
     }
+}
+
+bool SaveFrameTimeStats(const char* fileName, const FrameTimeStats& s) {
+    FILE* file = NULL;
+    if (fopen_s(&file, fileName, "w") != 0 || file == NULL) return false;
+    fprintf(file, "{ \"frames\": %d, \"avg_ms\": %.4f, \"p50_ms\": %.4f, \"p95_ms\": %.4f, \"p99_ms\": %.4f, \"max_ms\": %.4f }\n",
+        s.frames, s.avg, s.p50, s.p95, s.p99, s.max);
+    fclose(file);
+    return true;
+}
+
+// odczyt pliku zapisanego przez SaveFrameTimeStats (porównanie z poprzednią wersją programu)
+bool LoadFrameTimeStats(const char* fileName, FrameTimeStats& s) {
+    char* text = LoadFileText(fileName);
+    if (text == NULL) return false;
+    int fields = sscanf_s(text, "{ \"frames\": %d, \"avg_ms\": %f, \"p50_ms\": %f, \"p95_ms\": %f, \"p99_ms\": %f, \"max_ms\": %f }",
+        &s.frames, &s.avg, &s.p50, &s.p95, &s.p99, &s.max);
+    UnloadFileText(text);
+    return fields == 6;
+}
+
+// profiler klatki: czasy faz pętli głównej w buforze cyklicznym; FRAME_PROFILER=0 usuwa go z kompilacji całkowicie
+#ifndef FRAME_PROFILER
+#define FRAME_PROFILER 1
+#endif
+#if FRAME_PROFILER
+#define PROFILER_FRAMES 1024 // potęga dwójki
+#define PROFILER_STATS_INTERVAL 30 // statystyki nakładki przeliczane co tyle klatek
+
+enum FramePhase {
+    PHASE_INPUT,   // klawisze, kamera, cela
+    PHASE_WORK,    // tryb pracy i nagrywanie
+    PHASE_JOINTS,  // pola GUI i UpdateJointsSmooth
+    PHASE_DRAW3D,  // scena 3D
+    PHASE_GUI,     // panele raygui
+    PHASE_PRESENT, // EndDrawing: zamiana buforów i czekanie na klatkę
+    PHASE_COUNT
 };
 
-//zapisane pozycje robota w trybie nauki
-class SavedStates {
-    int statesCount;
-    int jointCount;
-    std::vector<float> c;
-    RobotArm* robot;
+const char* phaseNames[PHASE_COUNT] = { "wejscie", "praca", "zlacza", "scena 3D", "GUI", "prezentacja" };
+const char* phaseKeys[PHASE_COUNT] = { "input", "work", "joints", "draw3d", "gui", "present" }; // nazwy kolumn eksportu
+
+struct FrameSample {
+    float phase[PHASE_COUNT]; // [ms]
+    float frame;              // [ms]
+    int drawCalls;
+    int uniformUploads;
+};
+
+struct PhaseStats {
+    float min, avg, p99;
+};
+
+// jeden zapisujący (pętla główna), czytać może dowolny wątek: slot jest publikowany licznikiem z semantyką release,
+// a czytający po skopiowaniu odrzuca klatki, które zapisujący zdążył w tym czasie nadpisać
+class FrameProfiler {
+    FrameSample frames[PROFILER_FRAMES];
+    std::atomic<unsigned> written;
+
+    FrameSample current;
+    int phase;
+    std::chrono::steady_clock::time_point phaseStart, frameStart;
+
+    PhaseStats stats[PHASE_COUNT + 1]; // ostatnia pozycja - cała klatka
+    int statsAge;
+
+    float Elapsed(std::chrono::steady_clock::time_point from, std::chrono::steady_clock::time_point to) {
+        return std::chrono::duration<float, std::milli>(to - from).count();
+    }
 
-    const int delay = 60;
-    int frames;
-    int currentState;
 public:
-    SavedStates(RobotArm& r) {
-        currentState = 0;
-        statesCount = 0;
-        robot = &r;
-        jointCount = robot->GetBoneCount() - 1;
+    FrameProfiler() : written(0), phase(-1), statsAge(PROFILER_STATS_INTERVAL) {
+        memset(&current, 0, sizeof(current));
+        memset(stats, 0, sizeof(stats));
     }
-    //zapisanie pozycji robota
-    void Save() {
-        for (int i = 1;i < jointCount + 1;i++) {
-            c.push_back(robot->GetJointPosition(i));
-        }
-        statesCount++;
+
+    // koniec poprzedniej fazy i początek następnej - jeden odczyt zegara na granicę faz
+    void Phase(FramePhase next) {
+        auto now = std::chrono::steady_clock::now();
+        if (phase >= 0) current.phase[phase] += Elapsed(phaseStart, now);
+        else frameStart = now;
+        phase = next;
+        phaseStart = now;
     }
-    //usunięcie ostatniej pozycji robota
-    void Delete() {
-        if (statesCount == 0) return;
-        for (int i = 0;i < jointCount;i++) {
-            c.pop_back();
-        }
-        statesCount--;
+
+    void AddDrawCalls(int drawCalls, int uniformUploads) {
+        current.drawCalls += drawCalls;
+        current.uniformUploads += uniformUploads;
     }
 
-    void Reset() {
-        c.clear();
-        currentState = 0;
-        statesCount = 0;
-        frames = 0;
+    void EndFrame() {
+        auto now = std::chrono::steady_clock::now();
+        if (phase < 0) return;
+        current.phase[phase] += Elapsed(phaseStart, now);
+        current.frame = Elapsed(frameStart, now);
+        unsigned index = written.load(std::memory_order_relaxed);
+        frames[index & (PROFILER_FRAMES - 1)] = current;
+        written.store(index + 1, std::memory_order_release);
+        memset(&current, 0, sizeof(current));
+        phase = -1;
+        statsAge++;
     }
 
-    void ResetCurrentState() {
-        currentState = 0;
+    // kopia zapisanych klatek, od najstarszej
+    void Snapshot(std::vector<FrameSample>& out) {
+        unsigned end = written.load(std::memory_order_acquire);
+        unsigned count = std::min(end, (unsigned)PROFILER_FRAMES);
+        out.resize(count);
+        for (unsigned i = 0; i < count; i++) out[i] = frames[(end - count + i) & (PROFILER_FRAMES - 1)];
+        // klatki nadpisane w trakcie kopiowania
+        unsigned overwritten = written.load(std::memory_order_acquire) - end;
+        if (overwritten > 0) out.erase(out.begin(), out.begin() + std::min(overwritten, count));
     }
-    //tryb pracy
-    void WorkMode() {
-        frames += 1;
-        frames %= delay;
-        if (frames == 0) {
-            currentState = (currentState == statesCount) ? 1 : currentState + 1;
-            for (int i = 0;i < jointCount;i++) {
-                robot->UpdateTargetPosition(i + 1, GetJointParameter(currentState, i));
+
+    // min/średnia/p99 faz (index PHASE_COUNT - cała klatka), przeliczane co PROFILER_STATS_INTERVAL klatek
+    const PhaseStats* GetStats() {
+        if (statsAge < PROFILER_STATS_INTERVAL) return stats;
+        statsAge = 0;
+        std::vector<FrameSample> samples;
+        Snapshot(samples);
+        if (samples.empty()) return stats;
+        std::vector<float> values(samples.size());
+        for (int p = 0; p <= PHASE_COUNT; p++) {
+            float sum = 0;
+            for (size_t i = 0; i < samples.size(); i++) {
+                values[i] = (p < PHASE_COUNT) ? samples[i].phase[p] : samples[i].frame;
+                sum += values[i];
             }
+            size_t rank = (values.size() * 99) / 100;
+            std::nth_element(values.begin(), values.begin() + rank, values.end());
+            stats[p].p99 = values[rank];
+            stats[p].min = *std::min_element(values.begin(), values.end());
+            stats[p].avg = sum / values.size();
         }
+        return stats;
     }
 
-    void GetText(char* text, int selection) {
-        if (selection > statesCount) return;
-        char buffer[10];
-        _snprintf_s(buffer, 10, "%2d. ",selection);
-        strncpy_s(text, 128 * sizeof(char), buffer, 10 * sizeof(char));
-        for (int i = 0;i < jointCount;i++) {
-            _snprintf_s(buffer, 10, "%7.3f, ", GetJointParameter(selection, i));
-            strncat_s(text, 128 * sizeof(char), buffer, 10 * sizeof(char));
-        }
-        text[strnlen_s(text, 128) - 2] = '\0';
+    FrameSample GetLastFrame() {
+        unsigned end = written.load(std::memory_order_acquire);
+        if (end == 0) return current;
+        return frames[(end - 1) & (PROFILER_FRAMES - 1)];
     }
 
-    float GetJointParameter(int state, int joint) {
-        return c[(state - 1) * jointCount + joint];
+    // zapis klatek do analizy poza programem: fileName.csv i fileName.json
+    bool Export(const char* fileName) {
+        std::vector<FrameSample> samples;
+        Snapshot(samples);
+        FILE* csv = NULL;
+        FILE* json = NULL;
+        if (fopen_s(&csv, TextFormat("%s.csv", fileName), "w") != 0 || csv == NULL) return false;
+        if (fopen_s(&json, TextFormat("%s.json", fileName), "w") != 0 || json == NULL) {
+            fclose(csv);
+            return false;
+        }
+        fprintf(csv, "frame");
+        for (int p = 0; p < PHASE_COUNT; p++) fprintf(csv, ",%s_ms", phaseKeys[p]);
+        fprintf(csv, ",frame_ms,draw_calls,uniform_uploads\n");
+        fprintf(json, "{\n  \"phases\": [");
+        for (int p = 0; p < PHASE_COUNT; p++) fprintf(json, "%s\"%s\"", p ? ", " : "", phaseKeys[p]);
+        fprintf(json, "],\n  \"frames\": [\n");
+        for (size_t i = 0; i < samples.size(); i++) {
+            const FrameSample& s = samples[i];
+            fprintf(csv, "%d", (int)i);
+            fprintf(json, "    { \"phase_ms\": [");
+            for (int p = 0; p < PHASE_COUNT; p++) {
+                fprintf(csv, ",%.4f", s.phase[p]);
+                fprintf(json, "%s%.4f", p ? ", " : "", s.phase[p]);
+            }
+            fprintf(csv, ",%.4f,%d,%d\n", s.frame, s.drawCalls, s.uniformUploads);
+            fprintf(json, "], \"frame_ms\": %.4f, \"draw_calls\": %d, \"uniform_uploads\": %d }%s\n",
+                s.frame, s.drawCalls, s.uniformUploads, (i + 1 < samples.size()) ? "," : "");
+        }
+        fprintf(json, "  ]\n}\n");
+        fclose(csv);
+        fclose(json);
+        return true;
     }
+};
 
-    int GetStatesCount() {
-        return statesCount;
-    }
+#define PROFILE_PHASE(profiler, phase) (profiler).Phase(phase)
+#define PROFILE_DRAW_CALLS(profiler, calls, uploads) (profiler).AddDrawCalls(calls, uploads)
+#define PROFILE_END_FRAME(profiler) (profiler).EndFrame()
+#else
+#define PROFILE_PHASE(profiler, phase)
+#define PROFILE_DRAW_CALLS(profiler, calls, uploads)
+#define PROFILE_END_FRAME(profiler)
+#endif
 
-    int GetCurrentState() {
-        return currentState;
-    }
+// stan z wątku sterowania potrzebny panelom, kopiowany pod krótką blokadą; GUI rysowane jest już bez niej
+struct PanelSnapshot {
+    IKStats ik;
+    float ikAverage, ikMax;
+    bool ikPose;                // rozwiązanie z orientacją (co najmniej 6 złączy)
+    float collisionMicroseconds;
+    bool colliding;
+    float lastCycleTime;
+    int statesCount;
+    int currentState;
+    int revision;
+    int firstRow;               // numer pierwszego skopiowanego wiersza panelu programu
+    std::vector<char> rows;     // skopiowane wiersze, ROW_TEXT_SIZE znaków na wiersz
+    long long recorderSamples, recorderPoints;
+    int recorderPending;
+    long long ipcReceived;
+    float ipcP50, ipcP99, ipcMax;
 };
 
 class GUI {
-    Font font;
+    GlyphCache fonts;
     Rectangle SavedStatesPanelView = { 0, 0, 0, 0 };
     Vector2 SavedStatesPanelOffset = { 0, 0 };
 public:
     bool JointPositionBoxEditMode = false;
     float JointPositionBoxValue;
+    bool JointPositionBoxChanged = false; // wartość zmieniona w oknie w tej klatce (tylko wtedy trafia do ramienia)
+    int CartesianBoxEditAxis = -1; // edytowana współrzędna końcówki (-1 gdy żadna)
+    Vector3 CartesianBoxValue = { 0, 0, 0 };
     bool showHelp = false;
-    GUI() {
-        //wczytywanie czcionki
-        const int codepointCount = 0x0FFF;
-        int codepoints[codepointCount];
-        for (int i = 0; i < codepointCount; i++) {
-            codepoints[i] = i;
-        }
-        font = LoadFontEx("Roboto_Condensed-Bold.ttf", 24, codepoints, codepointCount);
-        GuiSetFont(font);
+    GUI() : fonts("Roboto_Condensed-Bold.ttf") {
+        //wczytywanie czcionki - glify rasteryzowane dopiero przy pierwszym użyciu
+        auto start = std::chrono::steady_clock::now();
+        GuiSetFont(fonts.Get(24));
         GuiSetStyle(DEFAULT, TEXT_SIZE, 24);
+        TraceLog(LOG_INFO, "FONT: %.2f ms, %d glifow, atlas %.1f KB", std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - start).count(),
+            fonts.GetGlyphCount(), fonts.GetAtlasBytes() / 1024.0f);
+    }
+    // tekst dla kontrolek raygui: dokłada brakujące glify i odświeża czcionkę raygui (trzyma ona kopię struktury Font)
+    const char* Glyphs(const char* text) {
+        GuiSetFont(fonts.Get(24, text));
+        return text;
     }
-    ~GUI() {
-        UnloadFont(font);
+    void DrawTextSized(const char* text, int x, int y, int fontSize, Color color) {
+        DrawTextEx(fonts.Get(fontSize, text), text, { (float)x, (float)y }, (float)fontSize, 1, color);
+    }
+    int MeasureTextSized(const char* text, int fontSize) {
+        return (int)MeasureTextEx(fonts.Get(fontSize, text), text, (float)fontSize, 1).x;
+    }
+    // kopia stanu paneli - wywoływana pod blokadą sterowania, wiersze programu tylko z okolicy widocznego okna
+    void CapturePanels(RobotArm& robot, SavedStates& savedStates, TeachRecorder& recorder, IpcEndpoint& ipc, PanelSnapshot& panels) {
+        InverseKinematics& ik = robot.GetIK();
+        panels.ik = ik.GetLastStats();
+        panels.ikAverage = ik.GetAverageMicroseconds();
+        panels.ikMax = ik.GetMaxMicroseconds();
+        panels.ikPose = ik.GetActiveCount() >= 6;
+        panels.collisionMicroseconds = robot.GetCollision().GetLastMicroseconds();
+        panels.colliding = robot.GetCollision().AnyCollision();
+        panels.lastCycleTime = savedStates.GetLastCycleTime();
+        panels.statesCount = savedStates.GetStatesCount();
+        panels.currentState = savedStates.GetCurrentState();
+        panels.revision = savedStates.GetRevision();
+        int first, last;
+        GetVisibleRows(panels.statesCount, first, last);
+        first = std::max(1, first - 4); // zapas na przewinięcie w tej klatce
+        last = std::min(panels.statesCount, last + 4);
+        panels.firstRow = first;
+        panels.rows.resize((size_t)std::max(0, last - first + 1) * ROW_TEXT_SIZE);
+        for (int i = first; i <= last; i++) {
+            strncpy_s(&panels.rows[(size_t)(i - first) * ROW_TEXT_SIZE], ROW_TEXT_SIZE, savedStates.GetRowText(i), ROW_TEXT_SIZE - 1);
+        }
+        panels.recorderSamples = recorder.GetSampleCount();
+        panels.recorderPoints = recorder.GetPointCount();
+        panels.recorderPending = recorder.GetPendingPoints();
+        panels.ipcReceived = ipc.GetReceived();
+        ipc.GetLatency(panels.ipcP50, panels.ipcP99, panels.ipcMax);
     }
     // okno zawierające informacje o położeniu (rozstawie) złącza
-    void DrawJointPositionBox(JointType jt) {
+    void DrawJointPositionBox(JointType jt, float minValue, float maxValue) {
         const char* text[] = { "Kąt obrotu [°]:","Przesunięcie:","Rozstaw:" };
         Rectangle JointPositionBoxBounds = { GetScreenWidth() / 2.f, 10, 120, 24 };
-        int minValue = (jt == REVOLUTE) ? -170 : 0;
-        int maxValue = (jt == REVOLUTE) ? 170 : 2;
-        GuiFloatBox(JointPositionBoxBounds, text[jt], &JointPositionBoxValue, minValue, maxValue, JointPositionBoxEditMode);
+        float before = JointPositionBoxValue;
+        GuiFloatBox(JointPositionBoxBounds, Glyphs(text[jt]), &JointPositionBoxValue, (int)minValue, (int)maxValue, JointPositionBoxEditMode);
+        JointPositionBoxChanged = JointPositionBoxValue != before;
+    }
+    // okna z położeniem końcówki robota, zwraca true po zakończeniu edycji współrzędnej
+    bool DrawCartesianPositionBox() {
+        const char* text[] = { "X:", "Y:", "Z:" };
+        float* values[] = { &CartesianBoxValue.x, &CartesianBoxValue.y, &CartesianBoxValue.z };
+        bool finished = false;
+        for (int axis = 0; axis < 3; axis++) {
+            Rectangle bounds = { GetScreenWidth() / 2.f + axis * 170, 44, 120, 24 };
+            if (GuiFloatBox(bounds, text[axis], values[axis], -100, 100, CartesianBoxEditAxis == axis)) {
+                if (CartesianBoxEditAxis == axis) {
+                    CartesianBoxEditAxis = -1;
+                    finished = true;
+                } else if (CartesianBoxEditAxis < 0) {
+                    CartesianBoxEditAxis = axis;
+                }
+            }
+        }
+        return finished;
+    }
+    // czas i liczba iteracji ostatniego rozwiązania kinematyki odwrotnej
+    void DrawIKStats(const PanelSnapshot& panels) {
+        const IKStats& stats = panels.ik;
+        const char* text = TextFormat("IK%s: %d it., %.0f us (sr. %.0f us, maks. %.0f us)%s", panels.ikPose ? " (poza)" : "",
+            stats.iterations, stats.microseconds, panels.ikAverage, panels.ikMax, stats.converged ? "" : " - poza zasiegiem");
+        DrawTextSized(text, (int)(GetScreenWidth() / 2.f), 78, 16, LIGHTGRAY);
+    }
+    // czas cyklu pracy i rodzaj profilu ruchu
+    void DrawCycleStats(SavedStates* savedStates, const PanelSnapshot& panels) {
+        // profil, tor i przejście zmienia tylko wątek okna
+        const char* profile = (savedStates->GetProfile() == PROFILE_TRAPEZOIDAL) ? "trapezowy" : "S";
+        // tory sklejane tylko dla programów mieszczących się w pamięci (SPLINE_MAX_POINTS), dłuższe czytane strumieniem
+        bool streamed = savedStates->GetPathMode() != PATH_POINT_TO_POINT && panels.statesCount > SPLINE_MAX_POINTS;
+        DrawTextSized(TextFormat("Cykl: %.3f s, profil %s (T), tor %s%s (B), przejscie %.2f (N)", panels.lastCycleTime, profile,
+            pathModeNames[savedStates->GetPathMode()], streamed ? " - za dlugi program, punkt-punkt" : "", savedStates->GetBlend()),
+            (int)(GetScreenWidth() / 2.f), 118, 16, LIGHTGRAY);
+    }
+#if FRAME_PROFILER
+    // nakładka profilera: min/średnia/p99 faz z ostatnich klatek i liczniki rysowania ostatniej klatki
+    void DrawProfilerOverlay(FrameProfiler& profiler) {
+        const PhaseStats* stats = profiler.GetStats();
+        FrameSample last = profiler.GetLastFrame();
+        const int lineHeight = 20;
+        const int columns[] = { 0, 110, 170, 230 };
+        int x = 10;
+        int y = GetScreenHeight() - (PHASE_COUNT + 3) * lineHeight - 10;
+        DrawRectangle(x - 5, y - 5, 300, (PHASE_COUNT + 3) * lineHeight + 10, Fade(BLACK, 0.7f));
+        const char* header[] = { "faza [ms]", "min", "sr", "p99" };
+        for (int c = 0; c < 4; c++) DrawTextSized(header[c], x + columns[c], y, 16, LIGHTGRAY);
+        for (int p = 0; p <= PHASE_COUNT; p++) {
+            int rowY = y + (p + 1) * lineHeight;
+            DrawTextSized(p < PHASE_COUNT ? phaseNames[p] : "klatka", x, rowY, 16, p < PHASE_COUNT ? RAYWHITE : YELLOW);
+            DrawTextSized(TextFormat("%.2f", stats[p].min), x + columns[1], rowY, 16, RAYWHITE);
+            DrawTextSized(TextFormat("%.2f", stats[p].avg), x + columns[2], rowY, 16, RAYWHITE);
+            DrawTextSized(TextFormat("%.2f", stats[p].p99), x + columns[3], rowY, 16, RAYWHITE);
+        }
+        DrawTextSized(TextFormat("wywolania rysowania %d, uniformy %d", last.drawCalls, last.uniformUploads),
+            x, y + (PHASE_COUNT + 2) * lineHeight, 16, LIGHTGRAY);
+    }
+#endif
+    // stan nagrywania ciągłego: próbki, zachowane punkty i punkty czekające na zapis
+    void DrawRecorderStats(const PanelSnapshot& panels) {
+        DrawTextSized(TextFormat("Nagrywanie (R konczy): %lld probek, %lld punktow, %d czeka na zapis", panels.recorderSamples, panels.recorderPoints, panels.recorderPending),
+            (int)(GetScreenWidth() / 2.f), 158, 16, RED);
+    }
+    // liczba robotów w celi i czas przeliczenia ich kinematyki
+    void DrawCellStats(RobotCell& cell) {
+        DrawTextSized(TextFormat("Cela: %d robotow (%d typy), kinematyka %.0f us", cell.GetRobotCount(), cell.GetTypeCount(), cell.GetLastUpdateMicroseconds()),
+            (int)(GetScreenWidth() / 2.f), 138, 16, LIGHTGRAY);
+    }
+    // częstotliwość pętli sterowania i najdłuższy krok z ostatniej sekundy
+    void DrawControlStats(ControlLoop& control) {
+        const char* text = control.IsThreaded()
+            ? TextFormat("Sterowanie: %.0f Hz, krok maks. %.0f us, pominiete %lld", control.GetMeasuredRate(), control.GetMaxStepMicroseconds(), control.GetDroppedSteps())
+            : "Sterowanie: w petli okna";
+        DrawTextSized(text, (int)(GetScreenWidth() / 2.f), 178, 16, LIGHTGRAY);
+    }
+    // polecenia zewnętrznego sterownika i opóźnienie od wysłania do zastosowania
+    void DrawIpcStats(IpcEndpoint& ipc, const PanelSnapshot& panels) {
+        DrawTextSized(TextFormat("IPC: %lld polecen, opoznienie p50 %.0f us, p99 %.0f us, tryb %s", panels.ipcReceived, panels.ipcP50, panels.ipcP99,
+            ipc.IsDirect() ? "bez wygladzania" : "wygladzany"),
+            (int)(GetScreenWidth() / 2.f), 198, 16, LIGHTGRAY);
+    }
+    // stan mapy zasięgu: obliczanie w tle, liczba wokseli i źródło (plik albo obliczenie)
+    void DrawReachStats(ReachOverlay& reach) {
+        const char* text = "Zasieg (M): liczenie...";
+        if (reach.IsReady()) {
+            const ReachabilityMap& map = reach.GetMap();
+            text = map.IsFromCache()
+                ? TextFormat("Zasieg (M): %d wokseli, %lld konfiguracji, z pliku", (int)map.GetVoxels().size(), map.GetConfigurations())
+                : TextFormat("Zasieg (M): %d wokseli, %lld konfiguracji, %.0f ms (%d watki, %d kradziezy)",
+                    (int)map.GetVoxels().size(), map.GetConfigurations(), map.GetMilliseconds(), map.GetThreads(), map.GetSteals());
+        }
+        DrawTextSized(text, (int)(GetScreenWidth() / 2.f), 218, 16, LIGHTGRAY);
+    }
+    // planowanie odcinków programu: postęp, czas i długość ścieżek względem odcinków prostych
+    void DrawPlannerStats(MotionPlannerPool& planner) {
+        int segments, done, found;
+        float length, straight, milliseconds, slowest;
+        planner.GetSummary(segments, done, found, length, straight, milliseconds, slowest);
+        const char* text = (done < segments)
+            ? TextFormat("Planer (L): %d/%d odcinkow, %.0f ms...", done, segments, milliseconds)
+            : TextFormat("Planer (L): %d/%d odcinkow bez kolizji, %.0f ms (najdluzszy %.0f ms), dlugosc %.0f (prosto %.0f)%s",
+                found, segments, milliseconds, slowest, length, straight, (found == segments && segments > 0) ? ", Ctrl+L wstawia" : "");
+        DrawTextSized(text, (int)(GetScreenWidth() / 2.f), 238, 16, (found < done) ? ORANGE : LIGHTGRAY);
+    }
+    // minimalny czas cyklu programu względem dawnego trybu pracy (60 klatek na punkt)
+    void DrawOptimizerStats(CycleOptimizerTask& optimizer, int revision) {
+        const char* text = "Optymalizacja (O): obliczanie...";
+        if (optimizer.IsReady()) {
+            const CycleReport& r = optimizer.GetReport();
+            text = TextFormat("Optymalizacja (O): %.3f s (%s%s), dawniej %.1f s, teraz %.3f s, %.0f ms%s", r.best.cycleTime, pathModeNames[r.best.path],
+                r.best.reordered ? ", nowa kolejnosc" : "", r.legacyTime, r.currentTime, r.milliseconds,
+                optimizer.IsCurrent(revision) ? ", Ctrl+O stosuje" : " - program zmieniony");
+        }
+        DrawTextSized(text, (int)(GetScreenWidth() / 2.f), 258, 16, LIGHTGRAY);
+    }
+    // objętość robocza programu: wielkość bryły, granice i czas obliczenia
+    void DrawSweptStats(SweptOverlay& swept, int pointCount) {
+        const char* text = (pointCount == 0) ? "Objetosc robocza (V): brak programu" : "Objetosc robocza (V): liczenie...";
+        if (pointCount > 0 && swept.IsReady()) {
+            const SweptVolume& volume = swept.GetVolume();
+            BoundingBox b = volume.GetBounds();
+            text = TextFormat("Objetosc robocza (V): %.0f j^3, granice %.1f x %.1f x %.1f, %d probek, %.0f ms (%d watki)%s", volume.GetVolume(),
+                b.max.x - b.min.x, b.max.y - b.min.y, b.max.z - b.min.z, volume.GetSamples(), volume.GetMilliseconds(), volume.GetThreads(),
+                swept.IsExported() ? TextFormat(", %s", swept.GetExportPath()) : "");
+        }
+        DrawTextSized(text, (int)(GetScreenWidth() / 2.f), 278, 16, LIGHTGRAY);
+    }
+    // czas sprawdzania kolizji i ostrzeżenie o kolizji
+    void DrawCollisionStats(const PanelSnapshot& panels) {
+        const char* text = TextFormat("Kolizje: %.0f us", panels.collisionMicroseconds);
+        DrawTextSized(text, (int)(GetScreenWidth() / 2.f), 98, 16, LIGHTGRAY);
+        if (panels.colliding) DrawTextSized("KOLIZJA", (int)(GetScreenWidth() / 2.f) + 160, 98, 16, RED);
     }
   // gui w trybie nauki/pracy
-void DrawSavedStatesPanel(SavedStates* savedStates) {
+// wymiary panelu programu dla statesCount wierszy (przy bieżącym przewinięciu)
+void GetSavedStatesLayout(int statesCount, Rectangle& bounds, Rectangle& content, float& listTop, float& visibleBottom) {
     const float itemHeight = 24.0f;
     const float headerHeight = 30.0f;
-    const float keyHelpFontSize = 16.0f;
-    const int keyHelpLines = 3;
-    const float keyHelpLineSpacing = keyHelpFontSize + 16.0f;
-    const float keyHelpHeight = keyHelpLines * keyHelpLineSpacing;
+    const float keyHelpLineSpacing = 16.0f + 16.0f;
+    const float keyHelpHeight = 3 * keyHelpLineSpacing;
 
     const float maxHeight = GetScreenHeight() - 100.0f;
-    int statesCount = savedStates->GetStatesCount();
-
     float requiredContentHeight = headerHeight + keyHelpHeight + itemHeight * statesCount;
     float panelHeight = requiredContentHeight;
     if (panelHeight > maxHeight) panelHeight = maxHeight;
 
-    Rectangle SavedStatesPanelBounds = { 24, 50, 330, panelHeight };
-    Rectangle SavedStatesPanelContent = {
-        SavedStatesPanelBounds.x,
-        SavedStatesPanelBounds.y,
-        SavedStatesPanelBounds.width - 16,
-        requiredContentHeight
-    };
+    bounds = { 24, 50, 330, panelHeight };
+    content = { bounds.x, bounds.y, bounds.width - 16, requiredContentHeight };
+    listTop = SavedStatesPanelOffset.y + content.y + headerHeight + keyHelpHeight;
+    visibleBottom = bounds.y + bounds.height - 13;
+}
+
+// numery wierszy programu widocznych w oknie przewijania
+void GetVisibleRows(int statesCount, int& first, int& last) {
+    const float itemHeight = 24.0f;
+    Rectangle bounds, content;
+    float listTop, visibleBottom;
+    GetSavedStatesLayout(statesCount, bounds, content, listTop, visibleBottom);
+    first = (int)floorf((bounds.y - listTop) / itemHeight) + 1;
+    last = (int)ceilf((visibleBottom - listTop) / itemHeight);
+    if (first < 1) first = 1;
+    if (last > statesCount) last = statesCount;
+}
+
+  // gui w trybie nauki/pracy; wiersze z kopii zrobionej pod blokadą (CapturePanels)
+void DrawSavedStatesPanel(const PanelSnapshot& panels) {
+    const float itemHeight = 24.0f;
+    const float headerHeight = 30.0f;
+    const float keyHelpFontSize = 16.0f;
+    int statesCount = panels.statesCount;
+
+    Rectangle SavedStatesPanelBounds, SavedStatesPanelContent;
+    float listTop, visibleBottom;
+    GetSavedStatesLayout(statesCount, SavedStatesPanelBounds, SavedStatesPanelContent, listTop, visibleBottom);
 
     GuiScrollPanel(SavedStatesPanelBounds, NULL, SavedStatesPanelContent, &SavedStatesPanelOffset, &SavedStatesPanelView);
+    GetSavedStatesLayout(statesCount, SavedStatesPanelBounds, SavedStatesPanelContent, listTop, visibleBottom); // po przewinięciu
 
     // Nagłówek
     Rectangle headerRect = {
@@ -516,7 +7750,7 @@ void DrawSavedStatesPanel(SavedStates* savedStates) {
         SavedStatesPanelContent.width,
         headerHeight
     };
-    GuiDrawText("Zapisane stany", headerRect, TEXT_ALIGN_CENTER, DARKGRAY);
+    GuiDrawText(Glyphs("Zapisane stany"), headerRect, TEXT_ALIGN_CENTER, DARKGRAY);
 
     // Sekcja pomocy (klawisze)
     const char* keys[] = { "Ctrl+S", "P", "U" };
@@ -525,29 +7759,31 @@ void DrawSavedStatesPanel(SavedStates* savedStates) {
     int keyHelpY = (int)(SavedStatesPanelBounds.y + headerHeight + 6);
     DrawKeyHelpList(keys, descriptions, 3, keyHelpX, keyHelpY, (int)keyHelpFontSize, 100);
 
-    // Lista zapisanych stanów 
-    for (int i = 1; i <= statesCount; i++) {
-        Color clr = (savedStates->GetCurrentState() == i) ? YELLOW : BLACK;
-        char buffer[128];
-        savedStates->GetText(buffer, i); // ← tu nic nie zmieniamy, tylko wyświetlamy
+    // Lista zapisanych stanów - tylko wiersze widoczne w oknie przewijania (i skopiowane w tej klatce)
+    int first, last;
+    GetVisibleRows(statesCount, first, last);
+    int copied = (int)(panels.rows.size() / ROW_TEXT_SIZE);
+    if (first < panels.firstRow) first = panels.firstRow;
+    if (last > panels.firstRow + copied - 1) last = panels.firstRow + copied - 1;
+    for (int i = first; i <= last; i++) {
+        Color clr = (panels.currentState == i) ? YELLOW : BLACK;
 
         Rectangle textBounds = {
             SavedStatesPanelContent.x,
-            SavedStatesPanelOffset.y + SavedStatesPanelContent.y + headerHeight + keyHelpHeight + itemHeight * (i - 1),
+            listTop + itemHeight * (i - 1),
             SavedStatesPanelContent.width,
             itemHeight
         };
 
-        if (textBounds.y >= SavedStatesPanelBounds.y &&
-            textBounds.y < SavedStatesPanelBounds.y + SavedStatesPanelBounds.height - 13) {
-            GuiDrawText(buffer, textBounds, TEXT_ALIGN_LEFT, clr);
+        if (textBounds.y >= SavedStatesPanelBounds.y && textBounds.y < visibleBottom) {
+            GuiDrawText(Glyphs(&panels.rows[(size_t)(i - panels.firstRow) * ROW_TEXT_SIZE]), textBounds, TEXT_ALIGN_LEFT, clr);
         }
     }
 }
     
    void DrawKeyHelpEntry(const char* key, const char* description, int x, int y, int fontSize, int keyColWidth) {
     int padding = 6;
-    int keyTextWidth = MeasureText(key, fontSize);
+    int keyTextWidth = MeasureTextSized(key, fontSize);
     int boxWidth = keyTextWidth + padding*2;
     int boxHeight = fontSize + padding * 2;
  
@@ -555,9 +7791,9 @@ void DrawSavedStatesPanel(SavedStates* savedStates) {
  
     DrawRectangle(offsetX, y, boxWidth, boxHeight, DARKGRAY);
     DrawRectangleLines(offsetX, y, boxWidth, boxHeight, LIGHTGRAY);
-    DrawText(key, offsetX + padding, y + padding, fontSize, RAYWHITE);
+    DrawTextSized(key, offsetX + padding, y + padding, fontSize, RAYWHITE);
  
-    DrawText(description, x + keyColWidth + 16, y + padding, fontSize, DARKGRAY);
+    DrawTextSized(description, x + keyColWidth + 16, y + padding, fontSize, DARKGRAY);
 }
  
 // uniwersalna funkcja do rysowania listy skrótów klawiszowych
@@ -566,7 +7802,7 @@ void DrawKeyHelpList(const char** keys, const char** descriptions, int count, in
  
     for (int i = 0; i < count; i++) {
         if (strlen(keys[i]) == 0) {
-            DrawText(descriptions[i], x, y + i * lineSpacing, fontSize, BLACK);
+            DrawTextSized(descriptions[i], x, y + i * lineSpacing, fontSize, BLACK);
         } else {
             DrawKeyHelpEntry(keys[i], descriptions[i], x, y + i * lineSpacing, fontSize, keyColWidth);
         }
@@ -579,7 +7815,7 @@ void DrawHelpPanel() {
     const char* keys[] = {
         "",         // nagłówek
         "=", "-", "PageUp", "PageDown", "Enter", "MMB",
-        "W", "A", "S", "D", "E", "Q", "U", "Ctrl+S", "Delete", "P"
+        "W", "A", "S", "D", "E", "Q", "U", "Ctrl+S", "Delete", "Ctrl+Delete", "R", "P", "T", "B", "Strzalki", "Home/End", "K", "G", "C", "F", "Ctrl+F", "M", "L", "Ctrl+L", "O", "Ctrl+O", "V"
     };
  
     const char* descriptions[] = {
@@ -599,24 +7835,46 @@ void DrawHelpPanel() {
         "przelacz w tryb uczenia",
         "zapisz pozycje robota",
         "usun ostatnia zapisana pozycje robota",
-        "przelacz w tryb pracy"
+        "usun caly program",
+        "nagrywanie ciagle ruchu (start/stop)",
+        "przelacz w tryb pracy",
+        "przelacz profil ruchu (trapezowy/S)",
+        "rodzaj toru (punkt-punkt/C1/C2/5. st.)",
+        "ruch koncowki w osiach X i Z",
+        "ruch koncowki w osi Y",
+        "przelacz rysowanie jednym wywolaniem",
+        "podglad zapisanego programu",
+        "cela z wieloma robotami",
+        "profiler klatki",
+        "zapis profilu do CSV i JSON",
+        "mapa zasiegu i manipulowalnosci",
+        "planowanie ruchu bez kolizji",
+        "wstaw zaplanowane punkty do programu",
+        "minimalny czas cyklu programu",
+        "zastosuj optymalna kolejnosc i tor",
+        "objetosc robocza programu (eksport OBJ)"
     };
  
+    int lineCount = sizeof(descriptions) / sizeof(descriptions[0]);
+
+    // panel rośnie z listą klawiszy, a gdy nie mieści się w oknie - zmniejszana jest czcionka
+    int fontSize = 20;
+    float maxHeight = GetScreenHeight() - 20.0f;
+    while (fontSize > 10 && 70 + lineCount * (fontSize + 16) > maxHeight) fontSize--;
+
     Rectangle bounds;
-    bounds.x = GetScreenWidth() / 2.0f - 350;
-    bounds.y = GetScreenHeight() / 2.0f - 300;
     bounds.width = 700;
-    bounds.height = 700;
+    bounds.height = (float)(70 + lineCount * (fontSize + 16));
+    bounds.x = GetScreenWidth() / 2.0f - bounds.width / 2;
+    bounds.y = GetScreenHeight() / 2.0f - bounds.height / 2;
  
     DrawRectangleRec(bounds, LIGHTGRAY);
-    GuiPanel(bounds, "POMOC (H aby zamknąć)");
+    GuiPanel(bounds, Glyphs("POMOC (H aby zamknąć)"));
  
-    int fontSize = 20;
     int baseX = (int)(bounds.x + 30);
     int baseY = (int)(bounds.y + 50);
     int keyColWidth = 120;
  
-    int lineCount = sizeof(descriptions) / sizeof(descriptions[0]);
     DrawKeyHelpList(keys, descriptions, lineCount, baseX, baseY, fontSize, keyColWidth);
 }
  
@@ -630,20 +7888,224 @@ void DrawHelpPanel() {
  
 };
 
-int main() {
+int main(int argc, char** argv) {
+    // --no-cache: modele zawsze z plików glTF (porównanie czasu startu)
+    // --build-cache plik.glb...: przygotowanie obrazów .rmc bez uruchamiania symulacji
+    // --program plik: dziennik programu robota (domyślnie program.rpg)
+    // --robot plik.glb, --device plik.glb: model ramienia i chwytaka (kinematyka ramienia z opisu plik.robot obok modelu)
+    // --batch program.rpg...: wykonanie programów bez okna i raport (--robot, --device, --path p2p|c1|c2|quintic,
+    //   --profile trapez|s, --blend 0..1, --cycles n, --threads n; opcje przed --batch albo za listą programów;
+    //   programy dłuższe niż SPLINE_MAX_POINTS punktów zawsze jadą punkt-punkt)
+    // --record plik.rin: nagranie wejścia i czasów klatek (program robota z chwili startu zapisywany obok jako plik.rin.rpg)
+    // --replay plik.rin: odtworzenie nagrania bez limitu klatek i statystyki czasów klatek (--stats plik.json,
+    //   --baseline plik.json - porównanie ze statystykami poprzedniej wersji)
+    // --control-rate hz: częstotliwość wątku sterowania (domyślnie 1000, 0 - krok w pętli okna; przy --replay zawsze 0)
+    // --ipc: nastawy z innych procesów (pamięć współdzielona robot_ipc, kanał sterujący robot.sock)
+    // --ipc-client: klient testowy dla --ipc (--ipc-rate hz, --ipc-seconds s, --ipc-direct - bez wygładzania)
+    // --reach: mapa zasięgu robota (--robot, --threads n, --reach-samples n na złącze) - obliczenie albo odczyt z pliku .reach
+    // --optimize program.rpg: minimalny czas cyklu programu (--robot, --threads n, --reorder - także kolejność punktów);
+    //   raport i program plik.opt.rpg; --reorder dotyczy też optymalizacji w oknie (O)
+    // --swept program.rpg: objętość robocza programu (--robot, --device, --path, --threads n, --swept-samples n,
+    //   --swept-voxel rozmiar) - raport i siatka plik.swept.obj
+    // --obstacle x0 y0 z0 x1 y1 z1: prostopadłościan sceny (narożniki) dla kolizji i planowania; można podać wiele razy
+    auto startupBegin = std::chrono::steady_clock::now();
+    bool useModelCache = true;
+    int buildCacheFrom = 0;
+    const char* programFile = "program.rpg";
+    const char* robotFile = "models/robots/puma.glb";
+    const char* deviceFile = "models/devices/manipulator.glb";
+    int batchFrom = 0;
+    PathMode batchPath = PATH_POINT_TO_POINT;
+    ProfileType batchProfile = PROFILE_TRAPEZOIDAL;
+    int batchCycles = 1;
+    float batchBlend = 1.0f;
+    int batchThreads = 0;
+    const char* recordFile = NULL;
+    const char* replayFile = NULL;
+    const char* statsFile = NULL;
+    const char* baselineFile = NULL;
+    float controlRate = CONTROL_RATE;
+    bool ipcEnabled = false;
+    bool ipcClient = false;
+    bool ipcDirect = false;
+    float ipcRate = 1000.0f;
+    float ipcSeconds = 5.0f;
+    bool reachOnly = false;
+    int reachSamples = REACH_SAMPLES_PER_JOINT;
+    std::vector<BoundingBox> obstacles;
+    const char* optimizeFile = NULL;
+    bool optimizeReorder = false;
+    const char* sweptFile = NULL;
+    int sweptSamples = SWEPT_SAMPLES;
+    float sweptVoxel = SWEPT_VOXEL_SIZE;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--no-cache") == 0) useModelCache = false;
+        else if (strcmp(argv[i], "--build-cache") == 0) buildCacheFrom = i + 1;
+        else if (strcmp(argv[i], "--batch") == 0) batchFrom = i + 1;
+        else if (strcmp(argv[i], "--program") == 0 && i + 1 < argc) programFile = argv[++i];
+        else if (strcmp(argv[i], "--robot") == 0 && i + 1 < argc) robotFile = argv[++i];
+        else if (strcmp(argv[i], "--device") == 0 && i + 1 < argc) deviceFile = argv[++i];
+        else if (strcmp(argv[i], "--cycles") == 0 && i + 1 < argc) batchCycles = atoi(argv[++i]);
+        else if (strcmp(argv[i], "--blend") == 0 && i + 1 < argc) batchBlend = Clamp((float)atof(argv[++i]), 0.0f, 1.0f);
+        else if (strcmp(argv[i], "--threads") == 0 && i + 1 < argc) batchThreads = atoi(argv[++i]);
+        else if (strcmp(argv[i], "--record") == 0 && i + 1 < argc) recordFile = argv[++i];
+        else if (strcmp(argv[i], "--replay") == 0 && i + 1 < argc) replayFile = argv[++i];
+        else if (strcmp(argv[i], "--stats") == 0 && i + 1 < argc) statsFile = argv[++i];
+        else if (strcmp(argv[i], "--baseline") == 0 && i + 1 < argc) baselineFile = argv[++i];
+        else if (strcmp(argv[i], "--control-rate") == 0 && i + 1 < argc) controlRate = (float)atof(argv[++i]);
+        else if (strcmp(argv[i], "--ipc") == 0) ipcEnabled = true;
+        else if (strcmp(argv[i], "--reach") == 0) reachOnly = true;
+        else if (strcmp(argv[i], "--reach-samples") == 0 && i + 1 < argc) reachSamples = atoi(argv[++i]);
+        else if (strcmp(argv[i], "--ipc-client") == 0) ipcClient = true;
+        else if (strcmp(argv[i], "--optimize") == 0 && i + 1 < argc) optimizeFile = argv[++i];
+        else if (strcmp(argv[i], "--reorder") == 0) optimizeReorder = true;
+        else if (strcmp(argv[i], "--swept") == 0 && i + 1 < argc) sweptFile = argv[++i];
+        else if (strcmp(argv[i], "--swept-samples") == 0 && i + 1 < argc) sweptSamples = atoi(argv[++i]);
+        else if (strcmp(argv[i], "--swept-voxel") == 0 && i + 1 < argc) sweptVoxel = (float)atof(argv[++i]);
+        else if (strcmp(argv[i], "--obstacle") == 0 && i + 6 < argc) {
+            float c[6];
+            for (int k = 0; k < 6; k++) c[k] = (float)atof(argv[++i]);
+            obstacles.push_back({ { fminf(c[0], c[3]), fminf(c[1], c[4]), fminf(c[2], c[5]) }, { fmaxf(c[0], c[3]), fmaxf(c[1], c[4]), fmaxf(c[2], c[5]) } });
+        }
+        else if (strcmp(argv[i], "--ipc-direct") == 0) ipcDirect = true;
+        else if (strcmp(argv[i], "--ipc-rate") == 0 && i + 1 < argc) ipcRate = (float)atof(argv[++i]);
+        else if (strcmp(argv[i], "--ipc-seconds") == 0 && i + 1 < argc) ipcSeconds = (float)atof(argv[++i]);
+        else if (strcmp(argv[i], "--profile") == 0 && i + 1 < argc) {
+            batchProfile = (strcmp(argv[++i], "s") == 0) ? PROFILE_SCURVE : PROFILE_TRAPEZOIDAL;
+        }
+        else if (strcmp(argv[i], "--path") == 0 && i + 1 < argc) {
+            const char* paths[PATH_MODE_COUNT] = { "p2p", "c1", "c2", "quintic" };
+            i++;
+            for (int p = 0; p < PATH_MODE_COUNT; p++) {
+                if (strcmp(argv[i], paths[p]) == 0) batchPath = (PathMode)p;
+            }
+        }
+    }
+    if (ipcClient) {
+        return RunIpcClient(ipcSeconds, (ipcRate > 0) ? ipcRate : 1000.0f, ipcDirect);
+    }
+    if (optimizeFile != NULL) {
+        SetTraceLogLevel(LOG_WARNING);
+        return RunCycleOptimizer(robotFile, optimizeFile, optimizeReorder, batchThreads);
+    }
+    if (sweptFile != NULL) {
+        SetTraceLogLevel(LOG_WARNING);
+        return RunSweptVolume(robotFile, deviceFile, sweptFile, batchPath, sweptSamples, sweptVoxel, batchThreads);
+    }
+    if (reachOnly) {
+        SetTraceLogLevel(LOG_WARNING);
+        Model skeleton = LoadSkeleton(robotFile);
+        if (skeleton.boneCount < 2) return 1;
+        ReachabilityMap map;
+        map.SetChain(LoadArmChain(skeleton, robotFile));
+        map.SetSampling(reachSamples, REACH_VOXEL_SIZE);
+        UnloadModel(skeleton);
+        char path[300];
+        GetReachMapPath(robotFile, path, sizeof(path));
+        map.LoadOrCompute(path, batchThreads);
+        float minMean = FLT_MAX, sumMean = 0;
+        long long hits = 0;
+        for (const ReachVoxel& voxel : map.GetVoxels()) {
+            minMean = fminf(minMean, voxel.meanManipulability);
+            sumMean += voxel.meanManipulability;
+            hits += voxel.count;
+        }
+        int count = (int)map.GetVoxels().size();
+        printf("%s: %lld konfiguracji, %d wokseli (%.1f j^3), manipulowalnosc min %.3f sr. %.3f maks. %.3f\n", robotFile, map.GetConfigurations(), count,
+            count * powf(map.GetVoxelSize(), 3), count ? minMean : 0, count ? sumMean / count : 0, map.GetMaxManipulability());
+        if (map.IsFromCache()) printf("%s: odczyt %.1f ms\n", path, map.GetMilliseconds());
+        else printf("%s: obliczenie %.1f ms, %d watki, %d kradziezy, %.0f ns na konfiguracje\n", path, map.GetMilliseconds(), map.GetThreads(), map.GetSteals(),
+            map.GetMilliseconds() * 1e6f / (float)std::max(1LL, map.GetConfigurations()) * map.GetThreads());
+        return 0;
+    }
+    if (batchFrom > 0) {
+        // bez okna i kontekstu GL: szkielety z plików glb, programy z dysku
+        SetTraceLogLevel(LOG_WARNING);
+        BatchRunner runner;
+        runner.SetPathMode(batchPath);
+        runner.SetProfile(batchProfile);
+        runner.SetCycles(batchCycles);
+        runner.SetBlend(batchBlend);
+        if (!runner.Load(robotFile, deviceFile)) return 1;
+        int count = 0;
+        while (batchFrom + count < argc && strncmp(argv[batchFrom + count], "--", 2) != 0) count++;
+        if (count == 0) {
+            printf("--batch: brak plikow programow\n");
+            return 1;
+        }
+        return runner.RunAll(argv + batchFrom, count, batchThreads) ? 1 : 0;
+    }
+    if (buildCacheFrom > 0) {
+        // wczytanie modelu wymaga kontekstu GL, więc okno jest tworzone ukryte
+        SetConfigFlags(FLAG_WINDOW_HIDDEN);
+        InitWindow(1, 1, "robot");
+        int failed = 0;
+        for (int i = buildCacheFrom; i < argc && strncmp(argv[i], "--", 2) != 0; i++) {
+            Model model = LoadModel(argv[i]);
+            bool ok = model.meshCount > 0 && SaveModelCache(argv[i], model);
+            TraceLog(ok ? LOG_INFO : LOG_ERROR, "MODEL CACHE: %s %s", argv[i], ok ? "zapisany" : "blad zapisu");
+            if (!ok) failed++;
+            UnloadModel(model);
+        }
+        CloseWindow();
+        return failed ? 1 : 0;
+    }
+
+    // nagranie zaczyna się od programu robota z chwili startu - kopia obok nagrania, odtwarzanie pracuje na jej kopii
+    InputScenario scenario;
+    if (replayFile != NULL) {
+        if (!scenario.LoadReplay(replayFile)) return 1;
+        static char replayProgram[256];
+        _snprintf_s(replayProgram, sizeof(replayProgram) - 1, "%s.replay.rpg", replayFile);
+        programFile = replayProgram;
+        CopyProgramFile(TextFormat("%s.rpg", replayFile), programFile);
+    }
+    else if (recordFile != NULL) {
+        scenario.StartRecording(recordFile);
+        CopyProgramFile(programFile, TextFormat("%s.rpg", recordFile));
+    }
+
     SetConfigFlags(FLAG_WINDOW_RESIZABLE);
     InitWindow(800, 800, "robot"); //inicjalizacja okna
-    SetTargetFPS(60);
-    MaximizeWindow();
+    if (scenario.IsReplaying()) {
+        // klatki bez limitu, rozmiar okna z nagrania (pierwsze zdarzenie)
+        SetTargetFPS(0);
+    }
+    else {
+        SetTargetFPS(60);
+        MaximizeWindow();
+    }
 
     GUI gui;
 
     Shader shader = LoadShaderFromMemory(vertexShaderCode, fragmentShaderCode);
     clCamera CamInstance({ 4.0f, 2.0f, 4.0f });
-    Device device("models/devices/manipulator.glb", shader);
-    RobotArm robot("models/robots/puma.glb", device, shader); //wczytywanie modelu robota z plików glb
+    RenderState renderState(shader);
+    ModelLibrary library;
+    library.SetCacheEnabled(useModelCache);
+    Device device(library, deviceFile, shader);
+    RobotArm robot(library, robotFile, device, shader); //wczytywanie modelu robota z plików glb (kinematyka z pliku .robot)
+    for (const BoundingBox& box : obstacles) robot.GetCollision().AddObstacle(box);
 
-    SavedStates savedStates(robot);
+    SavedStates savedStates(robot, programFile);
+    TeachRecorder recorder;
+    IpcEndpoint ipc;
+    ControlLoop control(robot, savedStates, recorder);
+    if (ipcEnabled && ipc.Open(savedStates.GetJointCount(), IPC_SHARED_NAME, IPC_SOCKET_PATH)) control.SetExternal(&ipc);
+    SkinnedRenderer skinned;
+    bool skinnedRendering = skinned.Build(robot.GetModel(), device.GetModel()); // brak wsparcia - rysowanie per ogniwo
+    TrajectoryPreview preview;
+    bool showPreview = false;
+    RobotCell cell(library, shader);
+    bool showCell = false;
+    float cellTime = 0;
+    ReachOverlay reach;
+    bool showReach = false;
+    MotionPlannerPool planner;
+    CycleOptimizerTask optimizer;
+    SweptOverlay swept;
+    bool showSwept = false;
+    bool sweptVisible = false;
 
     int selection = 1;
     const int maxSelection = robot.GetBoneCount() - 1;
@@ -655,8 +8117,24 @@ int main() {
 
     bool cameraMovementEnabled = true;
     DisableCursor();
+#if FRAME_PROFILER
+    FrameProfiler profiler;
+    bool showProfiler = false;
+#endif
+
+    TraceLog(LOG_INFO, "START: %.1f ms do pierwszej klatki, modele %.1f ms (%s)",
+        std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - startupBegin).count(),
+        library.GetLoadMilliseconds(), useModelCache ? "obrazy .rmc" : "bez obrazow, --no-cache");
+    // z wątkiem sterowania tor budowany w tle; odtwarzanie nagrania zostaje powtarzalne (budowa od razu)
+    savedStates.SetBackgroundBuild(!scenario.IsReplaying() && controlRate > 0);
+    control.Start(scenario.IsReplaying() ? 0 : controlRate);
+    PanelSnapshot panels; // stan paneli z wątku sterowania (bufor wierszy używany ponownie)
+    std::vector<float> replacement; // nowy program przygotowany bez blokady (planer, optymalizacja)
+    int programRevision = savedStates.GetRevision(); // wersja programu z poprzedniej klatki
 
     while (!WindowShouldClose()) {
+        PROFILE_PHASE(profiler, PHASE_INPUT);
+        if (!scenario.BeginFrame()) break; // koniec odtwarzanego nagrania
         if (IsMouseButtonPressed(MOUSE_MIDDLE_BUTTON)) {
             cameraMovementEnabled = !cameraMovementEnabled; // przełączanie trybu sterowania kamerą
             (cameraMovementEnabled) ? DisableCursor() : EnableCursor();
@@ -664,6 +8142,43 @@ int main() {
         if (cameraMovementEnabled) {
             CamInstance.Update();
         }
+        if (IsKeyPressed(KEY_C)) {
+            showCell = !showCell;
+            if (showCell && cell.GetRobotCount() == 0) {
+                // cela pokazowa: siatka robotów obu typów wokół robota sterowanego
+                const char* arms[] = { "models/robots/puma.glb", "models/robots/robot.glb" };
+                for (int x = -5; x <= 5; x++) {
+                    for (int z = -5; z <= 5; z++) {
+                        if (x == 0 && z == 0) continue;
+                        cell.AddRobot(arms[(x + z) & 1], "models/devices/manipulator.glb", { x * 45.0f, 0, z * 45.0f }, (float)((x * 7 + z * 13) % 360));
+                    }
+                }
+            }
+        }
+        // program z planera albo optymalizacji składany bez blokady, dla wersji z poprzedniej klatki
+        bool applyPlan = false, applyOptimizer = false;
+        if (teachMode && !workMode && IsKeyDown(KEY_LEFT_CONTROL)) {
+            int jointCount = savedStates.GetJointCount();
+            if (IsKeyPressed(KEY_L)) {
+                applyPlan = planner.IsStarted() && planner.BuildProgram(programRevision, replacement);
+            }
+            else if (IsKeyPressed(KEY_O) && optimizer.IsReady() && optimizer.IsCurrent(programRevision)) {
+                const CycleReport& report = optimizer.GetReport();
+                const std::vector<float>& points = optimizer.GetPoints();
+                applyOptimizer = true;
+                replacement.clear();
+                if (report.best.reordered) {
+                    for (int i = 0; i < report.points; i++) {
+                        const float* point = &points[(size_t)report.order[i] * jointCount];
+                        replacement.insert(replacement.end(), point, point + jointCount);
+                    }
+                }
+            }
+        }
+        // stan sterowania zmieniany tylko pod blokadą; wątek sterowania nadrabia zaległe kroki po jej zwolnieniu
+        ipc.Receive();
+        std::unique_lock<std::mutex> controlLock = control.Lock();
+        ipc.Apply();
         if (IsKeyPressed(KEY_PAGE_UP)) {
             // zmiana wyboru i podświetlenia złącza
             selection = (selection == maxSelection) ? 1 : selection + 1;
@@ -673,7 +8188,7 @@ int main() {
             selection = (selection == 1) ? maxSelection : selection - 1;
             gui.JointPositionBoxEditMode = false;
         }
-        if (!gui.JointPositionBoxEditMode && !workMode) {
+        if (!gui.JointPositionBoxEditMode && gui.CartesianBoxEditAxis < 0 && !workMode) {
             if (IsKeyPressed(KEY_EQUAL)) {
                 // ruch złączem
                 robot.MoveJointDiscrete(selection, 1);
@@ -684,6 +8199,17 @@ int main() {
             if (IsKeyPressed(KEY_H)) {
                 gui.ToggleHelp();
             }
+            // ruch końcówki robota w układzie kartezjańskim
+            Vector3 jog = { 0, 0, 0 };
+            if (IsKeyPressed(KEY_RIGHT)) jog.x += 1;
+            if (IsKeyPressed(KEY_LEFT)) jog.x -= 1;
+            if (IsKeyPressed(KEY_DOWN)) jog.z += 1;
+            if (IsKeyPressed(KEY_UP)) jog.z -= 1;
+            if (IsKeyPressed(KEY_HOME)) jog.y += 1;
+            if (IsKeyPressed(KEY_END)) jog.y -= 1;
+            if (jog.x != 0 || jog.y != 0 || jog.z != 0) {
+                robot.JogTCP(Vector3Scale(jog, 0.5f));
+            }
  
         }
         if (teachMode && !workMode) {
@@ -691,28 +8217,152 @@ int main() {
             if (IsKeyDown(KEY_LEFT_CONTROL) && IsKeyPressed(KEY_S)) {
                 savedStates.Save();
             }
-            if (IsKeyPressed(KEY_DELETE)) {
+            if (IsKeyPressed(KEY_R)) {
+                // nagrywanie ciągłe ruchu prowadzonego przez operatora
+                if (recorder.IsRecording()) recorder.Stop(savedStates);
+                else recorder.Start(robot);
+            }
+            if (IsKeyDown(KEY_LEFT_CONTROL) && IsKeyPressed(KEY_DELETE)) {
+                savedStates.Reset();
+            }
+            else if (IsKeyPressed(KEY_DELETE)) {
                 savedStates.Delete();
             }
+            if (IsKeyDown(KEY_LEFT_CONTROL) && IsKeyPressed(KEY_L)) {
+                // punkty pośrednie ścieżek stają się punktami programu, o ile program nie zmienił się w tej klatce
+                int jointCount = savedStates.GetJointCount();
+                if (applyPlan && savedStates.GetRevision() == programRevision) {
+                    savedStates.Reset();
+                    savedStates.Append(replacement.data(), (int)replacement.size() / jointCount);
+                    TraceLog(LOG_INFO, "PLANER: program zastapiony %d punktami", (int)replacement.size() / jointCount);
+                }
+            }
+            else if (IsKeyPressed(KEY_L) && savedStates.GetStatesCount() > 1) {
+                // kopia kolizji z bieżącymi przeszkodami; planowanie w tle, okno rysuje dalej
+                planner.Start(robot.GetRestChain(), GripperChainFromModel(device.GetModel()), robot.GetCollision(), 0);
+                int jointCount = savedStates.GetJointCount();
+                std::vector<float> values((size_t)savedStates.GetStatesCount() * jointCount);
+                for (int state = 1; state <= savedStates.GetStatesCount(); state++) {
+                    for (int j = 0; j < jointCount; j++) values[(size_t)(state - 1) * jointCount + j] = savedStates.GetJointParameter(state, j);
+                }
+                planner.Plan(values.data(), savedStates.GetStatesCount(), savedStates.GetRevision());
+            }
+        }
+        if (teachMode && !workMode) {
+            if (IsKeyDown(KEY_LEFT_CONTROL) && IsKeyPressed(KEY_O)) {
+                // wynik tylko dla programu, dla którego liczono
+                if (applyOptimizer && savedStates.GetRevision() == programRevision) {
+                    const CycleReport& report = optimizer.GetReport();
+                    if (report.best.reordered) {
+                        savedStates.Reset();
+                        savedStates.Append(replacement.data(), report.points);
+                    }
+                    savedStates.SetPathMode(report.best.path);
+                    savedStates.SetProfile(report.best.profile);
+                    TraceLog(LOG_INFO, "OPTYMALIZACJA: tor %s, cykl %.3f s", pathModeNames[report.best.path], report.best.cycleTime);
+                }
+            }
+            else if (IsKeyPressed(KEY_O) && savedStates.GetStatesCount() > 1) {
+                int jointCount = savedStates.GetJointCount();
+                std::vector<float> values((size_t)savedStates.GetStatesCount() * jointCount);
+                for (int state = 1; state <= savedStates.GetStatesCount(); state++) {
+                    for (int j = 0; j < jointCount; j++) values[(size_t)(state - 1) * jointCount + j] = savedStates.GetJointParameter(state, j);
+                }
+                JointMotionLimits limits[MAX_JOINT_COUNT];
+                float minValues[MAX_JOINT_COUNT], maxValues[MAX_JOINT_COUNT];
+                for (int j = 0; j < jointCount; j++) {
+                    limits[j] = robot.GetMotionLimits(j + 1);
+                    robot.GetJointLimits(j + 1, minValues[j], maxValues[j]);
+                }
+                optimizer.Start(values.data(), savedStates.GetStatesCount(), jointCount, limits, minValues, maxValues,
+                    ManipulatorJoint(robot.GetRestChain()), savedStates.GetPathMode(), savedStates.GetProfile(), optimizeReorder, savedStates.GetRevision());
+            }
         }
-        if (IsKeyPressed(KEY_ENTER) && !workMode) gui.JointPositionBoxEditMode = !gui.JointPositionBoxEditMode;
+        if (IsKeyPressed(KEY_ENTER) && !workMode && gui.CartesianBoxEditAxis < 0) gui.JointPositionBoxEditMode = !gui.JointPositionBoxEditMode;
         if (IsKeyPressed(KEY_U)) {
             teachMode = !teachMode;
             if (!teachMode) {
+                // program zostaje w pliku, wyjście z trybu uczenia go nie kasuje
+                recorder.Stop(savedStates);
                 workMode = false;
-                savedStates.Reset();
+                savedStates.ResetCurrentState();
+            }
+        }
+        if (teachMode && IsKeyPressed(KEY_T)) {
+            savedStates.ToggleProfile();
+        }
+        if (teachMode && IsKeyPressed(KEY_B)) {
+            savedStates.CyclePathMode();
+        }
+        if (teachMode && IsKeyPressed(KEY_N)) {
+            savedStates.CycleBlend();
+        }
+        if (teachMode && IsKeyPressed(KEY_G) && preview.IsAvailable(skinned)) {
+            showPreview = !showPreview;
+        }
+        if (IsKeyPressed(KEY_M)) {
+            showReach = !showReach;
+            if (showReach) reach.Start(robot.GetRestChain(), robotFile);
+        }
+        if (IsKeyPressed(KEY_V)) {
+            showSwept = !showSwept;
+        }
+        sweptVisible = showSwept && savedStates.GetStatesCount() > 0; // bryła pustego programu nie jest rysowana
+        if (sweptVisible && !(swept.IsStarted() && swept.IsCurrent(savedStates.GetRevision()))
+            && (!swept.IsStarted() || swept.IsReady())) {
+            // przeliczenie po zmianie programu, gdy poprzednie obliczenie się skończyło
+            int jointCount = savedStates.GetJointCount();
+            std::vector<float> values((size_t)savedStates.GetStatesCount() * jointCount);
+            for (int state = 1; state <= savedStates.GetStatesCount(); state++) {
+                for (int j = 0; j < jointCount; j++) values[(size_t)(state - 1) * jointCount + j] = savedStates.GetJointParameter(state, j);
             }
+            JointMotionLimits limits[MAX_JOINT_COUNT];
+            for (int j = 0; j < jointCount; j++) limits[j] = robot.GetMotionLimits(j + 1);
+            swept.Start(robot.GetRestChain(), GripperChainFromModel(device.GetModel()), robot.GetModel(), device.GetModel(), values.data(),
+                savedStates.GetStatesCount(), limits, savedStates.GetPathMode(), programFile, savedStates.GetRevision());
+        }
+        if (IsKeyPressed(KEY_K) && skinned.IsReady()) {
+            skinnedRendering = !skinnedRendering;
+        }
+#if FRAME_PROFILER
+        if (IsKeyDown(KEY_LEFT_CONTROL) && IsKeyPressed(KEY_F)) {
+            // zapis ostatnich klatek do profile.csv i profile.json
+            TraceLog(profiler.Export("profile") ? LOG_INFO : LOG_ERROR, "PROFILER: eksport do profile.csv/profile.json");
         }
+        else if (IsKeyPressed(KEY_F)) {
+            showProfiler = !showProfiler;
+        }
+#endif
         if (teachMode && IsKeyPressed(KEY_P)) {
+            recorder.Stop(savedStates);
             workMode = !workMode;
             if (!workMode) savedStates.ResetCurrentState();
         }
 
-        gui.JointPositionBoxValue = robot.GetTargetPosition(selection);
-        robot.UpdateJointsSmooth(0.15f);
+        PROFILE_PHASE(profiler, PHASE_WORK);
+        control.SetWorkMode(workMode);
+        control.Update(scenario.GetFrameDelta()); // krok tylko bez wątku sterowania
 
-        if (workMode) savedStates.WorkMode();
+        PROFILE_PHASE(profiler, PHASE_JOINTS);
+        gui.JointPositionBoxValue = robot.GetTargetPosition(selection);
+        if (gui.CartesianBoxEditAxis < 0) gui.CartesianBoxValue = robot.GetTargetTCP();
+        programRevision = savedStates.GetRevision();
+        controlLock.unlock();
+        ipc.Flush();
+        if (showCell) {
+            // ruch pokazowy wszystkich robotów celi
+            cellTime += scenario.GetFrameDelta();
+            for (int r = 0; r < cell.GetRobotCount(); r++) {
+                float* joints = cell.GetJoints(r);
+                for (int j = 0; j < cell.GetJointCount(r) - 1; j++) {
+                    joints[j] = 40.0f * sinf(cellTime * 0.8f + r * 0.37f + j * 1.3f);
+                }
+            }
+            cell.Update();
+        }
+        const ArmSnapshot& pose = control.Acquire();
 
+        PROFILE_PHASE(profiler, PHASE_DRAW3D);
         BeginDrawing();
             ClearBackground(BLACK);
         
@@ -721,15 +8371,84 @@ int main() {
                 DrawLine3D({0, 0, 0}, {100, 0, 0}, RED);    // X
                 DrawLine3D({0, 0, 0}, {0, 100, 0}, GREEN);  // Y
                 DrawLine3D({0, 0, 0}, {0, 0, 100}, BLUE);   // Z
-                robot.Draw(selection, CamInstance.Get(), shader);
+                if (skinnedRendering) {
+                    robot.DrawSkinned(pose, selection, skinned, CamInstance.Get());
+                    PROFILE_DRAW_CALLS(profiler, skinned.GetDrawCalls(), skinned.GetUniformUploads());
+                }
+                else {
+                    renderState.BeginFrame(CamInstance.Get());
+                    robot.Draw(pose, selection, renderState);
+                    renderState.EndFrame();
+                    PROFILE_DRAW_CALLS(profiler, renderState.GetDrawCalls(), renderState.GetUniformUploads());
+                }
+                if (showCell) {
+                    cell.Draw(CamInstance.Get());
+                    PROFILE_DRAW_CALLS(profiler, cell.GetDrawCalls(), cell.GetUniformUploads());
+                }
+                if (showReach) reach.Draw();
+                if (sweptVisible) swept.Draw();
+                for (const BoundingBox& box : obstacles) DrawBoundingBox(box, ORANGE);
+                if (planner.IsStarted() && teachMode) planner.Draw();
+                if (showPreview && teachMode) {
+                    controlLock.lock();
+                    preview.Capture(savedStates);
+                    controlLock.unlock();
+                    preview.Update(robot, skinned);
+                    preview.Draw(skinned, CamInstance.Get());
+                    PROFILE_DRAW_CALLS(profiler, preview.GetDrawCalls(), preview.GetUniformUploads());
+                }
             EndMode3D();
+            PROFILE_PHASE(profiler, PHASE_GUI);
+            // krótka blokada: kopia stanu dla paneli, rysowanie już bez niej
+            controlLock.lock();
+            gui.CapturePanels(robot, savedStates, recorder, ipc, panels);
+            controlLock.unlock();
             gui.DrawHelpPanel();
             gui.DrawKeyHelpList(H, Pomoc, 1, -20, 10, 16, 100);
-            gui.DrawJointPositionBox(robot.GetJointType(selection));
-            if (teachMode || workMode) gui.DrawSavedStatesPanel(&savedStates);
+            float minValue, maxValue;
+            robot.GetJointLimits(selection, minValue, maxValue);
+            gui.DrawJointPositionBox(robot.GetJointType(selection), minValue, maxValue);
+            bool cartesianEntered = gui.DrawCartesianPositionBox();
+            gui.DrawIKStats(panels);
+            gui.DrawCollisionStats(panels);
+            if (showCell) gui.DrawCellStats(cell);
+            if (recorder.IsRecording()) gui.DrawRecorderStats(panels);
+            if (teachMode || workMode) gui.DrawSavedStatesPanel(panels);
+            if (workMode) gui.DrawCycleStats(&savedStates, panels);
+            gui.DrawControlStats(control);
+            if (ipc.IsOpen()) gui.DrawIpcStats(ipc, panels);
+            if (showReach) gui.DrawReachStats(reach);
+            if (planner.IsStarted() && teachMode) gui.DrawPlannerStats(planner);
+            if (optimizer.IsStarted() && teachMode) gui.DrawOptimizerStats(optimizer, panels.revision);
+            if (showSwept) gui.DrawSweptStats(swept, panels.statesCount);
+#if FRAME_PROFILER
+            if (showProfiler) gui.DrawProfilerOverlay(profiler);
+#endif
+            PROFILE_PHASE(profiler, PHASE_PRESENT);
             EndDrawing();
+            PROFILE_END_FRAME(profiler);
         
-        robot.UpdateTargetPosition(selection, gui.JointPositionBoxValue);
+        controlLock.lock();
+        // wartość z okna odczytana przed zwolnieniem blokady - zapis tylko po edycji, żeby nie nadpisać poleceń IPC
+        if (gui.JointPositionBoxChanged) robot.UpdateTargetPosition(selection, gui.JointPositionBoxValue);
+        // punkt uczenia podany we współrzędnych kartezjańskich
+        if (cartesianEntered && !workMode) robot.MoveTCP(gui.CartesianBoxValue);
+    }
+
+    control.Stop();
+    scenario.Finish();
+    if (scenario.IsReplaying()) {
+        FrameTimeStats stats = scenario.GetStats();
+        TraceLog(LOG_INFO, "REPLAY: %d klatek, sr. %.3f ms, p50 %.3f ms, p95 %.3f ms, p99 %.3f ms, maks. %.3f ms",
+            stats.frames, stats.avg, stats.p50, stats.p95, stats.p99, stats.max);
+        if (statsFile == NULL) statsFile = TextFormat("%s.stats.json", replayFile);
+        SaveFrameTimeStats(statsFile, stats);
+        FrameTimeStats baseline;
+        if (baselineFile != NULL && LoadFrameTimeStats(baselineFile, baseline)) {
+            auto change = [](float now, float before) { return (before > 0) ? (now / before - 1) * 100 : 0; };
+            TraceLog(LOG_INFO, "REPLAY: wzgledem %s: sr. %+.1f%%, p95 %+.1f%%, p99 %+.1f%%, maks. %+.1f%%", baselineFile,
+                change(stats.avg, baseline.avg), change(stats.p95, baseline.p95), change(stats.p99, baseline.p99), change(stats.max, baseline.max));
+        }
     }
 
     UnloadShader(shader);